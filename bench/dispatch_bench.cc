@@ -0,0 +1,165 @@
+/*
+
+dispatch_bench.cc
+
+VM dispatch cost. Runs loops made of cheap instructions, where the time
+goes into getting from one handler to the next, and reports nanoseconds
+per dispatch. Each loop runs twice, compiled plainly and with the
+superinstructions from runtime/vm/superinstructions.def. The build makes
+two binaries: dispatch_bench in the configured dispatch mode (computed
+goto by default) and dispatch_bench_switch with the portable switch; run
+both to compare.
+
+    dispatch_bench [--runs=N] [--iters=N]
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../parser/lexer.hh"
+#include "../parser/parser.hh"
+#include "../runtime/nativefn.hh"
+#include "../runtime/checker/checker.hh"
+#include "../runtime/vm/compiler.hh"
+#include "../runtime/vm/vm.hh"
+
+using Clock = std::chrono::steady_clock;
+
+struct Workload {
+    const char* name;
+    const char* body; // statements of the loop in work(n), 'i' counts up to n
+    const char* setup;
+};
+
+// Locals only, so every instruction is a frame slot access or a cheap op
+static const Workload WORKLOADS[] = {
+    {"int arithmetic", "x = x + i * 3 - 1;", "var x: int = 0;"},
+    {"local moves",    "x = y; y = z; z = x;", "var x: int = 1; var y: int = 2; var z: int = 3;"},
+    {"float (generic)", "f = f + 0.5;", "var f: float = 0.0;"},
+    {"array update",   "a[i % 64] = a[i % 64] + i;", "var a: int[64] = {};"},
+};
+
+static std::string source(const Workload& w, long iters)
+{
+    std::ostringstream out;
+    out << "func work(var n: int) -> int {\n"
+        << "    " << w.setup << "\n"
+        << "    var i: int = 0;\n"
+        << "    while (i < n) {\n"
+        << "        " << w.body << "\n"
+        << "        i++;\n"
+        << "    }\n"
+        << "    return i;\n"
+        << "}\n"
+        << "var r: int = work(" << iters << ");\n";
+    return out.str();
+}
+
+// The opcode deciding where a (super)instruction continues
+static uint8_t control(uint8_t op)
+{
+    auto& parts = superinstruction_parts(op);
+    return parts.empty() ? op : parts.back();
+}
+
+// Dispatches executed by one pass of the (only) loop in 'fn': walks from
+// the loop start along the taken path until the backward jump. Jump
+// offsets are the last operand and count from the end of the instruction.
+static std::size_t loop_length(const CompiledFunction& fn)
+{
+    const Chunk& chunk = fn.chunk;
+    auto end = [&](std::size_t ip) { return ip + 1 + operand_size(chunk.code[ip]); };
+
+    std::size_t loop_end = 0;
+    for (std::size_t ip = 0; ip < chunk.code.size(); ip = end(ip)) {
+        if (control(chunk.code[ip]) == OP_LOOP) loop_end = ip;
+    }
+    std::size_t ip = end(loop_end) - chunk.read_u32(end(loop_end) - 4);
+
+    std::size_t count = 1; // the OP_LOOP
+    while (ip != loop_end) {
+        count++;
+        if (control(chunk.code[ip]) == OP_JUMP) ip = end(ip) + chunk.read_u32(end(ip) - 4);
+        else ip = end(ip);
+    }
+    return count;
+}
+
+static const CompiledFunction* find_function(const CompiledFunction& script, const std::string& name)
+{
+    for (auto& constant : script.chunk.constants) {
+        if (constant.kind != VAL_FUNCTION) continue;
+        auto fn = dynamic_cast<CompiledFunctionValue*>(constant.obj);
+        if (fn && fn->function->name == name) return fn->function.get();
+    }
+    return nullptr;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 5;
+    long iters = 2000000;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--runs=", 0) == 0) runs = std::atoi(arg.c_str() + 7);
+        else if (arg.rfind("--iters=", 0) == 0) iters = std::atol(arg.c_str() + 8);
+        else { std::fprintf(stderr, "dispatch_bench: usage: dispatch_bench [--runs=N] [--iters=N]\n"); return 1; }
+    }
+    if (runs < 1) runs = 1;
+    if (iters < 1) iters = 1;
+
+    register_default_native_functions();
+    std::vector<std::string> natives;
+    for (auto& [name, func] : NativeRegistry::instance().all_functions()) {
+        natives.push_back(name);
+    }
+
+    std::printf("dispatch: %s, %d superinstructions, best of %d runs, %ld iterations\n\n",
+                VM::dispatch_mode(), OP__COUNT - OP__BASE_COUNT, runs, iters);
+    std::printf("%-16s %-6s %10s %10s %10s %12s\n", "workload", "code", "ops/iter", "ms", "ns/op", "Mops/s");
+
+    for (auto& w : WORKLOADS) {
+        std::string src = source(w, iters);
+
+        Parser parser(src, tokenize(src));
+        Ast program = parser.produceAST();
+        TypeChecker checker(natives, false);
+        checker.check(program);
+
+        double plain_ms = 0.0;
+        for (bool fused : {false, true}) {
+            Compiler compiler(natives);
+            compiler.set_superinstructions(fused);
+            auto script = compiler.compile(program);
+            std::size_t per_iter = loop_length(*find_function(*script, "work"));
+
+            double best = 1e30;
+            for (int r = 0; r < runs; r++) {
+                VM vm(compiler.global_names());
+                for (auto& [name, func] : NativeRegistry::instance().all_functions()) {
+                    vm.define_global(name, Value::Object(new NativeFunctionValue(name, func)), VAL_FUNCTION);
+                }
+
+                auto start = Clock::now();
+                vm.run(script);
+                double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+                if (ms < best) best = ms;
+            }
+
+            double ops = static_cast<double>(per_iter) * iters;
+            std::printf("%-16s %-6s %10zu %10.2f %10.3f %12.1f", fused ? "" : w.name, fused ? "fused" : "plain",
+                        per_iter, best, best * 1e6 / ops, ops / best / 1e3);
+            if (fused) std::printf("   %.2fx\n", plain_ms / best);
+            else std::printf("\n");
+            plain_ms = best;
+        }
+    }
+
+    return 0;
+}
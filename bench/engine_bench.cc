@@ -0,0 +1,191 @@
+/*
+
+engine_bench.cc
+
+Execution engine comparison. Runs generated workloads (an int loop,
+recursive calls, an array sort) on the tree walker, the closure compiler
+and the bytecode VM, and reports the best run time of each. Compile time
+(closures or bytecode) is reported separately from run time.
+
+    engine_bench [--runs=N] [--scale=N]
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../parser/lexer.hh"
+#include "../parser/parser.hh"
+#include "../runtime/nativefn.hh"
+#include "../runtime/checker/checker.hh"
+#include "../runtime/closure/closure.hh"
+#include "../runtime/environment/environment.hh"
+#include "../runtime/interpreter/interpreter.hh"
+#include "../runtime/resolver/resolver.hh"
+#include "../runtime/vm/compiler.hh"
+#include "../runtime/vm/vm.hh"
+
+using Clock = std::chrono::steady_clock;
+
+struct Workload {
+    const char* name;
+    std::string source;
+};
+
+static std::vector<Workload> workloads(int scale)
+{
+    std::vector<Workload> out;
+
+    std::ostringstream loop;
+    loop << "var sum: int = 0;\n"
+         << "for (var i: int = 0; i < " << 400000 * scale << "; i++) {\n"
+         << "    sum = sum + i % 7;\n"
+         << "}\n";
+    out.push_back({"int loop", loop.str()});
+
+    std::ostringstream fib;
+    fib << "func fib(var n: int) -> int {\n"
+        << "    if (n < 2) { return n; }\n"
+        << "    return fib(n - 1) + fib(n - 2);\n"
+        << "}\n"
+        << "var r: int = 0;\n"
+        << "for (var k: int = 0; k < " << scale << "; k++) { r = fib(22); }\n";
+    out.push_back({"fib calls", fib.str()});
+
+    std::ostringstream sort;
+    sort << "var n: int = " << 400 * scale << ";\n"
+         << "var a: int[n] = {};\n"
+         << "for (var i: int = 0; i < n; i++) { a[i] = (i * 7919) % 1009; }\n"
+         << "for (var pass: int = 0; pass < n; pass++) {\n"
+         << "    for (var j: int = 0; j < n - 1 - pass; j++) {\n"
+         << "        if (a[j] > a[j + 1]) { var t: int = a[j]; a[j] = a[j + 1]; a[j + 1] = t; }\n"
+         << "    }\n"
+         << "}\n";
+    out.push_back({"array sort", sort.str()});
+
+    return out;
+}
+
+struct Timing {
+    double compile_ms = 0.0;
+    double run_ms = 0.0;
+};
+
+static double ms_since(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Parses and checks a fresh tree every time, the tree walker rewrites its nodes
+static Ast prepare(const std::string& src, const std::vector<std::string>& natives, bool vm)
+{
+    Parser parser(src, tokenize(src));
+    Ast program = parser.produceAST();
+
+    TypeChecker checker(natives, !vm);
+    checker.check(program);
+    return program;
+}
+
+static Timing run_walker(const std::string& src, const std::vector<std::string>& natives, bool closures)
+{
+    Ast program = prepare(src, natives, false);
+    Resolver resolver(natives);
+    resolver.resolve(program);
+
+    Environment* env = Environment::push(nullptr, program[program.root].c);
+    for (std::size_t i = 0; i < natives.size(); i++) {
+        Value native_val = Value::Object(new NativeFunctionValue(natives[i], NativeRegistry::instance().get_function(natives[i])));
+        env->declareVar(ScopeSlot{0, static_cast<int>(i)}, natives[i], native_val, VAL_FUNCTION, true, 0);
+    }
+
+    Timing t;
+    if (closures) {
+        auto start = Clock::now();
+        auto compiled = ClosureCompiler(program).compile();
+        t.compile_ms = ms_since(start);
+
+        start = Clock::now();
+        compiled->run(env);
+        t.run_ms = ms_since(start);
+    } else {
+        auto start = Clock::now();
+        evaluate(program, program.root, env, 0);
+        t.run_ms = ms_since(start);
+    }
+
+    Environment::pop(env);
+    return t;
+}
+
+static Timing run_vm(const std::string& src, const std::vector<std::string>& natives)
+{
+    Ast program = prepare(src, natives, true);
+
+    Timing t;
+    auto start = Clock::now();
+    Compiler compiler(natives);
+    auto script = compiler.compile(program);
+    t.compile_ms = ms_since(start);
+
+    VM vm(compiler.global_names());
+    for (auto& [name, func] : NativeRegistry::instance().all_functions()) {
+        vm.define_global(name, Value::Object(new NativeFunctionValue(name, func)), VAL_FUNCTION);
+    }
+
+    start = Clock::now();
+    vm.run(script);
+    t.run_ms = ms_since(start);
+    return t;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = 5;
+    int scale = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--runs=", 0) == 0) runs = std::atoi(arg.c_str() + 7);
+        else if (arg.rfind("--scale=", 0) == 0) scale = std::atoi(arg.c_str() + 8);
+        else { std::fprintf(stderr, "engine_bench: usage: engine_bench [--runs=N] [--scale=N]\n"); return 1; }
+    }
+    if (runs < 1) runs = 1;
+    if (scale < 1) scale = 1;
+
+    register_default_native_functions();
+    std::vector<std::string> natives;
+    for (auto& [name, func] : NativeRegistry::instance().all_functions()) {
+        natives.push_back(name);
+    }
+
+    std::printf("best of %d runs, ms (compile + run)\n\n", runs);
+    std::printf("%-12s %18s %18s %18s\n", "workload", "tree", "closure", "vm");
+
+    for (auto& w : workloads(scale)) {
+        Timing best[3];
+        for (auto& b : best) b.run_ms = 1e30;
+
+        for (int r = 0; r < runs; r++) {
+            Timing t[3] = {
+                run_walker(w.source, natives, false),
+                run_walker(w.source, natives, true),
+                run_vm(w.source, natives),
+            };
+            for (int e = 0; e < 3; e++) {
+                if (t[e].run_ms < best[e].run_ms) best[e] = t[e];
+            }
+        }
+
+        std::printf("%-12s", w.name);
+        for (auto& b : best) std::printf("   %6.2f + %7.2f", b.compile_ms, b.run_ms);
+        std::printf("   closure %.2fx tree\n", best[0].run_ms / best[1].run_ms);
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+
+lexer_bench.cc
+
+Lexer throughput. Times tokenize() over a generated script (or the file
+given on the command line), then each byte-class scanner on long runs of
+its class, scalar against SIMD.
+
+    lexer_bench [file] [--mb=N]
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#include "../parser/lexer.hh"
+#include "../parser/scan.hh"
+
+using Clock = std::chrono::steady_clock;
+
+// Runs 'fn' until a quarter second has passed, returns GB/s over 'bytes' per run
+template <typename Fn>
+static double throughput(std::size_t bytes, Fn fn)
+{
+    std::size_t runs = 0;
+    auto start = Clock::now();
+    double elapsed = 0.0;
+
+    do {
+        fn();
+        runs++;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < 0.25);
+
+    return static_cast<double>(bytes) * runs / elapsed / 1e9;
+}
+
+static std::string generate(std::size_t target_bytes)
+{
+    std::ostringstream out;
+    for (std::size_t i = 0; static_cast<std::size_t>(out.tellp()) < target_bytes; i++) {
+        out << "// generated table row " << i << "\n"
+            << "var table_entry_" << i << ": int = " << i * 7919 % 100003 << " + " << i << " * 3;\n"
+            << "/* a block comment that spans\n   two lines */\n"
+            << "if (table_entry_" << i << " > 50000) { puts(\"row %d is large, value %d\\n\", " << i
+            << ", table_entry_" << i << "); }\n"
+            << "        \n";
+    }
+    return out.str();
+}
+
+static volatile std::size_t sink;
+
+int main(int argc, char** argv)
+{
+    std::size_t mb = 16;
+    std::string path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--mb=", 0) == 0) mb = std::strtoul(arg.c_str() + 5, nullptr, 10);
+        else path = arg;
+    }
+
+    std::string src;
+    if (!path.empty()) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) { std::fprintf(stderr, "lexer_bench: cannot open '%s'\n", path.c_str()); return 1; }
+        src.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } else {
+        src = generate(mb << 20);
+    }
+
+    std::printf("scanner isa: %s\n", scan::ISA);
+    std::printf("source: %.1f MB\n\n", src.size() / 1e6);
+
+    std::size_t tokens = 0;
+    double gbs = throughput(src.size(), [&] { tokens = tokenize(src).size(); });
+    std::printf("tokenize              %7.3f GB/s  (%zu tokens)\n\n", gbs, tokens);
+
+    // Long runs of each class, so the scanners run without stopping
+    const std::size_t n = 1 << 20;
+    std::string spaces(n, ' ');
+    for (std::size_t i = 0; i < n; i += 80) spaces[i] = '\n';
+    std::string ident(n, 'a');
+    for (std::size_t i = 0; i < n; i += 7) ident[i] = '_';
+    std::string comment(n, 'x');
+    for (std::size_t i = 0; i < n; i += 80) comment[i] = '\n';
+    comment += "*/";
+    std::string body(n, 'y');
+    body += '"';
+
+    auto bench = [&](const char* name, const std::string& buf, auto scalar_fn, auto simd_fn) {
+        const char* b = buf.data();
+        const char* e = b + buf.size();
+        double s = throughput(buf.size(), [&] { sink = scalar_fn(b, e) - b; });
+        double v = throughput(buf.size(), [&] { sink = simd_fn(b, e) - b; });
+        std::printf("%-20s  scalar %7.3f GB/s   simd %7.3f GB/s\n", name, s, v);
+    };
+
+#ifdef RYLANG_SCAN_SIMD
+    std::size_t lines = 0;
+    bench("skip_whitespace", spaces,
+          [&](const char* b, const char* e) { return scan::scalar::skip_whitespace(b, e, lines); },
+          [&](const char* b, const char* e) { return scan::simd::skip_whitespace(b, e, lines); });
+    bench("skip_ident", ident,
+          [](const char* b, const char* e) { return scan::scalar::skip_ident(b, e); },
+          [](const char* b, const char* e) { return scan::simd::skip_ident(b, e); });
+    bench("find_comment_end", comment,
+          [&](const char* b, const char* e) { return scan::scalar::find_comment_end(b, e, lines); },
+          [&](const char* b, const char* e) { return scan::simd::find_comment_end(b, e, lines); });
+    bench("find_quote_or_escape", body,
+          [](const char* b, const char* e) { return scan::scalar::find_quote_or_escape(b, e); },
+          [](const char* b, const char* e) { return scan::simd::find_quote_or_escape(b, e); });
+#else
+    std::printf("built without SIMD scanners, nothing to compare\n");
+#endif
+
+    return 0;
+}
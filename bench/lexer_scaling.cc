@@ -0,0 +1,109 @@
+/*
+
+lexer_scaling.cc
+
+Parallel lexing scalability. Times tokenize() against tokenize_parallel()
+at 1, 2, 4, ... threads over a generated script (or the file given on the
+command line), checking that every run yields exactly the sequential
+tokens, line numbers included.
+
+    lexer_scaling [file] [--mb=N] [--max-threads=N]
+
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../parser/lexer.hh"
+
+using Clock = std::chrono::steady_clock;
+
+// Best of 'runs' wall times in seconds
+template <typename Fn>
+static double best_time(int runs, Fn fn)
+{
+    double best = 1e30;
+    for (int r = 0; r < runs; r++) {
+        auto start = Clock::now();
+        fn();
+        double t = std::chrono::duration<double>(Clock::now() - start).count();
+        if (t < best) best = t;
+    }
+    return best;
+}
+
+static std::string generate(std::size_t target_bytes)
+{
+    std::ostringstream out;
+    for (std::size_t i = 0; static_cast<std::size_t>(out.tellp()) < target_bytes; i++) {
+        out << "// generated table row " << i << "\n"
+            << "var table_entry_" << i << ": int = " << i * 7919 % 100003 << " + " << i << " * 3;\n"
+            << "/* a block comment that spans\n   two lines */\n"
+            << "var label_" << i << ": string = \"line\\none \\\"quoted\\\" // not a comment\";\n"
+            << "var sep_" << i << ": char = '\\n';\n"
+            << "if (table_entry_" << i << " > 50000) { puts(\"row %d is large, value %d\\n\", " << i
+            << ", table_entry_" << i << "); }\n";
+    }
+    return out.str();
+}
+
+static bool same_tokens(const std::vector<Token>& a, const std::vector<Token>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); i++) {
+        const Token& x = a[i];
+        const Token& y = b[i];
+        if (x.type != y.type || x.offset != y.offset || x.length != y.length || x.line != y.line ||
+            x.op != y.op || x.escaped != y.escaped || x.int_value != y.int_value) return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t mb = 64;
+    unsigned max_threads = 8;
+    std::string path;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--mb=", 0) == 0) mb = std::strtoul(arg.c_str() + 5, nullptr, 10);
+        else if (arg.rfind("--max-threads=", 0) == 0) max_threads = std::strtoul(arg.c_str() + 14, nullptr, 10);
+        else path = arg;
+    }
+
+    std::string src;
+    if (!path.empty()) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) { std::fprintf(stderr, "lexer_scaling: cannot open '%s'\n", path.c_str()); return 1; }
+        src.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } else {
+        src = generate(mb << 20);
+    }
+
+    std::printf("source: %.1f MB, hardware threads: %u\n\n", src.size() / 1e6, std::thread::hardware_concurrency());
+
+    std::vector<Token> expected;
+    double seq = best_time(3, [&] { expected = tokenize(src); });
+    std::printf("tokenize           %8.3f s  %7.3f GB/s  (%zu tokens)\n", seq, src.size() / seq / 1e9, expected.size());
+
+    bool ok = true;
+    for (unsigned threads = 1; threads <= max_threads; threads *= 2) {
+        std::vector<Token> tokens;
+        double t = best_time(3, [&] { tokens = tokenize_parallel(src, threads); });
+        bool same = same_tokens(tokens, expected);
+        ok = ok && same;
+
+        std::printf("parallel x%-2u       %8.3f s  %7.3f GB/s  speedup %5.2fx  %s\n",
+                    threads, t, src.size() / t / 1e9, seq / t, same ? "identical" : "MISMATCH");
+    }
+
+    return ok ? 0 : 1;
+}
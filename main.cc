@@ -1,91 +1,246 @@
+#include <cstdlib>
 #include <iostream>
-#include <fstream>
+#include <memory>
 #include <string>
+#include <thread>
 
+#include "parser/ast_cache.hh"
 #include "parser/lexer.hh"
 #include "parser/parser.hh"
 
 #include "runtime/values.hh"
 #include "runtime/environment/environment.hh"
 #include "runtime/interpreter/interpreter.hh"
+#include "runtime/resolver/resolver.hh"
+#include "runtime/memory/allocator.hh"
 
 #include "runtime/nativefn.hh"
 
+#include "runtime/checker/checker.hh"
+
+#include "runtime/closure/closure.hh"
+
+#include "runtime/vm/compiler.hh"
+#include "runtime/vm/profile.hh"
+#include "runtime/vm/vm.hh"
+
 #include "utils/utils.hh"
+#include "utils/source.hh"
 
 #define LEXER_DEBUG 0
 #define PARSER_DEBUG 0
 #define INTERPRETER_DEBUG 0
+#define VM_DEBUG 0
+
+constexpr std::size_t PARALLEL_LEX_BYTES = 4 << 20;
 
 int main(int argc, char** argv)
 {   
-    // ryc <source> command
-    if (argc != 2)
+    // ryc [--engine=tree|vm|closure] [--alloc-stats] [--lex-threads=N] [--cache | --cache-dir=DIR]
+    //     [--op-profile=FILE] <source> command, "-" reads the source from stdin
+    std::string f_path;
+    std::string engine = "tree";
+    bool alloc_stats = false;
+    unsigned lex_threads = 0; // 0 picks a count from the source size
+    bool use_cache = false;
+    std::string cache_dir;    // empty keeps the .ryb next to the source
+    std::string op_profile;   // opcode n-gram counts are added to this file
+
+    for (int i = 1; i < argc; i++)
     {
-        std::cerr << "ryc: usage: ryc <file>" << std::endl;
+        std::string arg = argv[i];
+
+        if (arg.rfind("--engine=", 0) == 0)
+        {
+            engine = arg.substr(9);
+            if (engine != "tree" && engine != "vm" && engine != "closure")
+            {
+                std::cerr << "ryc: unknown engine '" << engine << "', expected 'tree', 'vm' or 'closure'" << std::endl;
+                std::exit(1);
+            }
+        }
+        else if (arg == "--alloc-stats")
+        {
+            alloc_stats = true;
+        }
+        else if (arg.rfind("--lex-threads=", 0) == 0)
+        {
+            lex_threads = static_cast<unsigned>(std::strtoul(arg.c_str() + 14, nullptr, 10));
+        }
+        else if (arg == "--cache")
+        {
+            use_cache = true;
+        }
+        else if (arg.rfind("--cache-dir=", 0) == 0 && arg.size() > 12)
+        {
+            use_cache = true;
+            cache_dir = arg.substr(12);
+        }
+        else if (arg.rfind("--op-profile=", 0) == 0 && arg.size() > 13)
+        {
+            op_profile = arg.substr(13);
+        }
+        else if (f_path.empty() && arg.rfind("--", 0) != 0)
+        {
+            f_path = arg;
+        }
+        else
+        {
+            f_path.clear();
+            break;
+        }
+    }
+
+    if (f_path.empty())
+    {
+        std::cerr << "ryc: usage: ryc [--engine=tree|vm|closure] [--alloc-stats] [--lex-threads=N] [--cache | --cache-dir=DIR] [--op-profile=FILE] <file | ->" << std::endl;
         std::exit(1);
     }
 
-    // file_path
-    std::string f_path = argv[1];
+    if (!op_profile.empty())
+    {
+#ifndef RYLANG_VM_PROFILE
+        std::cerr << "ryc: --op-profile needs a build configured with -DRYLANG_VM_PROFILE=ON" << std::endl;
+        std::exit(1);
+#endif
+        if (engine != "vm")
+        {
+            std::cerr << "ryc: --op-profile needs --engine=vm" << std::endl;
+            std::exit(1);
+        }
+    }
 
-    /* Open file */
-    std::ifstream fptr(f_path);
-    if (!fptr)
+    /* Map the file, the tokens and the parser borrow from it */
+    SourceFile source;
+    if (!source.open(f_path))
     {
         std::cerr << "ryc: no such file or directory: '" << f_path << '\'' << std::endl;
         return 1;
     }
-    std::string src; // Source file to tokenize
+    std::string_view src = source.view();
 
-    // Read line by line
-    std::string l;
-    while (std::getline(fptr, l))
+    /* A precompiled .ryb for this exact source skips lexing and parsing */
+    Ast program;
+    uint64_t src_hash = 0;
+    std::string cache_path;
+    if (use_cache)
     {
-        src += l + '\n';
+        src_hash = hash_source(src);
+        cache_path = ast_cache_path(f_path, cache_dir, src_hash);
     }
 
-    fptr.close();
+    if (cache_path.empty() || !load_ast_cache(cache_path, src, src_hash, program))
+    {
+        /* Large sources are lexed in parallel chunks, small ones are not worth the threads */
+        if (lex_threads == 0)
+        {
+            lex_threads = src.size() >= PARALLEL_LEX_BYTES ? std::thread::hardware_concurrency() : 1;
+        }
 
-    std::vector<Token> tokens = tokenize(src);
+        std::vector<Token> tokens = lex_threads > 1 ? tokenize_parallel(src, lex_threads) : tokenize(src);
 
-    if (LEXER_DEBUG)
-    {   
-        std::cout << "===== LEXER DEBUG =====" << std::endl;
-        for (std::size_t i = 0; i < tokens.size(); i++)
+        if (LEXER_DEBUG)
         {
-            std::cout << "Type: " << tokens[i].type << ", Value: " << tokens[i].value << std::endl;
+            std::cout << "===== LEXER DEBUG =====" << std::endl;
+            for (std::size_t i = 0; i < tokens.size(); i++)
+            {
+                std::cout << "Type: " << static_cast<int>(tokens[i].type) << ", Value: " << tokens[i].text(src) << std::endl;
+            }
         }
-    }
 
-    auto parser = Parser(tokens);
-    auto program = parser.produceAST();
+        auto parser = Parser(src, std::move(tokens));
+        program = parser.produceAST();
+
+        if (!cache_path.empty()) save_ast_cache(cache_path, src, src_hash, program);
+    }
 
     if (PARSER_DEBUG)
     {   
         std::cout << "===== PARSER DEBUG =====" << std::endl;
-        print_ast(program, 0);
+        print_ast(to_tree(program, program.root), 0);
     }
 
-    Environment* env = new Environment();
-
     register_default_native_functions();
 
+    std::vector<std::string> natives;
     for (auto& [name, func] : NativeRegistry::instance().all_functions()) {
-        auto native_val = std::make_shared<NativeFunctionValue>(name, func);
-        env->declareVar(name, native_val, VAL_FUNCTION, true, 0);
+        natives.push_back(name);
+    }
+
+    // Give every variable reference a (depth, slot) address. The tree engines
+    // resolve first, the checker reads which names may still mean an
+    // enclosing binding from the addresses.
+    if (engine != "vm")
+    {
+        Resolver resolver(natives);
+        resolver.resolve(program);
     }
 
-    auto result = evaluate(program, env, 0);
+    // Type errors are reported before anything runs, the engines use the
+    // inferred types to skip casts and pick int-only operations
+    TypeChecker checker(natives, engine != "vm");
+    checker.check(program);
+
+    if (engine == "vm")
+    {
+        Compiler compiler(natives);
+        // Profiles count base opcodes, they are what superinstructions are made of
+        compiler.set_superinstructions(op_profile.empty());
+        auto script = compiler.compile(program);
+
+        if (VM_DEBUG)
+        {
+            std::cout << "===== VM DEBUG =====" << std::endl;
+            disassemble(*script);
+        }
+
+        VM vm(compiler.global_names());
+        for (auto& [name, func] : NativeRegistry::instance().all_functions()) {
+            vm.define_global(name, Value::Object(new NativeFunctionValue(name, func)), VAL_FUNCTION);
+        }
+
+        vm.run(script);
+
+        if (!op_profile.empty() && !OpProfile::instance().save(op_profile))
+        {
+            std::cerr << "ryc: cannot write the opcode profile to '" << op_profile << '\'' << std::endl;
+            return 1;
+        }
+
+        if (alloc_stats) Allocator::instance().print_stats(std::cerr);
+        return 0;
+    }
+
+    Environment* env = Environment::push(nullptr, program[program.root].c);
+
+    for (std::size_t i = 0; i < natives.size(); i++) {
+        Value native_val = Value::Object(new NativeFunctionValue(natives[i], NativeRegistry::instance().get_function(natives[i])));
+        env->declareVar(ScopeSlot{0, static_cast<int>(i)}, natives[i], native_val, VAL_FUNCTION, true, 0);
+    }
+
+    // The closure engine compiles the resolved tree once, then runs the closures
+    std::unique_ptr<ClosureProgram> closures;
+    Value result;
+    if (engine == "closure")
+    {
+        closures = ClosureCompiler(program).compile();
+        result = closures->run(env);
+    }
+    else
+    {
+        result = evaluate(program, program.root, env, 0);
+    }
 
     if (INTERPRETER_DEBUG)
     {   
         std::cout << "===== INTERPRETER DEBUG =====" << std::endl;
         std::cout << "Value: "; print_value(result, env, 0);
-        std::cout << "Type: " << vtostr(result->kind) << std::endl;
+        std::cout << "Type: " << vtostr(result.kind) << std::endl;
     }
 
-    delete env;
+    Environment::pop(env);
+
+    if (alloc_stats) Allocator::instance().print_stats(std::cerr);
 
     return 0;
 }
\ No newline at end of file
@@ -1,11 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <memory>
 #include <string>
 #include <optional>
 
-enum NodeType { // Nodes our language supports
+#include "lexer.hh"
+
+enum NodeType : uint8_t { // Nodes our language supports
     Program,         // This contains all statements
     ExprStmt,
     // Statements
@@ -34,6 +37,12 @@ enum NodeType { // Nodes our language supports
     CharLiteral,
     ArrayLiteral,
     NullLiteral,
+    // Specialized forms the tree walker rewrites nodes into while running,
+    // never produced by the parser
+    IntBinaryExpr,   // BinaryExpr that has only seen int operands
+    FloatBinaryExpr, // BinaryExpr that has only seen float operands
+    SlotIdentifier,  // IdentifierLiteral that resolved once
+    IntIndexExpr,    // MemberExpr that has only indexed int arrays
 };
 
 struct Stmt {
@@ -45,6 +54,21 @@ struct Stmt {
 
 struct Expr : Stmt {};
 
+// Lexical address assigned by the resolver: how many environments to walk up
+// from the current one (depth) and the slot inside that environment (index).
+struct ScopeSlot {
+    int depth = -1;
+    int index = -1;
+    // Binding to use while this one is not declared yet. Set for names a
+    // function body reads that its scope only declares after the function.
+    int outer_depth = -1;
+    int outer_index = -1;
+
+    bool resolved() const { return index >= 0; }
+    bool has_outer() const { return outer_index >= 0; }
+    ScopeSlot outer() const { return ScopeSlot{outer_depth, outer_index}; }
+};
+
 struct ASTExprStmt : public Stmt {
     std::shared_ptr<Expr> expression;
 
@@ -58,6 +82,7 @@ struct ASTExprStmt : public Stmt {
 
 struct ASTProgram final : Stmt {
     std::vector<std::shared_ptr<Stmt>> body;
+    int scope_size = 0; // global slots, including predeclared natives
 
     explicit ASTProgram(std::vector<std::shared_ptr<Stmt>> b, std::size_t l = 0)
         : body(std::move(b)) {
@@ -68,6 +93,7 @@ struct ASTProgram final : Stmt {
 
 struct ASTBlockStmt final : Stmt {
     std::vector<std::shared_ptr<Stmt>> block;
+    int scope_size = 0;
 
     explicit ASTBlockStmt(std::vector<std::shared_ptr<Stmt>> b, std::size_t l)
         : block(std::move(b)) {
@@ -80,6 +106,7 @@ struct ASTParam final : Expr {
     std::string name;
     std::string type;
     bool isArray;
+    ScopeSlot slot;
 
     ASTParam(std::string n, std::string t, bool i, std::size_t l) : name(n), type(t), isArray(i) {
         kind = NodeType::Param;
@@ -102,6 +129,8 @@ struct ASTFunctionStmt final : Stmt {
     std::string ret_type;
     std::vector<std::shared_ptr<ASTParam>> params;
     std::shared_ptr<Stmt> body;
+    ScopeSlot slot;
+    int param_scope_size = 0;
 
     ASTFunctionStmt(std::string n, std::string t, std::vector<std::shared_ptr<ASTParam>> p, std::shared_ptr<Stmt> b, std::size_t l) :
                     name(n), ret_type(t), params(std::move(p)), body(std::move(b))
@@ -143,6 +172,7 @@ struct ASTVarDecl final : Stmt {
 
     bool is_array;
     std::optional<std::shared_ptr<Expr>> array_size;
+    ScopeSlot slot;
 
     ASTVarDecl(std::string n, std::string t, std::shared_ptr<Expr> v, bool c, bool a, std::optional<std::shared_ptr<Expr>> s, std::size_t l)
         : name(std::move(n)), type(std::move(t)), value(std::move(v)), is_const(c), is_array(a), array_size(std::move(s)) {
@@ -190,10 +220,10 @@ struct ASTForStmt final : Stmt {
 struct ASTBinaryExpr final : Expr {
     std::shared_ptr<Expr> left;
     std::shared_ptr<Expr> right;
-    std::string op;
+    OpKind op;
 
-    ASTBinaryExpr(std::shared_ptr<Expr> l, std::shared_ptr<Expr> r, std::string o, std::size_t ln)
-        : left(std::move(l)), right(std::move(r)), op(std::move(o)) {
+    ASTBinaryExpr(std::shared_ptr<Expr> l, std::shared_ptr<Expr> r, OpKind o, std::size_t ln)
+        : left(std::move(l)), right(std::move(r)), op(o) {
         kind = NodeType::BinaryExpr;
         line = ln;
     }
@@ -201,10 +231,10 @@ struct ASTBinaryExpr final : Expr {
 
 struct ASTUnaryExpr final : Expr {
     std::shared_ptr<Expr> operand;
-    std::string op;
+    OpKind op;
     bool prefix;
 
-    ASTUnaryExpr(std::shared_ptr<Expr> op, std::string(o), bool p, std::size_t ln) : operand(std::move(op)), op(std::move(o)), prefix(p) {
+    ASTUnaryExpr(std::shared_ptr<Expr> operand, OpKind o, bool p, std::size_t ln) : operand(std::move(operand)), op(o), prefix(p) {
         kind = NodeType::UnaryExpr;
         line = ln;
     }
@@ -243,17 +273,29 @@ struct ASTCallExpr : Expr {
         }
 };
 
+// Integer and floating literals keep the type they were written with
 struct ASTNumericLiteral final : Expr {
-    double value;
+    bool is_int;
+    int int_value = 0;
+    double float_value = 0.0;
+    int constant = -1; // ConstantPool index, set by the resolver
+
+    ASTNumericLiteral(int val, std::size_t ln) : is_int(true), int_value(val) {
+        kind = NodeType::NumericLiteral;
+        line = ln;
+    }
 
-    ASTNumericLiteral(double val, std::size_t ln) : value(val) {
+    ASTNumericLiteral(double val, std::size_t ln) : is_int(false), float_value(val) {
         kind = NodeType::NumericLiteral;
         line = ln;
     }
+
+    double as_double() const { return is_int ? static_cast<double>(int_value) : float_value; }
 };
 
 struct ASTIdentifierLiteral final : Expr {
     std::string name;
+    ScopeSlot slot;
 
     ASTIdentifierLiteral(std::string n, std::size_t ln) : name(std::move(n)) {
         kind = NodeType::IdentifierLiteral;
@@ -263,6 +305,7 @@ struct ASTIdentifierLiteral final : Expr {
 
 struct ASTStringLiteral final : Expr {
     std::string value;
+    int constant = -1;
 
     ASTStringLiteral(std::string v, std::size_t ln) : value(std::move(v)) {
         kind = NodeType::StringLiteral;
@@ -272,6 +315,7 @@ struct ASTStringLiteral final : Expr {
 
 struct ASTCharLiteral final : Expr {
     char value;
+    int constant = -1;
 
     ASTCharLiteral(char v, std::size_t ln) : value(std::move(v)) {
         kind = NodeType::CharLiteral;
@@ -281,6 +325,7 @@ struct ASTCharLiteral final : Expr {
 
 struct ASTBoolLiteral final : Expr {
     bool value;
+    int constant = -1;
 
     ASTBoolLiteral(bool v, std::size_t ln) : value(v) {
         kind = NodeType::BoolLiteral;
@@ -0,0 +1,314 @@
+#include "ast_cache.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(std::is_trivially_copyable_v<Node>, "Node is cached as raw bytes");
+static_assert(std::is_trivially_copyable_v<AstVarDecl>, "AstVarDecl is cached as raw bytes");
+static_assert(std::is_trivially_copyable_v<AstParam>, "AstParam is cached as raw bytes");
+static_assert(std::is_trivially_copyable_v<AstFunction>, "AstFunction is cached as raw bytes");
+
+namespace {
+
+constexpr char MAGIC[4] = {'R', 'Y', 'B', '\0'};
+
+// Section counts, in file order. The names section is an offset table of
+// names + 1 entries followed by the concatenated bytes.
+enum Section { NODES, LISTS, VARS, FUNCTIONS, PARAMS, NAMES, SECTION_COUNT };
+
+struct Header {
+    char magic[4];
+    uint32_t version;
+    // Layout of the raw sections, a build with different structs rejects the file
+    uint16_t layout[5];
+    uint16_t endian;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint32_t root;
+    uint32_t counts[SECTION_COUNT];
+    uint64_t name_bytes;
+    uint64_t body_hash; // of everything after the header
+};
+
+constexpr uint16_t ENDIAN_MARK = 0x0102;
+
+void fill_layout(uint16_t* layout)
+{
+    layout[0] = sizeof(Node);
+    layout[1] = sizeof(NodeId);
+    layout[2] = sizeof(AstVarDecl);
+    layout[3] = sizeof(AstFunction);
+    layout[4] = sizeof(AstParam);
+}
+
+uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Bounds-checked reader over the mapped file
+struct Reader {
+    const char* p;
+    const char* end;
+
+    template <typename T>
+    bool read(std::vector<T>& out, std::size_t count) {
+        std::size_t bytes = count * sizeof(T);
+        if (static_cast<std::size_t>(end - p) < bytes) return false;
+        out.resize(count);
+        if (bytes) std::memcpy(out.data(), p, bytes);
+        p += bytes;
+        return true;
+    }
+};
+
+// The pools of a loaded Ast refer to each other by index; a corrupt file
+// must not send the evaluators out of bounds. The parser adds a node after
+// its children, so a child index below its parent's also rules out cycles.
+struct Validator {
+    const Ast& ast;
+
+    bool name(uint32_t id) const { return id < ast.names.size(); }
+    bool child(NodeId id, NodeId parent) const { return id < parent; }
+    bool child_or_none(NodeId id, NodeId parent) const { return id == NO_NODE || id < parent; }
+
+    bool list(uint32_t begin, uint32_t count, NodeId parent, bool allow_none = false) const {
+        if (begin > ast.lists.size() || count > ast.lists.size() - begin) return false;
+        for (uint32_t i = 0; i < count; i++) {
+            NodeId id = ast.lists[begin + i];
+            if (!(allow_none ? child_or_none(id, parent) : child(id, parent))) return false;
+        }
+        return true;
+    }
+
+    bool node(NodeId id) const {
+        const Node& n = ast[id];
+
+        // Written before resolution and checking: no runtime forms, no
+        // checker results, identifiers not resolved yet
+        if (n.op > OpKind::Amp || n.type != NO_TYPE) return false;
+        if (n.flags & (FLAG_NO_CAST | FLAG_INT_OPERANDS | FLAG_GENERIC)) return false;
+
+        switch (n.kind) {
+            case NodeType::Program:
+            case NodeType::BlockStmt:
+            case NodeType::ArrayLiteral:
+                return list(n.a, n.b, id);
+            case NodeType::ExprStmt:
+            case NodeType::UnaryExpr:
+                return child(n.a, id);
+            case NodeType::VarDeclaration:
+            {
+                if (n.a >= ast.vars.size()) return false;
+                const AstVarDecl& var = ast.vars[n.a];
+                return name(var.name) && name(var.type) && var.value_type == NO_TYPE &&
+                       child_or_none(var.value, id) && child_or_none(var.array_size, id);
+            }
+            case NodeType::IfStmt:
+                return child(n.a, id) && child(n.b, id) && child_or_none(n.c, id);
+            case NodeType::WhileStmt:
+            case NodeType::BinaryExpr:
+            case NodeType::AssignmentExpr:
+            case NodeType::MemberExpr:
+                return child(n.a, id) && child(n.b, id);
+            case NodeType::ForStmt:
+                return child_or_none(n.a, id) && child_or_none(n.b, id) && list(n.c, 2, id, true) &&
+                       ast.lists[n.c + 1] != NO_NODE;
+            case NodeType::FunctionStmt:
+            {
+                if (n.a >= ast.functions.size()) return false;
+                const AstFunction& fn = ast.functions[n.a];
+                if (!name(fn.name) || !name(fn.ret_type) || !child(fn.body, id)) return false;
+                if (fn.params_begin > ast.params.size() || fn.params_count > ast.params.size() - fn.params_begin)
+                    return false;
+                for (uint32_t i = 0; i < fn.params_count; i++) {
+                    const AstParam& param = ast.params[fn.params_begin + i];
+                    if (!name(param.name) || !name(param.type) || param.value_type != NO_TYPE) return false;
+                }
+                return true;
+            }
+            case NodeType::ReturnStmt:
+                return child_or_none(n.a, id);
+            case NodeType::ContinueStmt:
+            case NodeType::BreakStmt:
+            case NodeType::NumericLiteral:
+            case NodeType::BoolLiteral:
+            case NodeType::CharLiteral:
+            case NodeType::NullLiteral:
+                return true;
+            case NodeType::CallExpr:
+                return child(n.a, id) && list(n.b, n.c, id);
+            case NodeType::CastExpr:
+                return name(n.a) && child(n.b, id);
+            case NodeType::IdentifierLiteral:
+                return name(n.a) && n.b == UINT32_MAX && n.c == UINT32_MAX;
+            case NodeType::StringLiteral:
+                return name(n.a);
+            default:
+                return false;
+        }
+    }
+
+    bool all() const {
+        if (ast.root >= ast.nodes.size() || ast[ast.root].kind != NodeType::Program) return false;
+        for (NodeId id = 0; id < ast.nodes.size(); id++) {
+            if (!node(id)) return false;
+        }
+        return true;
+    }
+};
+
+template <typename T>
+void append(std::string& out, const std::vector<T>& v)
+{
+    out.append(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(T));
+}
+
+}
+
+uint64_t hash_source(std::string_view src)
+{
+    // Word at a time; this only has to tell edited sources apart
+    const char* p = src.data();
+    std::size_t n = src.size();
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001b3ull;
+        h ^= h >> 29;
+    }
+
+    uint64_t tail = 0;
+    std::memcpy(&tail, p + i, n - i);
+    return mix(h ^ tail);
+}
+
+std::string ast_cache_path(const std::string& src_path, const std::string& dir, uint64_t hash)
+{
+    if (!dir.empty()) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.ryb", static_cast<unsigned long long>(hash));
+        return dir + "/" + name;
+    }
+
+    if (src_path == "-") return "";
+    return src_path + "b";
+}
+
+bool load_ast_cache(const std::string& path, std::string_view src, uint64_t hash, Ast& ast)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(Header)) {
+        close(fd);
+        return false;
+    }
+
+    std::size_t size = st.st_size;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const char* data = static_cast<const char*>(map);
+
+    Header h;
+    std::memcpy(&h, data, sizeof(Header));
+
+    uint16_t layout[5];
+    fill_layout(layout);
+
+    bool ok = std::memcmp(h.magic, MAGIC, 4) == 0 && h.version == AST_CACHE_VERSION &&
+              std::memcmp(h.layout, layout, sizeof(layout)) == 0 && h.endian == ENDIAN_MARK &&
+              h.source_hash == hash && h.source_size == src.size() &&
+              h.body_hash == hash_source(std::string_view(data + sizeof(Header), size - sizeof(Header)));
+
+    if (ok) {
+        Reader r{data + sizeof(Header), data + size};
+        std::vector<uint64_t> offsets;
+        ok = r.read(ast.nodes, h.counts[NODES]) && r.read(ast.lists, h.counts[LISTS]) &&
+             r.read(ast.vars, h.counts[VARS]) && r.read(ast.functions, h.counts[FUNCTIONS]) &&
+             r.read(ast.params, h.counts[PARAMS]) && r.read(offsets, h.counts[NAMES] + std::size_t{1}) &&
+             static_cast<uint64_t>(r.end - r.p) == h.name_bytes && offsets.back() == h.name_bytes;
+
+        // Names are interned in id order, which gives them back their ids
+        for (std::size_t i = 0; ok && i < h.counts[NAMES]; i++) {
+            if (offsets[i] > offsets[i + 1] || offsets[i + 1] > h.name_bytes) { ok = false; break; }
+            ast.intern(std::string_view(r.p + offsets[i], offsets[i + 1] - offsets[i]));
+        }
+
+        ok = ok && ast.names.size() == h.counts[NAMES];
+        ast.root = h.root;
+        ok = ok && Validator{ast}.all();
+    }
+
+    munmap(map, size);
+
+    if (!ok) ast = Ast();
+    return ok;
+}
+
+void save_ast_cache(const std::string& path, std::string_view src, uint64_t hash, const Ast& ast)
+{
+    Header h{};
+    std::memcpy(h.magic, MAGIC, 4);
+    h.version = AST_CACHE_VERSION;
+    fill_layout(h.layout);
+    h.endian = ENDIAN_MARK;
+    h.source_hash = hash;
+    h.source_size = src.size();
+    h.root = ast.root;
+    h.counts[NODES] = static_cast<uint32_t>(ast.nodes.size());
+    h.counts[LISTS] = static_cast<uint32_t>(ast.lists.size());
+    h.counts[VARS] = static_cast<uint32_t>(ast.vars.size());
+    h.counts[FUNCTIONS] = static_cast<uint32_t>(ast.functions.size());
+    h.counts[PARAMS] = static_cast<uint32_t>(ast.params.size());
+    h.counts[NAMES] = static_cast<uint32_t>(ast.names.size());
+
+    std::vector<uint64_t> offsets;
+    offsets.reserve(ast.names.size() + 1);
+    offsets.push_back(0);
+    for (std::size_t i = 0; i < ast.names.size(); i++) {
+        offsets.push_back(offsets.back() + ast.name(static_cast<NameId>(i)).size());
+    }
+    h.name_bytes = offsets.back();
+
+    std::string body;
+    append(body, ast.nodes);
+    append(body, ast.lists);
+    append(body, ast.vars);
+    append(body, ast.functions);
+    append(body, ast.params);
+    append(body, offsets);
+    for (std::size_t i = 0; i < ast.names.size(); i++) body += ast.name(static_cast<NameId>(i));
+    h.body_hash = hash_source(body);
+
+    // The cache directory is created on first use
+    std::size_t slash = path.rfind('/');
+    if (slash != std::string::npos && slash > 0) mkdir(path.substr(0, slash).c_str(), 0755);
+
+    std::string tmp = path + ".tmp" + std::to_string(getpid());
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return;
+
+    bool ok = std::fwrite(&h, sizeof(Header), 1, f) == 1 &&
+              (body.empty() || std::fwrite(body.data(), 1, body.size(), f) == body.size());
+    ok = std::fclose(f) == 0 && ok;
+
+    if (!ok || std::rename(tmp.c_str(), path.c_str()) != 0) std::remove(tmp.c_str());
+}
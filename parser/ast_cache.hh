@@ -0,0 +1,43 @@
+/*
+
+ast_cache.hh
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "flat_ast.hh"
+
+// Precompiled scripts (.ryb). A cache file holds the parser's Ast for one
+// exact source text: a fixed header followed by the raw node pool, child
+// lists, side pools and the interned names. The header records the format
+// version, the node layout, a hash and size of the source and a hash of the
+// rest of the file; any mismatch makes the cache stale and the script is
+// parsed again. The loaded pools are checked as well: every child, list
+// range and side pool index has to be in bounds, or the file is malformed.
+//
+// The Ast is cached before resolution and type checking; slots and static
+// types depend on the registered natives and the engine, and constants live
+// in the process-wide ConstantPool.
+
+constexpr uint32_t AST_CACHE_VERSION = 3;
+
+// 64-bit hash of the source text, the key of the cache
+uint64_t hash_source(std::string_view src);
+
+// Where the cache of 'src_path' lives: "<src_path>b" next to the source
+// ("main.ry" -> "main.ryb"), or "<dir>/<hash>.ryb" when 'dir' is given.
+// Returns an empty path when there is nowhere to put it (stdin, no dir).
+std::string ast_cache_path(const std::string& src_path, const std::string& dir, uint64_t hash);
+
+// Maps 'path' and fills 'ast' if it was written for 'src'. Returns false on
+// a missing, stale or malformed cache, 'ast' is left empty then.
+bool load_ast_cache(const std::string& path, std::string_view src, uint64_t hash, Ast& ast);
+
+// Writes 'ast' to 'path' through a temporary file and a rename, so readers
+// never see a partial cache. Failures are silent, the cache is best effort.
+void save_ast_cache(const std::string& path, std::string_view src, uint64_t hash, const Ast& ast);
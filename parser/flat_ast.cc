@@ -0,0 +1,183 @@
+#include "flat_ast.hh"
+
+Node Ast::number(int value, std::size_t line)
+{
+    uint64_t u = static_cast<uint64_t>(static_cast<int64_t>(value));
+
+    Node n{NodeType::NumericLiteral};
+    n.flags = FLAG_INT;
+    n.line = static_cast<uint32_t>(line);
+    n.a = static_cast<uint32_t>(u);
+    n.b = static_cast<uint32_t>(u >> 32);
+    n.c = NO_CONSTANT;
+    return n;
+}
+
+Node Ast::number(double value, std::size_t line)
+{
+    uint64_t u;
+    std::memcpy(&u, &value, 8);
+
+    Node n{NodeType::NumericLiteral};
+    n.line = static_cast<uint32_t>(line);
+    n.a = static_cast<uint32_t>(u);
+    n.b = static_cast<uint32_t>(u >> 32);
+    n.c = NO_CONSTANT;
+    return n;
+}
+
+/* Conversion to the pointer tree */
+
+static std::shared_ptr<Expr> to_expr(const Ast& ast, NodeId id)
+{
+    return std::static_pointer_cast<Expr>(to_tree(ast, id));
+}
+
+static std::vector<std::shared_ptr<Stmt>> to_stmts(const Ast& ast, uint32_t begin, uint32_t count)
+{
+    std::vector<std::shared_ptr<Stmt>> out;
+    out.reserve(count);
+    for (uint32_t i = 0; i < count; i++) out.push_back(to_tree(ast, ast.lists[begin + i]));
+    return out;
+}
+
+static std::vector<std::shared_ptr<Expr>> to_exprs(const Ast& ast, uint32_t begin, uint32_t count)
+{
+    std::vector<std::shared_ptr<Expr>> out;
+    out.reserve(count);
+    for (uint32_t i = 0; i < count; i++) out.push_back(to_expr(ast, ast.lists[begin + i]));
+    return out;
+}
+
+std::shared_ptr<Stmt> to_tree(const Ast& ast, NodeId id)
+{
+    if (id == NO_NODE) return nullptr;
+
+    const Node& n = ast[id];
+
+    switch (n.kind) {
+        case NodeType::Program:
+        {
+            auto program = std::make_shared<ASTProgram>(to_stmts(ast, n.a, n.b), n.line);
+            program->scope_size = static_cast<int>(n.c);
+            return program;
+        }
+        case NodeType::ExprStmt:
+            return std::make_shared<ASTExprStmt>(to_expr(ast, n.a), n.line);
+
+        case NodeType::BlockStmt:
+        {
+            auto block = std::make_shared<ASTBlockStmt>(to_stmts(ast, n.a, n.b), n.line);
+            block->scope_size = static_cast<int>(n.c);
+            return block;
+        }
+        case NodeType::VarDeclaration:
+        {
+            const AstVarDecl& var = ast.vars[n.a];
+            std::optional<std::shared_ptr<Expr>> size;
+            if (var.array_size != NO_NODE) size = to_expr(ast, var.array_size);
+
+            auto decl = std::make_shared<ASTVarDecl>(ast.name(var.name), ast.name(var.type), to_expr(ast, var.value),
+                                                     n.has(FLAG_CONST), n.has(FLAG_ARRAY), size, n.line);
+            decl->slot = var.slot;
+            return decl;
+        }
+        case NodeType::IfStmt:
+        {
+            std::optional<std::shared_ptr<Stmt>> else_branch;
+            if (n.c != NO_NODE) else_branch = to_tree(ast, n.c);
+            return std::make_shared<ASTIfStmt>(to_expr(ast, n.a), to_tree(ast, n.b), else_branch, n.line);
+        }
+        case NodeType::WhileStmt:
+            return std::make_shared<ASTWhileStmt>(to_expr(ast, n.a), to_tree(ast, n.b), n.line);
+
+        case NodeType::ForStmt:
+            return std::make_shared<ASTForStmt>(to_tree(ast, n.a), to_expr(ast, n.b), to_expr(ast, ast.lists[n.c]),
+                                                to_tree(ast, ast.lists[n.c + 1]), n.line);
+
+        case NodeType::FunctionStmt:
+        {
+            const AstFunction& fn = ast.functions[n.a];
+
+            std::vector<std::shared_ptr<ASTParam>> params;
+            for (uint32_t i = 0; i < fn.params_count; i++) {
+                const AstParam& p = ast.params[fn.params_begin + i];
+                auto param = std::make_shared<ASTParam>(ast.name(p.name), ast.name(p.type), p.is_array, p.line);
+                param->slot = p.slot;
+                params.push_back(param);
+            }
+
+            auto func = std::make_shared<ASTFunctionStmt>(ast.name(fn.name), ast.name(fn.ret_type), params,
+                                                          to_tree(ast, fn.body), n.line);
+            func->slot = fn.slot;
+            func->param_scope_size = fn.param_scope_size;
+            return func;
+        }
+        case NodeType::ReturnStmt:
+            return std::make_shared<ASTReturnStmt>(to_expr(ast, n.a), n.line);
+
+        case NodeType::ContinueStmt:
+            return std::make_shared<ASTContinueStmt>(n.line);
+
+        case NodeType::BreakStmt:
+            return std::make_shared<ASTBreakStmt>(n.line);
+
+        case NodeType::BinaryExpr:
+            return std::make_shared<ASTBinaryExpr>(to_expr(ast, n.a), to_expr(ast, n.b), n.op, n.line);
+
+        case NodeType::UnaryExpr:
+            return std::make_shared<ASTUnaryExpr>(to_expr(ast, n.a), n.op, n.has(FLAG_PREFIX), n.line);
+
+        case NodeType::AssignmentExpr:
+            return std::make_shared<ASTAssignExpr>(to_expr(ast, n.a), to_expr(ast, n.b), n.line);
+
+        case NodeType::MemberExpr:
+            return std::make_shared<ASTMemberExpr>(to_expr(ast, n.a), to_expr(ast, n.b), n.has(FLAG_COMPUTED), n.line);
+
+        case NodeType::CallExpr:
+            return std::make_shared<ASTCallExpr>(to_expr(ast, n.a), to_exprs(ast, n.b, n.c), n.line);
+
+        case NodeType::CastExpr:
+            return std::make_shared<ASTCastExpr>(ast.name(n.a), to_expr(ast, n.b), n.line);
+
+        case NodeType::NumericLiteral:
+        {
+            auto num = n.has(FLAG_INT) ? std::make_shared<ASTNumericLiteral>(Ast::int_value(n), n.line)
+                                       : std::make_shared<ASTNumericLiteral>(Ast::float_value(n), n.line);
+            num->constant = static_cast<int>(n.c);
+            return num;
+        }
+        case NodeType::IdentifierLiteral:
+        {
+            auto ident = std::make_shared<ASTIdentifierLiteral>(ast.name(n.a), n.line);
+            ident->slot = ast.slot(n);
+            return ident;
+        }
+        case NodeType::StringLiteral:
+        {
+            auto str = std::make_shared<ASTStringLiteral>(ast.name(n.a), n.line);
+            str->constant = static_cast<int>(n.c);
+            return str;
+        }
+        case NodeType::CharLiteral:
+        {
+            auto ch = std::make_shared<ASTCharLiteral>(static_cast<char>(n.a), n.line);
+            ch->constant = static_cast<int>(n.c);
+            return ch;
+        }
+        case NodeType::BoolLiteral:
+        {
+            auto bl = std::make_shared<ASTBoolLiteral>(n.a != 0, n.line);
+            bl->constant = static_cast<int>(n.c);
+            return bl;
+        }
+        case NodeType::ArrayLiteral:
+            return std::make_shared<ASTArrayLiteral>(to_exprs(ast, n.a, n.b), n.line);
+
+        case NodeType::NullLiteral:
+            return std::make_shared<ASTNullLiteral>(n.line);
+
+        default:
+            return nullptr;
+    }
+}
@@ -0,0 +1,213 @@
+/*
+
+flat_ast.hh
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hh"
+
+// The parser's output. Nodes live in one contiguous pool and refer to their
+// children by 32-bit index; identifiers, type names and string literals are
+// interned once. Nodes with more fields than fit a Node keep them in a
+// typed side pool (variables, functions, parameters) or in 'lists'.
+//
+// Field use per kind (a, b, c):
+//   Program          lists begin, count, scope size
+//   ExprStmt         expression
+//   BlockStmt        lists begin, count, scope size
+//   VarDeclaration   vars index
+//   IfStmt           condition, then, else or NO_NODE
+//   WhileStmt        condition, body
+//   ForStmt          init, condition, lists begin of [update, body]  (any may be NO_NODE but body)
+//   FunctionStmt     functions index
+//   ReturnStmt       value or NO_NODE
+//   BinaryExpr       left, right                      (op, FLAG_INT_OPERANDS)
+//   UnaryExpr        operand                          (op, FLAG_PREFIX)
+//   AssignmentExpr   assignee, value                  (FLAG_NO_CAST)
+//   MemberExpr       object, property                 (FLAG_COMPUTED)
+//   CallExpr         callee, lists begin, count
+//   CastExpr         type name, target, target ValueType (checker)
+//   NumericLiteral   64-bit payload in a:b, constant  (FLAG_INT: a sign-extended int)
+//   IdentifierLiteral name, slot depth, slot index     (SHADOWED_SLOT, shadowed index)
+//   StringLiteral    string, -, constant
+//   CharLiteral      char, -, constant
+//   BoolLiteral      value, -, constant
+//   ArrayLiteral     lists begin, count
+//
+// The quickened kinds (IntBinaryExpr, ...) keep the fields of the kind they
+// replace.
+//
+// 'type' is the static ValueType of an expression as inferred by the type
+// checker, NO_TYPE when it is only known at runtime.
+
+using NodeId = uint32_t;
+using NameId = uint32_t;
+
+constexpr NodeId NO_NODE = UINT32_MAX;
+constexpr uint32_t NO_CONSTANT = UINT32_MAX;
+constexpr uint8_t NO_TYPE = 0xFF;
+// IdentifierLiteral depth marking an address with an outer fallback
+constexpr uint32_t SHADOWED_SLOT = UINT32_MAX - 1;
+
+enum : uint8_t {
+    FLAG_PREFIX   = 1 << 0, // UnaryExpr
+    FLAG_COMPUTED = 1 << 1, // MemberExpr
+    FLAG_INT      = 1 << 2, // NumericLiteral
+    FLAG_CONST    = 1 << 3, // VarDeclaration
+    FLAG_ARRAY    = 1 << 4, // VarDeclaration
+    // Set by the type checker
+    FLAG_NO_CAST      = 1 << 5, // VarDeclaration, AssignmentExpr, UnaryExpr: value already has the stored type
+    FLAG_INT_OPERANDS = 1 << 6, // BinaryExpr: both operands are ints
+    // Set by the tree walker
+    FLAG_GENERIC      = 1 << 7, // BinaryExpr, MemberExpr: a specialization failed, stays generic
+};
+
+struct Node {
+    // The tree walker rewrites kind and flags while it runs (see
+    // Ast::quicken) through the const Ast it evaluates, hence mutable.
+    // Nothing else about a node changes after parsing.
+    mutable NodeType kind;
+    OpKind op = OpKind::None;
+    mutable uint8_t flags = 0;
+    uint8_t type = NO_TYPE;
+    uint32_t line = 0;
+    uint32_t a = 0;
+    uint32_t b = 0;
+    uint32_t c = 0;
+
+    bool has(uint8_t flag) const { return flags & flag; }
+};
+
+static_assert(sizeof(Node) == 20, "Node should stay five words wide");
+
+struct AstVarDecl {
+    NameId name;
+    NameId type;
+    NodeId value = NO_NODE;
+    NodeId array_size = NO_NODE;
+    ScopeSlot slot;
+    uint8_t value_type = NO_TYPE; // declared ValueType (element type for arrays), NO_TYPE for auto
+};
+
+struct AstParam {
+    NameId name;
+    NameId type;
+    bool is_array;
+    uint8_t value_type = NO_TYPE; // as in AstVarDecl
+    uint32_t line;
+    ScopeSlot slot;
+};
+
+struct AstFunction {
+    NameId name;
+    NameId ret_type;
+    uint32_t params_begin;
+    uint32_t params_count;
+    NodeId body;
+    ScopeSlot slot;
+    int param_scope_size = 0;
+};
+
+// Interned strings, each spelling is stored once and keeps its id. The
+// storage never moves, so references stay valid as the table grows.
+class Interner {
+public:
+    Interner() = default;
+    // The index holds views into 'strings', a copy would point into the original
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+    Interner(Interner&&) = default;
+    Interner& operator=(Interner&&) = default;
+
+    NameId intern(std::string_view s) {
+        auto it = ids.find(s);
+        if (it != ids.end()) return it->second;
+
+        NameId id = static_cast<NameId>(strings.size());
+        const std::string& stored = strings.emplace_back(s);
+        ids.emplace(std::string_view(stored), id);
+        return id;
+    }
+
+    const std::string& str(NameId id) const { return strings[id]; }
+    std::size_t size() const { return strings.size(); }
+
+private:
+    std::deque<std::string> strings;
+    std::unordered_map<std::string_view, NameId> ids;
+};
+
+struct Ast {
+    std::vector<Node> nodes;
+    std::vector<NodeId> lists;
+    std::vector<AstVarDecl> vars;
+    std::vector<AstFunction> functions;
+    std::vector<AstParam> params;
+    std::vector<ScopeSlot> shadowed; // IdentifierLiteral addresses that have an outer fallback
+    Interner names;
+    NodeId root = NO_NODE;
+
+    NodeId add(const Node& node) {
+        nodes.push_back(node);
+        return static_cast<NodeId>(nodes.size() - 1);
+    }
+
+    Node& operator[](NodeId id) { return nodes[id]; }
+    const Node& operator[](NodeId id) const { return nodes[id]; }
+
+    const std::string& name(NameId id) const { return names.str(id); }
+    NameId intern(std::string_view s) { return names.intern(s); }
+
+    // Children stored in 'lists'
+    const NodeId* list(uint32_t begin) const { return lists.data() + begin; }
+
+    // NumericLiteral payload
+    static Node number(int value, std::size_t line);
+    static Node number(double value, std::size_t line);
+    static int int_value(const Node& n) { return static_cast<int>(static_cast<int64_t>(bits(n))); }
+    static double float_value(const Node& n) { double v; uint64_t u = bits(n); std::memcpy(&v, &u, 8); return v; }
+    static double as_double(const Node& n) {
+        return n.has(FLAG_INT) ? static_cast<double>(int_value(n)) : float_value(n);
+    }
+
+    // Quickening: the tree walker swaps a node's kind for a specialized form
+    // while running, and back when the form's type guard fails.
+    static void quicken(const Node& n, NodeType kind) { n.kind = kind; }
+    static void deoptimize(const Node& n, NodeType kind) {
+        n.kind = kind;
+        n.flags |= FLAG_GENERIC;
+    }
+
+    // IdentifierLiteral address, written by the resolver
+    ScopeSlot slot(const Node& n) const {
+        if (n.b == SHADOWED_SLOT) return shadowed[n.c];
+        return ScopeSlot{static_cast<int>(n.b), static_cast<int>(n.c)};
+    }
+    void set_slot(Node& n, ScopeSlot s) {
+        if (s.has_outer()) {
+            n.b = SHADOWED_SLOT;
+            n.c = static_cast<uint32_t>(shadowed.size());
+            shadowed.push_back(s);
+            return;
+        }
+        n.b = static_cast<uint32_t>(s.depth);
+        n.c = static_cast<uint32_t>(s.index);
+    }
+
+private:
+    static uint64_t bits(const Node& n) { return static_cast<uint64_t>(n.b) << 32 | n.a; }
+};
+
+// Rebuilds the pointer tree of 'id', for print_ast()
+std::shared_ptr<Stmt> to_tree(const Ast& ast, NodeId id);
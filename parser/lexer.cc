@@ -1,10 +1,19 @@
 #include "lexer.hh"
+#include "scan.hh"
 #include "../utils/error.hh"
 
+#include <charconv>
 #include <iostream>
+#include <thread>
 
-std::unordered_map<std::string, TokenType> keywords = 
-{
+/* Keywords */
+
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword keywords[] = {
     {"null", TokenType::NullTok},
     {"nullptr", TokenType::NullptrTok},
 
@@ -37,91 +46,169 @@ std::unordered_map<std::string, TokenType> keywords =
     {"break", TokenType::BreakTok},
 };
 
-std::vector<Token> tokenize(const std::string &src)
-{   
-    std::vector<Token> tokens;
-    std::size_t line = 1;
+// Perfect hash over the keyword set: length, first and last character
+// mixed with a seed that the compiler searches for, so that every keyword
+// lands in its own slot. Lookup is one hash, one slot and one compare.
+constexpr std::size_t KEYWORD_SLOTS = 64;
+
+constexpr std::size_t keyword_hash(std::string_view s, uint32_t seed)
+{
+    uint32_t h = static_cast<uint32_t>(s.size()) * 0x9E3779B1u;
+    h ^= static_cast<unsigned char>(s.front()) * seed;
+    h ^= static_cast<unsigned char>(s.back()) * (seed >> 7 | 1u);
+    return (h ^ (h >> 15)) % KEYWORD_SLOTS;
+}
+
+constexpr bool keyword_seed_works(uint32_t seed)
+{
+    bool used[KEYWORD_SLOTS] = {};
+    for (const Keyword& k : keywords) {
+        std::size_t slot = keyword_hash(k.text, seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t find_keyword_seed()
+{
+    for (uint32_t seed = 1; seed < 100000; seed++) {
+        if (keyword_seed_works(seed)) return seed;
+    }
+    return 0;
+}
+
+constexpr uint32_t KEYWORD_SEED = find_keyword_seed();
+static_assert(KEYWORD_SEED != 0, "no perfect hash seed for the keyword set");
+
+struct KeywordTable {
+    Keyword slots[KEYWORD_SLOTS] = {};
+};
+
+constexpr KeywordTable make_keyword_table()
+{
+    KeywordTable t;
+    for (const Keyword& k : keywords) t.slots[keyword_hash(k.text, KEYWORD_SEED)] = k;
+    return t;
+}
+
+constexpr KeywordTable keyword_table = make_keyword_table();
+
+TokenType keyword_type(std::string_view ident)
+{
+    const Keyword& k = keyword_table.slots[keyword_hash(ident, KEYWORD_SEED)];
+    return k.text == ident ? k.type : TokenType::Identifier;
+}
+
+const char* op_str(OpKind op)
+{
+    switch (op) {
+        case OpKind::Add: return "+";
+        case OpKind::Sub: return "-";
+        case OpKind::Mul: return "*";
+        case OpKind::Div: return "/";
+        case OpKind::Mod: return "%";
+        case OpKind::Eq:  return "==";
+        case OpKind::Neq: return "!=";
+        case OpKind::Gt:  return ">";
+        case OpKind::Gte: return ">=";
+        case OpKind::Lt:  return "<";
+        case OpKind::Lte: return "<=";
+        case OpKind::And: return "&&";
+        case OpKind::Or:  return "||";
+        case OpKind::Not: return "!";
+        case OpKind::Inc: return "++";
+        case OpKind::Dec: return "--";
+        case OpKind::Amp: return "&";
+        default:          return "?";
+    }
+}
+
+// Raised instead of syntax_err() while a chunk is lexed on a worker thread
+struct LexError {};
 
-    for (std::size_t i = 0; i < src.length(); i++)
+static void lex_error(const std::string& msg, std::size_t line, bool deferred)
+{
+    if (deferred) throw LexError{};
+    syntax_err(msg, line);
+}
+
+// Lexes src[begin, stop) into 'tokens', starting at 'line'. Offsets stay
+// relative to the whole source. Returns the line reached at 'stop'. With
+// 'deferred' set, errors throw LexError instead of exiting, the caller
+// then relexes sequentially to report them.
+static std::size_t lex_range(std::string_view src, std::size_t begin, std::size_t stop,
+                             std::size_t line, std::vector<Token>& tokens, bool deferred)
+{
+    const char* data = src.data();
+    const char* end = data + stop;
+
+    for (std::size_t i = begin; i < stop; i++)
     {
         char c = src[i];
 
-        if (c == '\n') { line++; continue; }
-        if (std::isspace(c)) continue;
+        if (scan::is_class(c, scan::CLASS_SPACE)) {
+            i = scan::skip_whitespace(data + i, end, line) - data - 1;
+            continue;
+        }
 
         std::size_t token_line = line; // capture line at start of token
+        char next = i + 1 < stop ? src[i + 1] : '\0';
 
-        if (c == '/' && i + 1 < src.length() && src[i + 1] == '/') {
-            i += 2;
-            while (i < src.length() && src[i] != '\n') i++;
+        if (c == '/' && next == '/') {
+            i = scan::find_char(data + i + 2, end, '\n') - data;
             line++; // increment line if newline is encountered
             continue;
         }
 
         // Multi-line comment
-        if (c == '/' && i + 1 < src.length() && src[i + 1] == '*') {
-            i += 2;
-            while (i + 1 < src.length() && !(src[i] == '*' && src[i + 1] == '/')) {
-                if (src[i] == '\n') line++;
-                i++;
-            }
-            if (i + 1 >= src.length()) {
-                syntax_err("unterminated multi-line comment", line);
+        if (c == '/' && next == '*') {
+            const char* close = scan::find_comment_end(data + i + 2, end, line);
+            if (close == end) {
+                lex_error("unterminated multi-line comment", line, deferred);
             }
-            i += 2; // skip past '*/'
+            i = close - data + 1; // the loop steps past the '/' of '*/'
             continue;
         }
         // Multi-character symbols
-        if (src[i] == '+' && src[i+1] == '+') { tokens.emplace_back("++", TokenType::UnaryOP, token_line); i++; continue; }
-        if (src[i] == '-' && src[i+1] == '-') { tokens.emplace_back("--", TokenType::UnaryOP, token_line); i++; continue; }
-        if (src[i] == '&' && src[i+1] == '&') { tokens.emplace_back("&&", TokenType::BinaryOP, token_line); i++; continue; }
-        if (src[i] == '|' && src[i+1] == '|') { tokens.emplace_back("||", TokenType::BinaryOP, token_line); i++; continue; }
-		if (src[i] == '=' && src[i+1] == '=') { tokens.emplace_back("==", TokenType::BinaryOP, token_line); i++; continue; }
-		if (src[i] == '!' && src[i+1] == '=') { tokens.emplace_back("!=", TokenType::BinaryOP, token_line); i++; continue; }
-		if (src[i] == '>' && src[i+1] == '=') { tokens.emplace_back(">=", TokenType::BinaryOP, token_line); i++; continue; }
-		if (src[i] == '<' && src[i+1] == '=') { tokens.emplace_back("<=", TokenType::BinaryOP, token_line); i++; continue; }
-        if (src[i] == '-' && src[i+1] == '>') { tokens.emplace_back("->", TokenType::Arrow, token_line); i++; continue; }
+        if (c == '+' && next == '+') { tokens.emplace_back(TokenType::UnaryOP, i, 2, token_line, OpKind::Inc); i++; continue; }
+        if (c == '-' && next == '-') { tokens.emplace_back(TokenType::UnaryOP, i, 2, token_line, OpKind::Dec); i++; continue; }
+        if (c == '&' && next == '&') { tokens.emplace_back(TokenType::BinaryOP, i, 2, token_line, OpKind::And); i++; continue; }
+        if (c == '|' && next == '|') { tokens.emplace_back(TokenType::BinaryOP, i, 2, token_line, OpKind::Or); i++; continue; }
+		if (c == '=' && next == '=') { tokens.emplace_back(TokenType::BinaryOP, i, 2, token_line, OpKind::Eq); i++; continue; }
+		if (c == '!' && next == '=') { tokens.emplace_back(TokenType::BinaryOP, i, 2, token_line, OpKind::Neq); i++; continue; }
+		if (c == '>' && next == '=') { tokens.emplace_back(TokenType::BinaryOP, i, 2, token_line, OpKind::Gte); i++; continue; }
+		if (c == '<' && next == '=') { tokens.emplace_back(TokenType::BinaryOP, i, 2, token_line, OpKind::Lte); i++; continue; }
+        if (c == '-' && next == '>') { tokens.emplace_back(TokenType::Arrow, i, 2, token_line); i++; continue; }
         // Single-character symbols
-        if (c == '(') { tokens.emplace_back("(", TokenType::LeftParen, token_line); continue; }
-        if (c == ')') { tokens.emplace_back(")", TokenType::RightParen, token_line); continue; }
-        if (c == '{') { tokens.emplace_back("{", TokenType::LeftBrace, token_line); continue; }
-        if (c == '}') { tokens.emplace_back("}", TokenType::RightBrace, token_line); continue; }
-        if (c == '[') { tokens.emplace_back("[", TokenType::LeftBracket, token_line); continue; }
-        if (c == ']') { tokens.emplace_back("]", TokenType::RightBracket, token_line); continue; }
-        if (c == '=') { tokens.emplace_back("=", TokenType::Equals, token_line); continue; }
-        if (c == '&') { tokens.emplace_back("&", TokenType::Ampersand, token_line); continue; }
-        if (c == '+') { tokens.emplace_back("+", TokenType::Plus, token_line); continue; }
-        if (c == '-') { tokens.emplace_back("-", TokenType::Minus, token_line); continue; }
-        if (c == '*') { tokens.emplace_back("*", TokenType::Star, token_line); continue; }
-        if (c == '/') { tokens.emplace_back("/", TokenType::Slash, token_line); continue; }
-        if (c == '%') { tokens.emplace_back("%", TokenType::Modulus, token_line); continue; }
-        if (c == ':') { tokens.emplace_back(":", TokenType::Colon, token_line); continue; }
-        if (c == ';') { tokens.emplace_back(";", TokenType::Semicolon, token_line); continue; }
-        if (c == ',') { tokens.emplace_back(",", TokenType::Comma, token_line); continue; }
-        if (c == '!') { tokens.emplace_back("!", TokenType::UnaryOP, token_line); continue; }
-        if (c == '>') { tokens.emplace_back(">", TokenType::BinaryOP, token_line); continue; }
-        if (c == '<') { tokens.emplace_back("<", TokenType::BinaryOP, token_line); continue; }
+        if (c == '(') { tokens.emplace_back(TokenType::LeftParen, i, 1, token_line); continue; }
+        if (c == ')') { tokens.emplace_back(TokenType::RightParen, i, 1, token_line); continue; }
+        if (c == '{') { tokens.emplace_back(TokenType::LeftBrace, i, 1, token_line); continue; }
+        if (c == '}') { tokens.emplace_back(TokenType::RightBrace, i, 1, token_line); continue; }
+        if (c == '[') { tokens.emplace_back(TokenType::LeftBracket, i, 1, token_line); continue; }
+        if (c == ']') { tokens.emplace_back(TokenType::RightBracket, i, 1, token_line); continue; }
+        if (c == '=') { tokens.emplace_back(TokenType::Equals, i, 1, token_line); continue; }
+        if (c == '&') { tokens.emplace_back(TokenType::Ampersand, i, 1, token_line, OpKind::Amp); continue; }
+        if (c == '+') { tokens.emplace_back(TokenType::Plus, i, 1, token_line, OpKind::Add); continue; }
+        if (c == '-') { tokens.emplace_back(TokenType::Minus, i, 1, token_line, OpKind::Sub); continue; }
+        if (c == '*') { tokens.emplace_back(TokenType::Star, i, 1, token_line, OpKind::Mul); continue; }
+        if (c == '/') { tokens.emplace_back(TokenType::Slash, i, 1, token_line, OpKind::Div); continue; }
+        if (c == '%') { tokens.emplace_back(TokenType::Modulus, i, 1, token_line, OpKind::Mod); continue; }
+        if (c == ':') { tokens.emplace_back(TokenType::Colon, i, 1, token_line); continue; }
+        if (c == ';') { tokens.emplace_back(TokenType::Semicolon, i, 1, token_line); continue; }
+        if (c == ',') { tokens.emplace_back(TokenType::Comma, i, 1, token_line); continue; }
+        if (c == '!') { tokens.emplace_back(TokenType::UnaryOP, i, 1, token_line, OpKind::Not); continue; }
+        if (c == '>') { tokens.emplace_back(TokenType::BinaryOP, i, 1, token_line, OpKind::Gt); continue; }
+        if (c == '<') { tokens.emplace_back(TokenType::BinaryOP, i, 1, token_line, OpKind::Lt); continue; }
 
         // Identifiers / keywords
-        if (std::isalpha(c))
+        if (scan::is_class(c, scan::CLASS_ALPHA))
         {
-            std::string ident;
-            bool has_alnum = false;
-
-            while (i < src.length() && (std::isalnum(src[i]) || src[i] == '_'))
-            {
-                if (std::isalnum(src[i])) has_alnum = true;
-                ident += src[i];
-                i++;
-            }
-
-            if (!has_alnum)
-            {
-                syntax_err("invalid identifier literal", line);
-            }
+            std::size_t start = i;
+            i = scan::skip_ident(data + i, end) - data;
 
-            TokenType type = (keywords.find(ident) == keywords.end()) ? TokenType::Identifier : keywords[ident];
-            tokens.emplace_back(ident, type, token_line);
+            std::string_view ident = src.substr(start, i - start);
+            tokens.emplace_back(keyword_type(ident), start, i - start, token_line);
             i--;
             continue;
         }
@@ -130,67 +217,77 @@ std::vector<Token> tokenize(const std::string &src)
         // Numbers
         if (std::isdigit(c))
         {
-            std::string num;
+            std::size_t start = i;
             bool hasDot = false;
-            while (i < src.length() && (std::isdigit(src[i]) || src[i] == '.'))
+            while (i < stop && (std::isdigit(src[i]) || src[i] == '.'))
             {
                 if (src[i] == '.')
                 {
                     if (hasDot) {
-                        syntax_err("invalid numeric literal: " + num, token_line);
+                        lex_error("invalid numeric literal: " + std::string(src.substr(start, i - start)), token_line, deferred);
                     }
                     hasDot = true;
                 }
-                num += src[i];
                 i++;
             }
-            tokens.emplace_back(num, TokenType::Number, token_line);
+
+            const char* first = src.data() + start;
+            const char* last = src.data() + i;
+
+            // Ints are 32-bit at runtime, integer literals past INT32_MAX are floats
+            int64_t int_value = 0;
+            bool is_int = !hasDot && std::from_chars(first, last, int_value).ec == std::errc() && int_value <= INT32_MAX;
+
+            if (is_int) {
+                Token& tok = tokens.emplace_back(TokenType::IntNumber, start, i - start, token_line);
+                tok.int_value = static_cast<int>(int_value);
+            } else {
+                Token& tok = tokens.emplace_back(TokenType::FloatNumber, start, i - start, token_line);
+                std::from_chars(first, last, tok.float_value);
+            }
             i--; // step back
             continue;
         }
         if (c == '"') {
-            std::string str;
             i++; // skip opening quote
-
-            while (i < src.length() && src[i] != '"') {
-                if (src[i] == '\\') {
-                    i++; // move to escape char
-                    if (i >= src.length()) syntax_err("unterminated escape sequence", token_line);
-                    switch(src[i]) {
-                        case 'n': str += '\n'; break;
-                        case 't': str += '\t'; break;
-                        case '"': str += '"'; break;
-                        case '\\': str += '\\'; break;
-                        default:
-                            syntax_err(std::string("unknown escape sequence: \\") + src[i], token_line);
-                    }
-                    // Don't increment i again here; the end-of-loop i++ will handle moving past this char
-                } else {
-                    str += src[i];
+            std::size_t start = i;
+            bool escaped = false;
+
+            // Jump from escape to escape. They are only validated here, the
+            // parser resolves them
+            while ((i = scan::find_quote_or_escape(data + i, end) - data) < stop && src[i] == '\\') {
+                i++; // move to escape char
+                if (i >= stop) lex_error("unterminated escape sequence", token_line, deferred);
+                switch(src[i]) {
+                    case 'n': case 't': case '"': case '\\': break;
+                    default:
+                        lex_error(std::string("unknown escape sequence: \\") + src[i], token_line, deferred);
                 }
+                escaped = true;
                 i++;
             }
 
-            if (i >= src.length() || src[i] != '"') {
-                syntax_err("unterminated string literal", token_line);
+            if (i >= stop || src[i] != '"') {
+                lex_error("unterminated string literal", token_line, deferred);
             }
 
-            tokens.emplace_back(str, TokenType::String, token_line);
+            Token& tok = tokens.emplace_back(TokenType::String, start, i - start, token_line);
+            tok.escaped = escaped;
             continue;
         }
 
         if (c == '\'') {
-            std::string ch;
             i++; 
+            std::size_t start = i;
 
-            if (i >= src.length()) {
-                syntax_err("unterminated character literal", line);
+            if (i >= stop) {
+                lex_error("unterminated character literal", line, deferred);
             }
 
             char char_val;
             if (src[i] == '\\') {
                 i++;
-                if (i >= src.length()) syntax_err("unterminated escape sequence", line);
+                if (i >= stop) lex_error("unterminated escape sequence", line, deferred);
 
                 switch (src[i]) {
                     case 'n': char_val = '\n'; break;
@@ -198,27 +295,162 @@ std::vector<Token> tokenize(const std::string &src)
                     case '\'': char_val = '\''; break;
                     case '\\': char_val = '\\'; break;
                     default:
-                        const std::string msg = "unknown escape sequence: \\" + line + src[i];
-                        syntax_err(msg, line);
+                        lex_error(std::string("unknown escape sequence: \\") + src[i], line, deferred);
                 }
             } else {
                 char_val = src[i];
             }
             i++;
 
-            if (i >= src.length() || src[i] != '\'') {
-                syntax_err("unterminated character literal", line);
+            if (i >= stop || src[i] != '\'') {
+                lex_error("unterminated character literal", line, deferred);
             }
-            ch += char_val;
 
-            tokens.emplace_back(ch, TokenType::Character, token_line);
+            Token& tok = tokens.emplace_back(TokenType::Character, start, i - start, token_line);
+            tok.int_value = char_val;
             continue;
         }
 
 
-        syntax_err(std::string("unexpected character found while lexing: ") + c, token_line);
+        lex_error(std::string("unexpected character found while lexing: ") + c, token_line, deferred);
     }
 
-    tokens.emplace_back("EoF", TokenType::EoF, line);
+    return line;
+}
+
+std::vector<Token> tokenize(std::string_view src)
+{
+    std::vector<Token> tokens;
+    std::size_t line = lex_range(src, 0, src.length(), 1, tokens, false);
+
+    tokens.emplace_back(TokenType::EoF, src.length(), 0, line);
     return tokens;
 }
+
+std::vector<std::size_t> chunk_boundaries(std::string_view src, std::size_t chunks)
+{
+    std::vector<std::size_t> cuts{0};
+    const char* data = src.data();
+    const char* end = data + src.length();
+    const char* p = data;
+    std::size_t target = 1;
+
+    // Follows only the states that can hide a newline from the lexer:
+    // strings, character literals and both kinds of comments
+    while (target < chunks && p < end) {
+        p = scan::find_lex_state(p, end);
+        if (p == end) break;
+
+        switch (*p) {
+            case '\n':
+                p++;
+                if (p < end && static_cast<std::size_t>(p - data) >= src.length() * target / chunks) {
+                    cuts.push_back(p - data);
+                    while (target < chunks && src.length() * target / chunks <= cuts.back()) target++;
+                }
+                break;
+
+            case '"':
+                for (p++; (p = scan::find_quote_or_escape(p, end)) < end; ) {
+                    if (*p == '"') { p++; break; }
+                    p = end - p > 2 ? p + 2 : end;
+                }
+                break;
+
+            case '\'':
+                // Mirrors the lexer: an optional backslash, the character, the quote
+                p++;
+                if (p < end && *p == '\\') p++;
+                if (p < end) p++;
+                if (p < end && *p == '\'') p++;
+                break;
+
+            default: // '/'
+                if (end - p > 1 && p[1] == '/') {
+                    p = scan::find_char(p + 2, end, '\n'); // the newline is a cut candidate
+                } else if (end - p > 1 && p[1] == '*') {
+                    std::size_t newlines = 0;
+                    const char* close = scan::find_comment_end(p + 2, end, newlines);
+                    p = close == end ? end : close + 2;
+                } else {
+                    p++;
+                }
+                break;
+        }
+    }
+
+    cuts.push_back(src.length());
+    return cuts;
+}
+
+std::vector<Token> tokenize_parallel(std::string_view src, unsigned threads)
+{
+    std::vector<std::size_t> cuts = chunk_boundaries(src, threads);
+    std::size_t chunks = cuts.size() - 1;
+    if (chunks <= 1) return tokenize(src);
+
+    // Every chunk counts its lines from 0, they are rebased once all are done
+    std::vector<std::vector<Token>> parts(chunks);
+    std::vector<std::size_t> newlines(chunks, 0);
+    std::vector<char> failed(chunks, 0);
+
+    auto lex_chunk = [&](std::size_t k) {
+        parts[k].reserve((cuts[k + 1] - cuts[k]) / 8);
+        try {
+            newlines[k] = lex_range(src, cuts[k], cuts[k + 1], 0, parts[k], true);
+        } catch (const LexError&) {
+            failed[k] = 1;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (std::size_t k = 1; k < chunks; k++) workers.emplace_back(lex_chunk, k);
+    lex_chunk(0);
+    for (std::thread& t : workers) t.join();
+
+    // Lex errors are rare, relexing sequentially reports the first one
+    // with its message and line exactly as tokenize() would
+    for (char f : failed) {
+        if (f) return tokenize(src);
+    }
+
+    std::size_t total = 1;
+    for (const auto& part : parts) total += part.size();
+
+    std::vector<Token> tokens;
+    tokens.reserve(total);
+
+    std::size_t line = 1;
+    for (std::size_t k = 0; k < chunks; k++) {
+        for (Token tok : parts[k]) {
+            tok.line += static_cast<uint32_t>(line);
+            tokens.push_back(tok);
+        }
+        line += newlines[k];
+        std::vector<Token>().swap(parts[k]);
+    }
+
+    tokens.emplace_back(TokenType::EoF, src.length(), 0, line);
+    return tokens;
+}
+
+std::string unescape(std::string_view text)
+{
+    std::string str;
+    str.reserve(text.length());
+
+    for (std::size_t i = 0; i < text.length(); i++) {
+        if (text[i] != '\\' || i + 1 >= text.length()) {
+            str += text[i];
+            continue;
+        }
+
+        switch (text[++i]) {
+            case 'n': str += '\n'; break;
+            case 't': str += '\t'; break;
+            default:  str += text[i]; break; // '"' and '\\'
+        }
+    }
+
+    return str;
+}
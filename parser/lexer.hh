@@ -6,14 +6,17 @@ lexer.hh
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 #include <unordered_map>
 
 // TokenType enum. What tokens we support in our language
-enum TokenType {
-    Number,
+enum TokenType : uint8_t {
+    IntNumber,
+    FloatNumber,
     Identifier,
     String,
     Character,
@@ -74,18 +77,78 @@ enum TokenType {
     EoF // This is for letting us know where the file ends. EndOfFILE
 };
 
+// Operators, resolved once while lexing and carried into the AST
+enum class OpKind : uint8_t {
+    None,
+
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+
+    Eq,
+    Neq,
+    Gt,
+    Gte,
+    Lt,
+    Lte,
+
+    And,
+    Or,
+
+    Not,
+    Inc,
+    Dec,
+    Amp,
+};
+
+// Source spelling of an operator, for error messages and AST dumps
+const char* op_str(OpKind op);
 
-extern std::unordered_map<std::string, TokenType> keywords;
+// Keyword token type of 'ident', or Identifier. Allocation free and
+// stateless, backed by a constexpr perfect hash.
+TokenType keyword_type(std::string_view ident);
 
-// This will shape our tokens. Every token has a value and a type
+// This will shape our tokens. A token does not own its text: it is the
+// [offset, offset + length) range of the source buffer, which has to outlive
+// the tokens. String and character tokens cover the text between the quotes.
 struct Token {
-    std::string value;
+    // Numeric literals are converted once while lexing, character literals
+    // keep their (unescaped) value in int_value
+    union {
+        int int_value = 0;      // IntNumber (at most INT32_MAX), Character
+        double float_value;     // FloatNumber
+    };
+
+    uint32_t offset;
+    uint32_t length;
+    uint32_t line;
     TokenType type;
-    std::size_t line;
+    OpKind op = OpKind::None;
+    bool escaped = false;       // String containing escape sequences, see unescape()
 
     // Constructor
-    Token(std::string v, TokenType t, std::size_t l) : value(std::move(v)), type(t), line(l) {};
+    Token(TokenType t, std::size_t off, std::size_t len, std::size_t l, OpKind o = OpKind::None)
+        : offset(static_cast<uint32_t>(off)), length(static_cast<uint32_t>(len)), line(static_cast<uint32_t>(l)), type(t), op(o) {};
+
+    std::string_view text(std::string_view src) const { return src.substr(offset, length); }
 };
 
-// This function takes in input a string (our file given in main.cc) and it outputs a vector of tokens
-std::vector<Token> tokenize(const std::string &src);
+static_assert(sizeof(Token) == 24, "Token should stay three words wide");
+
+// This function takes in input the source (our file given in main.cc) and it outputs a vector of tokens
+std::vector<Token> tokenize(std::string_view src);
+
+// Cut points for lexing 'src' in up to 'chunks' pieces: 0, then line
+// starts outside strings, character literals and comments near every
+// len / chunks bytes, then src.length()
+std::vector<std::size_t> chunk_boundaries(std::string_view src, std::size_t chunks);
+
+// Same tokens as tokenize(), the chunks are lexed on 'threads' threads and
+// stitched together with their line numbers rebased. Sources containing a
+// lex error are relexed sequentially so the error report is unchanged.
+std::vector<Token> tokenize_parallel(std::string_view src, unsigned threads);
+
+// Resolves the escape sequences of a string token's text
+std::string unescape(std::string_view text);
@@ -1,12 +1,16 @@
 #include "parser.hh"
 
 #include "../utils/error.hh"
+#include "../utils/int_ops.hh"
 
-#include <iostream>
+#include <array>
 #include <cmath>
+#include <iostream>
 
-Parser::Parser(std::vector<Token>& tokens) {
-    this->tokens = tokens;
+Parser::Parser(std::string_view src, std::vector<Token> tokens) : src(src), tokens(std::move(tokens))
+{
+    // Roughly one node per token
+    this->ast.nodes.reserve(this->tokens.size());
 }
 
 bool Parser::not_eof()
@@ -14,17 +18,17 @@ bool Parser::not_eof()
     return this->tokens[this->current].type != TokenType::EoF;
 }
 
-Token Parser::at()
+const Token& Parser::at()
 {
     return this->tokens[this->current];
 }
 
-Token Parser::eat()
+const Token& Parser::eat()
 {
     return this->tokens[this->current++];
 }
 
-Token Parser::expect(TokenType type, const std::string& msg, std::size_t l)
+const Token& Parser::expect(TokenType type, const char* msg, std::size_t l)
 {
     if (this->at().type != type)
         syntax_err(msg, l);
@@ -32,164 +36,268 @@ Token Parser::expect(TokenType type, const std::string& msg, std::size_t l)
     return this->eat();
 }
 
-Token Parser::expect_str(std::string v, const std::string& msg, std::size_t l)
+const Token& Parser::expect_str(std::string_view v, const char* msg, std::size_t l)
 {
-    if (this->at().value != v)
+    if (this->text(this->at()) != v)
         syntax_err(msg, l);
 
     return this->eat();
 }
 
+std::string_view Parser::text(const Token& tok) const
+{
+    if (tok.type == TokenType::EoF) return "EoF";
+    return tok.text(this->src);
+}
+
+/* Node construction */
+
+NodeId Parser::add(NodeType kind, std::size_t line, uint32_t a, uint32_t b, uint32_t c)
+{
+    Node n{kind};
+    n.line = static_cast<uint32_t>(line);
+    n.a = a;
+    n.b = b;
+    n.c = c;
+    return this->ast.add(n);
+}
+
+// Moves the children collected on the scratch stack since 'base' into
+// ast.lists, returns where they start
+uint32_t Parser::flush_list(std::size_t base)
+{
+    uint32_t begin = static_cast<uint32_t>(this->ast.lists.size());
+    this->ast.lists.insert(this->ast.lists.end(), this->scratch.begin() + base, this->scratch.end());
+    this->scratch.resize(base);
+    return begin;
+}
+
 /* Fold constants */
 
-std::shared_ptr<Expr> fold_constants(
-    const std::shared_ptr<Expr>& left,
-    const std::shared_ptr<Expr>& right,
-    const std::string& op,
-    std::size_t line
-) {
-    // Numbers
-    auto lnum = std::dynamic_pointer_cast<ASTNumericLiteral>(left);
-    auto rnum = std::dynamic_pointer_cast<ASTNumericLiteral>(right);
-    if (lnum && rnum) {
-        float result = 0.0f;
-        if (op == "+") result = lnum->value + rnum->value;
-        else if (op == "-") result = lnum->value - rnum->value;
-        else if (op == "*") result = lnum->value * rnum->value;
-        else if (op == "/") result = rnum->value != 0.0f ? lnum->value / rnum->value
-                                                        : throw std::runtime_error("division by zero");
-        else if (op == "%") result = std::fmod(lnum->value, rnum->value);
-        return std::make_shared<ASTNumericLiteral>(result, line);
+static Node bool_literal(bool value, std::size_t line)
+{
+    Node n{NodeType::BoolLiteral};
+    n.line = static_cast<uint32_t>(line);
+    n.a = value;
+    n.c = NO_CONSTANT;
+    return n;
+}
+
+NodeId Parser::fold_constants(NodeId left, NodeId right, OpKind op, std::size_t line)
+{
+    const Node l = this->ast[left];
+    const Node r = this->ast[right];
+
+    auto binary = [&] {
+        NodeId id = this->add(NodeType::BinaryExpr, line, left, right);
+        this->ast[id].op = op;
+        return id;
+    };
+
+    // The operands are usually the last two nodes, the folded literal
+    // takes their place
+    auto literal = [&](const Node& n) {
+        if (right + 1 == this->ast.nodes.size() && left + 1 == right) this->ast.nodes.resize(left);
+        return this->ast.add(n);
+    };
+
+    // Only literal pairs fold, the node kinds rule everything else out
+    if (l.kind != r.kind) return binary();
+
+    // Numbers. Int op Int folds with the runtime's 32-bit int arithmetic,
+    // except '/' which yields a float like it does at runtime; anything else
+    // folds as double.
+    if (l.kind == NodeType::NumericLiteral) {
+        if (l.has(FLAG_INT) && r.has(FLAG_INT)) {
+            int a = Ast::int_value(l), b = Ast::int_value(r);
+            switch (op) {
+                case OpKind::Add: return literal(Ast::number(int_add(a, b), line));
+                case OpKind::Sub: return literal(Ast::number(int_sub(a, b), line));
+                case OpKind::Mul: return literal(Ast::number(int_mul(a, b), line));
+                case OpKind::Mod:
+                    if (b == 0) break;
+                    return literal(Ast::number(int_mod(a, b), line));
+
+                case OpKind::Eq:  return literal(bool_literal(a == b, line));
+                case OpKind::Neq: return literal(bool_literal(a != b, line));
+                case OpKind::Gt:  return literal(bool_literal(a > b, line));
+                case OpKind::Gte: return literal(bool_literal(a >= b, line));
+                case OpKind::Lt:  return literal(bool_literal(a < b, line));
+                case OpKind::Lte: return literal(bool_literal(a <= b, line));
+                default: break;
+            }
+        }
+
+        double a = Ast::as_double(l), b = Ast::as_double(r);
+        switch (op) {
+            case OpKind::Add: return literal(Ast::number(a + b, line));
+            case OpKind::Sub: return literal(Ast::number(a - b, line));
+            case OpKind::Mul: return literal(Ast::number(a * b, line));
+            case OpKind::Div:
+                if (b == 0.0) throw std::runtime_error("division by zero");
+                return literal(Ast::number(a / b, line));
+            case OpKind::Mod:
+                // Int % 0 is left to the runtime
+                if (l.has(FLAG_INT) && r.has(FLAG_INT)) break;
+                return literal(Ast::number(std::fmod(a, b), line));
+
+            case OpKind::Eq:  return literal(bool_literal(a == b, line));
+            case OpKind::Neq: return literal(bool_literal(a != b, line));
+            case OpKind::Gt:  return literal(bool_literal(a > b, line));
+            case OpKind::Gte: return literal(bool_literal(a >= b, line));
+            case OpKind::Lt:  return literal(bool_literal(a < b, line));
+            case OpKind::Lte: return literal(bool_literal(a <= b, line));
+
+            // Logical operators on numbers are left to the runtime
+            default: break;
+        }
+        return binary();
     }
 
     // Strings
-    auto lstr = std::dynamic_pointer_cast<ASTStringLiteral>(left);
-    auto rstr = std::dynamic_pointer_cast<ASTStringLiteral>(right);
-    if (lstr && rstr && op == "+") {
-        return std::make_shared<ASTStringLiteral>(lstr->value + rstr->value, line);
+    if (l.kind == NodeType::StringLiteral && op == OpKind::Add) {
+        Node n = l;
+        n.line = static_cast<uint32_t>(line);
+        n.a = this->ast.intern(this->ast.name(l.a) + this->ast.name(r.a));
+        return literal(n);
     }
 
     // Booleans
-    auto lbool = std::dynamic_pointer_cast<ASTBoolLiteral>(left);
-    auto rbool = std::dynamic_pointer_cast<ASTBoolLiteral>(right);
-    if (lbool && rbool) {
-        bool result = false;
-        if (op == "&&") result = lbool->value && rbool->value;
-        else if (op == "||") result = lbool->value || rbool->value;
-        return std::make_shared<ASTBoolLiteral>(result, line);
+    if (l.kind == NodeType::BoolLiteral) {
+        bool a = l.a != 0, b = r.a != 0;
+        switch (op) {
+            case OpKind::And: return literal(bool_literal(a && b, line));
+            case OpKind::Or:  return literal(bool_literal(a || b, line));
+            case OpKind::Eq:  return literal(bool_literal(a == b, line));
+            case OpKind::Neq: return literal(bool_literal(a != b, line));
+            default: break;
+        }
     }
 
     // Return a normal binary expression
-    return std::make_shared<ASTBinaryExpr>(left, right, op, line);
+    return binary();
 }
 
 /* ------------------------------------------------------------------- */
 
-std::shared_ptr<Expr> Parser::parse_primary_expr()
+NodeId Parser::parse_primary_expr()
 {
     switch (this->tokens[current].type) {
-        case TokenType::Number:
+        case TokenType::IntNumber:
         {
-            Token tok = this->eat();
-            return std::make_shared<ASTNumericLiteral>(std::stof(tok.value), tok.line);
+            const Token& tok = this->eat();
+            return this->ast.add(Ast::number(tok.int_value, tok.line));
+        }
+        case TokenType::FloatNumber:
+        {
+            const Token& tok = this->eat();
+            return this->ast.add(Ast::number(tok.float_value, tok.line));
         }
         case TokenType::Identifier:
         {
-            Token tok = this->eat();
-            return std::make_shared<ASTIdentifierLiteral>(tok.value, tok.line);
+            const Token& tok = this->eat();
+            NodeId id = this->add(NodeType::IdentifierLiteral, tok.line, this->ast.intern(text(tok)));
+            this->ast.set_slot(this->ast[id], ScopeSlot{});
+            return id;
         }
         case TokenType::String:
         {
-            Token tok = this->eat();
-            return std::make_shared<ASTStringLiteral>(tok.value, tok.line);
+            const Token& tok = this->eat();
+            // Only strings with escapes need a second pass over their text
+            std::string_view raw = text(tok);
+            NameId str = tok.escaped ? this->ast.intern(unescape(raw)) : this->ast.intern(raw);
+            return this->add(NodeType::StringLiteral, tok.line, str, 0, NO_CONSTANT);
         }
         case TokenType::Character:
         {
-            Token tok = this->eat();
-            return std::make_shared<ASTCharLiteral>(tok.value[0], tok.line);
+            const Token& tok = this->eat();
+            return this->add(NodeType::CharLiteral, tok.line, static_cast<uint8_t>(tok.int_value), 0, NO_CONSTANT);
         }
         case TokenType::LeftParen:
         {
-            Token tok = this->eat();
+            const Token& tok = this->eat();
             auto expr = this->parse_expr();
             this->expect(TokenType::RightParen, "expected ')' after expression.", tok.line);
             return expr;
         }
         case TokenType::NullTok:
         {
-            Token tok = this->eat();
-            return std::make_shared<ASTNullLiteral>(tok.line);
+            const Token& tok = this->eat();
+            return this->add(NodeType::NullLiteral, tok.line);
         }
         case TokenType::TrueTok:
         case TokenType::FalseTok: {
-            Token tok = this->eat();
-            return std::make_shared<ASTBoolLiteral>((tok.value == "true"), tok.line);
+            const Token& tok = this->eat();
+            return this->ast.add(bool_literal(tok.type == TokenType::TrueTok, tok.line));
         }
         case TokenType::CastTok:
         {
             // var x: int = static_cast<string>();
-            Token tok = this->eat();
+            const Token& tok = this->eat();
 
             this->expect_str("<", "expected '<' to specify cast target type", tok.line);
-            std::string target = this->expect(TokenType::DataType, "expected type after cast", tok.line).value;
+            NameId target = this->ast.intern(text(this->expect(TokenType::DataType, "expected type after cast", tok.line)));
             this->expect_str(">", "expected '>' after cast target type", tok.line);
-            
+
             this->expect(TokenType::LeftParen, "expected '(' to specify cast operand", tok.line);
             auto operand = this->parse_expr();
             this->expect(TokenType::RightParen, "expected ')' to close cast method", tok.line);
 
-            return std::make_shared<ASTCastExpr>(target, operand, tok.line);
+            return this->add(NodeType::CastExpr, tok.line, target, operand);
         }
         default:
-        {   
-            const std::string err = "unexpected token found while parsing: " + this->tokens[current].value;
+        {
+            const std::string err = "unexpected token found while parsing: " + std::string(text(this->at()));
             syntax_err(err, this->at().line);
         }
     }
 
-    return nullptr;
+    return NO_NODE;
 }
 
-std::shared_ptr<Expr> Parser::parse_member_expr(std::shared_ptr<Expr> expr) {
+NodeId Parser::parse_member_expr(NodeId expr) {
     while (true) {
         if (this->at().type == TokenType::LeftBracket) {
             // Array indexing
             this->eat();
             auto index = parse_expr();
-            this->expect(TokenType::RightBracket, "expected ']' after array index", index->line);
-            expr = std::make_shared<ASTMemberExpr>(expr, index, true, index->line);
+            std::size_t line = this->ast[index].line;
+            this->expect(TokenType::RightBracket, "expected ']' after array index", line);
+            expr = this->add(NodeType::MemberExpr, line, expr, index);
+            this->ast[expr].flags = FLAG_COMPUTED;
         } else break;
     }
 
     return expr;
 }
 
-std::shared_ptr<Expr> Parser::parse_call_expr(std::shared_ptr<Expr> expr) {
+NodeId Parser::parse_call_expr(NodeId expr) {
     while (true) {
         if (this->at().type == TokenType::LeftParen) {
 
-            Token start = this->eat();
-            std::vector<std::shared_ptr<Expr>> args;
+            const Token& start = this->eat();
+            std::size_t base = this->scratch.size();
 
             if (this->at().type != TokenType::RightParen) {
                 if (this->at().type == TokenType::LeftBrace) {
-                    args.push_back(parse_array_literal());
+                    this->scratch.push_back(parse_array_literal());
                 } else {
-                    args.push_back(parse_expr());
+                    this->scratch.push_back(parse_expr());
                 }
                 while (this->at().type == TokenType::Comma) {
                     this->eat();
                     if (this->at().type == TokenType::LeftBrace) {
-                        args.push_back(parse_array_literal());
+                        this->scratch.push_back(parse_array_literal());
                     } else {
-                        args.push_back(parse_expr());
+                        this->scratch.push_back(parse_expr());
                     }
                 }
             }
 
             this->expect(TokenType::RightParen, "expected ')' after call arguments", start.line);
 
-            expr = std::make_shared<ASTCallExpr>(expr, args, start.line);
+            uint32_t count = static_cast<uint32_t>(this->scratch.size() - base);
+            expr = this->add(NodeType::CallExpr, start.line, expr, flush_list(base), count);
         }
         else break;
     }
@@ -198,14 +306,16 @@ std::shared_ptr<Expr> Parser::parse_call_expr(std::shared_ptr<Expr> expr) {
 }
 
 
-std::shared_ptr<Expr> Parser::parse_unary_expr() {
+NodeId Parser::parse_unary_expr() {
     // Prefix unary operators
     if (this->at().type == TokenType::UnaryOP || this->at().type == TokenType::Plus || this->at().type == TokenType::Minus ||
         this->at().type == TokenType::Star || this->at().type == TokenType::Ampersand) {
-        Token tok = this->eat();
-        std::string op = tok.value;
+        const Token& tok = this->eat();
         auto operand = parse_unary_expr();
-        return std::make_shared<ASTUnaryExpr>(operand, op, true, tok.line);
+        NodeId id = this->add(NodeType::UnaryExpr, tok.line, operand);
+        this->ast[id].op = tok.op;
+        this->ast[id].flags = FLAG_PREFIX;
+        return id;
     }
 
     auto left = parse_primary_expr();
@@ -213,122 +323,87 @@ std::shared_ptr<Expr> Parser::parse_unary_expr() {
     left = parse_call_expr(left);
 
     // Postfix unary operators
-    if (this->at().type == TokenType::UnaryOP && (this->at().value == "++" || this->at().value == "--")) {
-        Token tok = this->eat();
-        std::string op = tok.value;
-        return std::make_shared<ASTUnaryExpr>(left, op, false, tok.line);
-    }
-
-    return left;
-}
-
-
-std::shared_ptr<Expr> Parser::parse_multiplicative_expr()
-{
-    auto left = this->parse_unary_expr();
-
-    while (this->at().type == TokenType::Star || this->at().type == TokenType::Slash || this->at().type == TokenType::Modulus)
-    {
-        Token tok = this->eat();
-        std::string op = tok.value;
-        auto right = this->parse_unary_expr();
-        left = fold_constants(left, right, op, tok.line);
+    if (this->at().op == OpKind::Inc || this->at().op == OpKind::Dec) {
+        const Token& tok = this->eat();
+        NodeId id = this->add(NodeType::UnaryExpr, tok.line, left);
+        this->ast[id].op = tok.op;
+        return id;
     }
 
     return left;
 }
 
-std::shared_ptr<Expr> Parser::parse_additive_expr()
+/* Binary operators */
+
+// Binding powers, loosest first. '=' sits between the comparisons and the
+// additive operators and is the only right associative one.
+enum : uint8_t {
+    BP_NONE,
+    BP_OR,
+    BP_AND,
+    BP_EQUALITY,
+    BP_COMPARISON,
+    BP_ASSIGN,
+    BP_ADDITIVE,
+    BP_MULTIPLICATIVE,
+};
+
+constexpr std::array<uint8_t, 256> make_binding_powers()
 {
-   auto left = this->parse_multiplicative_expr(); 
-
-    while (this->at().type == TokenType::Plus || this->at().type == TokenType::Minus)
-    {
-        Token tok = this->eat();
-        std::string op = tok.value;
-        auto right = this->parse_multiplicative_expr();
-        left = fold_constants(left, right, op, tok.line);
-    }
-   return left;
+    std::array<uint8_t, 256> bp{};
+    bp[static_cast<uint8_t>(OpKind::Or)]  = BP_OR;
+    bp[static_cast<uint8_t>(OpKind::And)] = BP_AND;
+    bp[static_cast<uint8_t>(OpKind::Eq)]  = BP_EQUALITY;
+    bp[static_cast<uint8_t>(OpKind::Neq)] = BP_EQUALITY;
+    bp[static_cast<uint8_t>(OpKind::Gt)]  = BP_COMPARISON;
+    bp[static_cast<uint8_t>(OpKind::Gte)] = BP_COMPARISON;
+    bp[static_cast<uint8_t>(OpKind::Lt)]  = BP_COMPARISON;
+    bp[static_cast<uint8_t>(OpKind::Lte)] = BP_COMPARISON;
+    bp[static_cast<uint8_t>(OpKind::Add)] = BP_ADDITIVE;
+    bp[static_cast<uint8_t>(OpKind::Sub)] = BP_ADDITIVE;
+    bp[static_cast<uint8_t>(OpKind::Mul)] = BP_MULTIPLICATIVE;
+    bp[static_cast<uint8_t>(OpKind::Div)] = BP_MULTIPLICATIVE;
+    bp[static_cast<uint8_t>(OpKind::Mod)] = BP_MULTIPLICATIVE;
+    return bp;
 }
 
-std::shared_ptr<Expr> Parser::parse_assignment_expr()
-{
-    auto left = this->parse_additive_expr();
-
-    while (this->at().type == TokenType::Equals)
-    {
-        Token tok = this->eat();
-        auto right = this->parse_assignment_expr();
-        left = std::make_shared<ASTAssignExpr>(left, right, tok.line);
-    }
-
-    return left;
-}
+constexpr std::array<uint8_t, 256> binding_powers = make_binding_powers();
 
-std::shared_ptr<Expr> Parser::parse_comparison_expr()
+// Binding power of 'tok' in infix position, BP_NONE ends the expression
+static uint8_t infix_power(const Token& tok)
 {
-    auto left = this->parse_assignment_expr();
-
-    while (this->at().type == TokenType::BinaryOP &&
-           (this->at().value == ">" || this->at().value == "<" ||
-            this->at().value == ">=" || this->at().value == "<="))
-    {
-        Token tok = this->eat();
-        std::string op = tok.value;
-        auto right = this->parse_assignment_expr();
-        left = fold_constants(left, right, op, tok.line);
-    }
-
-    return left;
+    if (tok.type == TokenType::Equals) return BP_ASSIGN;
+    return binding_powers[static_cast<uint8_t>(tok.op)];
 }
 
-std::shared_ptr<Expr> Parser::parse_equality_expr()
+// Pratt loop: parses a unary operand, then folds in every infix operator
+// that binds at least as tightly as 'min_power'
+NodeId Parser::parse_binary_expr(uint8_t min_power)
 {
-	auto left = this->parse_comparison_expr();
-	while (this->at().type == TokenType::BinaryOP && (this->at().value == "==" || this->at().value == "!="))
-	{
-		Token tok = this->eat();
-		std::string op = tok.value;
-		auto right = this->parse_comparison_expr();
-		left = fold_constants(left, right, op, tok.line);
-	}
-	return left;
-}
+    auto left = this->parse_unary_expr();
 
-std::shared_ptr<Expr> Parser::parse_logical_and_expr()
-{
-    auto left = this->parse_equality_expr();
-    while (this->at().type == TokenType::BinaryOP && this->at().value == "&&")
+    for (uint8_t power; (power = infix_power(this->at())) != BP_NONE && power >= min_power; )
     {
-      Token tok = this->eat();
-      std::string op = tok.value;
-      auto right = this->parse_equality_expr();
-      left = fold_constants(left, right, op, tok.line);
-    }
-  return left;
-}
+        const Token& tok = this->eat();
 
-std::shared_ptr<Expr> Parser::parse_logical_or_expr()
-{
-    auto left = this->parse_logical_and_expr();
-    while (this->at().type == TokenType::BinaryOP && this->at().value == "||")
-    {
-      Token tok = this->eat();
-      std::string op = tok.value;
-      auto right = this->parse_logical_and_expr();
-      left = fold_constants(left, right, op, tok.line);
+        if (power == BP_ASSIGN) {
+            auto right = this->parse_binary_expr(BP_ASSIGN);
+            left = this->add(NodeType::AssignmentExpr, tok.line, left, right);
+        } else {
+            auto right = this->parse_binary_expr(power + 1);
+            left = fold_constants(left, right, tok.op, tok.line);
+        }
     }
 
     return left;
 }
 
-std::shared_ptr<Expr> Parser::parse_expr()
+NodeId Parser::parse_expr()
 {
-    return this->parse_logical_or_expr();
+    return this->parse_binary_expr(BP_OR);
 }
 
-std::shared_ptr<Expr> Parser::parse_array_element()
+NodeId Parser::parse_array_element()
 {
     if (this->at().type == TokenType::LeftBrace) {
         return this->parse_array_literal();
@@ -338,26 +413,26 @@ std::shared_ptr<Expr> Parser::parse_array_element()
 }
 
 
-std::shared_ptr<Expr> Parser::parse_array_literal()
+NodeId Parser::parse_array_literal()
 {
     if (this->at().type == TokenType::NullTok) {
-        Token tok = this->eat();
-        return std::make_shared<ASTNullLiteral>(tok.line);
+        const Token& tok = this->eat();
+        return this->add(NodeType::NullLiteral, tok.line);
     }
 
-    Token start = this->expect(TokenType::LeftBrace,
+    const Token& start = this->expect(TokenType::LeftBrace,
         "expected '{' to start array literal.",
         this->at().line);
 
-    std::vector<std::shared_ptr<Expr>> elements;
+    std::size_t base = this->scratch.size();
 
     // Empty array "{}"
     if (this->at().type == TokenType::RightBrace) {
         this->eat();
-        return std::make_shared<ASTArrayLiteral>(elements, start.line);
+        return this->add(NodeType::ArrayLiteral, start.line, flush_list(base), 0);
     }
 
-    elements.push_back(this->parse_array_element());
+    this->scratch.push_back(this->parse_array_element());
 
     while (this->at().type == TokenType::Comma)
     {
@@ -366,7 +441,7 @@ std::shared_ptr<Expr> Parser::parse_array_literal()
         if (this->at().type == TokenType::RightBrace)
             break;
 
-        elements.push_back(this->parse_array_element());
+        this->scratch.push_back(this->parse_array_element());
     }
 
     // Expect final '}'
@@ -374,11 +449,12 @@ std::shared_ptr<Expr> Parser::parse_array_literal()
                  "expected '}' to close array literal.",
                  start.line);
 
-    return std::make_shared<ASTArrayLiteral>(elements, start.line);
+    uint32_t count = static_cast<uint32_t>(this->scratch.size() - base);
+    return this->add(NodeType::ArrayLiteral, start.line, flush_list(base), count);
 }
 
 
-std::shared_ptr<Stmt> Parser::parse_var_declaration()
+NodeId Parser::parse_var_declaration()
 {
     std::size_t decl_line = this->at().line;
     bool is_const = this->at().type == TokenType::ConstTok;
@@ -386,33 +462,33 @@ std::shared_ptr<Stmt> Parser::parse_var_declaration()
     if (is_const) this->eat();
 
     this->eat();
-    std::string name = this->expect(TokenType::Identifier, "expected variable name after 'var'", decl_line).value;
+    AstVarDecl var;
+    var.name = this->ast.intern(text(this->expect(TokenType::Identifier, "expected variable name after 'var'", decl_line)));
 
     this->expect(TokenType::Colon, "expected ':' after variable name", decl_line);
-    std::string type = this->expect(TokenType::DataType, "expected variable type following ':'", decl_line).value;
+    std::string_view type = text(this->expect(TokenType::DataType, "expected variable type following ':'", decl_line));
+    var.type = this->ast.intern(type);
 
-    std::optional<std::shared_ptr<Expr>> size_array = std::nullopt;
     if (this->at().type == TokenType::LeftBracket)
-    {   
+    {
         this->eat();
         is_array = true;
 
         if (this->at().type != TokenType::RightBracket)
-        {   
-            size_array = this->parse_expr();
+        {
+            var.array_size = this->parse_expr();
         }
         this->expect(TokenType::RightBracket, "expected ']' to close array size specifier.", decl_line);
     }
 
-    std::shared_ptr<Expr> value = nullptr;
     if (this->at().type == TokenType::Equals)
     {
         this->eat();
 
         if (this->at().type == TokenType::LeftBrace)
-            value = this->parse_array_literal();
+            var.value = this->parse_array_literal();
         else
-            value = this->parse_expr();
+            var.value = this->parse_expr();
     }
     else
     {
@@ -425,12 +501,16 @@ std::shared_ptr<Stmt> Parser::parse_var_declaration()
         }
     }
     this->expect(TokenType::Semicolon, "expected ';' after variable declaration", decl_line);
-    return std::make_shared<ASTVarDecl>(name, type, value, is_const, is_array, size_array, decl_line);
+
+    this->ast.vars.push_back(var);
+    NodeId id = this->add(NodeType::VarDeclaration, decl_line, static_cast<uint32_t>(this->ast.vars.size() - 1));
+    this->ast[id].flags = (is_const ? FLAG_CONST : 0) | (is_array ? FLAG_ARRAY : 0);
+    return id;
 }
 
-std::shared_ptr<Stmt> Parser::parse_while_stmt()
+NodeId Parser::parse_while_stmt()
 {
-    Token tok = this->eat();
+    const Token& tok = this->eat();
 
     this->expect(TokenType::LeftParen, "expected '(' after 'while'", tok.line);
     auto condition = this->parse_expr();
@@ -440,12 +520,12 @@ std::shared_ptr<Stmt> Parser::parse_while_stmt()
     auto doBranch = this->parse_block(tok.line);
     this->expect(TokenType::RightBrace, "expected '}' to close while body", tok.line);
 
-    return std::make_shared<ASTWhileStmt>(condition, doBranch, tok.line);
+    return this->add(NodeType::WhileStmt, tok.line, condition, doBranch);
 }
 
-std::shared_ptr<Stmt> Parser::parse_if_stmt()
+NodeId Parser::parse_if_stmt()
 {
-    Token tok = this->eat();
+    const Token& tok = this->eat();
 
     this->expect(TokenType::LeftParen, "expected '(' after 'if'", tok.line);
     auto condition = this->parse_expr();
@@ -455,7 +535,7 @@ std::shared_ptr<Stmt> Parser::parse_if_stmt()
     auto thenBranch = this->parse_block(tok.line);
     this->expect(TokenType::RightBrace, "expected '}' to close if body", tok.line);
 
-    std::optional<std::shared_ptr<ASTBlockStmt>> elseBranch = std::nullopt;
+    NodeId elseBranch = NO_NODE;
 
     if (this->at().type == TokenType::ElseTok)
     {
@@ -463,27 +543,25 @@ std::shared_ptr<Stmt> Parser::parse_if_stmt()
 
         if (this->at().type == TokenType::IfTok)
         {
-            elseBranch = std::static_pointer_cast<ASTBlockStmt>(
-                this->parse_if_stmt()
-            );
+            elseBranch = this->parse_if_stmt();
         }
         else
         {
             this->expect(TokenType::LeftBrace, "expected '{' to start else body", tok.line);
-            elseBranch = std::static_pointer_cast<ASTBlockStmt>(this->parse_block(tok.line));
+            elseBranch = this->parse_block(tok.line);
             this->expect(TokenType::RightBrace, "expected '}' to close else body", tok.line);
         }
     }
 
-    return std::make_shared<ASTIfStmt>(condition, thenBranch, elseBranch, tok.line);
+    return this->add(NodeType::IfStmt, tok.line, condition, thenBranch, elseBranch);
 }
 
-std::shared_ptr<Stmt> Parser::parse_for_stmt() {
-    Token tok = this->eat(); // consume 'for'
+NodeId Parser::parse_for_stmt() {
+    const Token& tok = this->eat(); // consume 'for'
     this->expect(TokenType::LeftParen, "expected '(' after 'for'", tok.line);
 
     // Init: variable declaration or expression statement
-    std::shared_ptr<Stmt> init = nullptr;
+    NodeId init = NO_NODE;
     if (this->at().type != TokenType::Semicolon) {
         if (this->at().type == TokenType::VarTok || this->at().type == TokenType::ConstTok) {
             init = this->parse_var_declaration();
@@ -497,78 +575,86 @@ std::shared_ptr<Stmt> Parser::parse_for_stmt() {
     }
 
     // Condition
-    std::shared_ptr<Expr> condition = nullptr;
+    NodeId condition = NO_NODE;
     if (this->at().type != TokenType::Semicolon) {
         condition = this->parse_expr();
     }
     this->expect(TokenType::Semicolon, "expected ';' after for loop condition", tok.line);
 
     // Update
-    std::shared_ptr<Expr> update = nullptr;
+    NodeId update = NO_NODE;
     if (this->at().type != TokenType::RightParen) {
         update = this->parse_expr();
     }
     this->expect(TokenType::RightParen, "expected ')' after for loop update", tok.line);
 
     // Body
-    std::shared_ptr<Stmt> body;
     this->expect(TokenType::LeftBrace, "expected '{' to start for loop body", tok.line);
-    body = this->parse_block(tok.line);
+    NodeId body = this->parse_block(tok.line);
     this->expect(TokenType::RightBrace, "expected '}' after for loop body", tok.line);
 
-    return std::make_shared<ASTForStmt>(init, condition, update, body, tok.line);
+    uint32_t rest = static_cast<uint32_t>(this->ast.lists.size());
+    this->ast.lists.push_back(update);
+    this->ast.lists.push_back(body);
+
+    return this->add(NodeType::ForStmt, tok.line, init, condition, rest);
 }
 
-std::shared_ptr<Stmt> Parser::parse_func_stmt()
+NodeId Parser::parse_func_stmt()
 {
-    Token tok = this->eat();
+    const Token& tok = this->eat();
 
-    std::string name = this->expect(TokenType::Identifier, "expected function name after 'func'", tok.line).value;
+    AstFunction fn;
+    fn.name = this->ast.intern(text(this->expect(TokenType::Identifier, "expected function name after 'func'", tok.line)));
 
     this->expect(TokenType::LeftParen, "expected '(' to open function parameters", tok.line);
-    auto params = this->parse_func_params(tok.line);
+    fn.params_begin = static_cast<uint32_t>(this->ast.params.size());
+    this->parse_func_params(tok.line);
+    fn.params_count = static_cast<uint32_t>(this->ast.params.size()) - fn.params_begin;
     this->expect(TokenType::RightParen, "expected ')' to close function parameters", tok.line);
 
     this->expect(TokenType::Arrow, "expected '->' to declare function return type", tok.line);
-    Token ret_tok = this->eat();
+    const Token& ret_tok = this->eat();
 
     if (ret_tok.type != TokenType::DataType && ret_tok.type != TokenType::VoidTok) {
         syntax_err("expected function return type after '->'", ret_tok.line);
     }
 
-    std::string ret_type = ret_tok.value;
+    std::string_view ret_type = text(ret_tok);
 
     if (ret_type == "auto") {
         syntax_err("function return type cannot be 'auto'", tok.line);
      }
+    fn.ret_type = this->ast.intern(ret_type);
 
     this->expect(TokenType::LeftBrace, "expected '{' to start function body", tok.line);
-    auto body = this->parse_block(tok.line);
+    fn.body = this->parse_block(tok.line);
     this->expect(TokenType::RightBrace, "expected '}' to close function body", tok.line);
 
-    return std::make_shared<ASTFunctionStmt>(name, ret_type, params, body, tok.line);
+    this->ast.functions.push_back(fn);
+    return this->add(NodeType::FunctionStmt, tok.line, static_cast<uint32_t>(this->ast.functions.size() - 1));
 }
 
 
-std::vector<std::shared_ptr<ASTParam>> Parser::parse_func_params(std::size_t line)
+void Parser::parse_func_params(std::size_t line)
 {
-    std::vector<std::shared_ptr<ASTParam>> params;
-
     while (this->not_eof() && this->at().type != TokenType::RightParen)
     {
         this->expect(TokenType::VarTok, "expected 'var' for function parameter", line);
-        std::string varname = this->expect(TokenType::Identifier, "expected variable name in function parameters", line).value;
+        AstParam param;
+        param.name = this->ast.intern(text(this->expect(TokenType::Identifier, "expected variable name in function parameters", line)));
         this->expect(TokenType::Colon, "expected ':' with variable type in function parameters", line);
-        std::string type = this->expect(TokenType::DataType, "expected variable type in function parameters", line).value;
-        
-        bool is_array = false;
+        param.type = this->ast.intern(text(this->expect(TokenType::DataType, "expected variable type in function parameters", line)));
+
+        param.is_array = false;
         if (this->at().type == TokenType::LeftBracket) {
             this->eat();
             this->expect(TokenType::RightBracket, "expected ']' after array type", line);
-            is_array = true;
+            param.is_array = true;
         }
 
-        params.push_back(std::make_shared<ASTParam>(varname, type, is_array, line));
+        param.line = static_cast<uint32_t>(line);
+        this->ast.params.push_back(param);
 
         if (this->at().type != TokenType::Comma)
         {
@@ -577,22 +663,21 @@ std::vector<std::shared_ptr<ASTParam>> Parser::parse_func_params(std::size_t lin
         this->eat();
         continue;
     }
-
-    return params;
 }
 
-std::shared_ptr<Stmt> Parser::parse_block(std::size_t line)
-{   
-    std::vector<std::shared_ptr<Stmt>> block;
+NodeId Parser::parse_block(std::size_t line)
+{
+    std::size_t base = this->scratch.size();
     while (this->not_eof() && this->at().type != TokenType::RightBrace)
     {
-        block.push_back(this->parse_stmt());
+        this->scratch.push_back(this->parse_stmt());
     }
 
-    return std::make_shared<ASTBlockStmt>(block, line);
+    uint32_t count = static_cast<uint32_t>(this->scratch.size() - base);
+    return this->add(NodeType::BlockStmt, line, flush_list(base), count);
 }
 
-std::shared_ptr<Stmt> Parser::parse_stmt()
+NodeId Parser::parse_stmt()
 {
     switch (this->tokens[current].type)
     {
@@ -609,29 +694,29 @@ std::shared_ptr<Stmt> Parser::parse_stmt()
             return this->parse_func_stmt();
         case TokenType::ContinueTok:
         {
-            Token tok = this->eat();
+            const Token& tok = this->eat();
             this->expect(TokenType::Semicolon, "expected ';' after 'continue'", tok.line);
-            return std::make_shared<ASTContinueStmt>(tok.line);
+            return this->add(NodeType::ContinueStmt, tok.line);
         }
         case TokenType::ReturnTok:
         {
-            Token tok = this->eat();
-            std::shared_ptr<Expr> value = nullptr;
+            const Token& tok = this->eat();
+            NodeId value = NO_NODE;
             if (this->at().type != TokenType::Semicolon) {
                 value = parse_expr();
             }
             this->expect(TokenType::Semicolon, "expected ';' after return statement", tok.line);
-            return std::make_shared<ASTReturnStmt>(value, tok.line);
+            return this->add(NodeType::ReturnStmt, tok.line, value);
         }
         case TokenType::BreakTok:
         {
-            Token tok = this->eat();
+            const Token& tok = this->eat();
             this->expect(TokenType::Semicolon, "expected ';' after 'break'", tok.line);
-            return std::make_shared<ASTBreakStmt>(tok.line);
+            return this->add(NodeType::BreakStmt, tok.line);
         }
         case TokenType::LeftBrace:
         {
-            Token tok = this->eat();
+            const Token& tok = this->eat();
             auto block = this->parse_block(tok.line);
             this->expect(TokenType::RightBrace, "expected '}' to close block statement", tok.line);
             return block;
@@ -640,20 +725,23 @@ std::shared_ptr<Stmt> Parser::parse_stmt()
         {
             auto expr = parse_expr();
             this->expect(TokenType::Semicolon, "expected ';' after expression statement", this->at().line);
-            return std::make_shared<ASTExprStmt>(expr, expr->line);
+            return this->add(NodeType::ExprStmt, this->ast[expr].line, expr);
         }
     }
 }
 
-std::shared_ptr<ASTProgram> Parser::produceAST()
+Ast Parser::produceAST()
 {
-    auto program = std::make_shared<ASTProgram>(std::vector<std::shared_ptr<Stmt>>{}, this->at().line);
+    std::size_t line = this->at().line;
+    std::size_t base = this->scratch.size();
 
     while (not_eof()) // While we are not at the end of the file
     {
-        program->body.push_back(parse_stmt());
+        this->scratch.push_back(parse_stmt());
     }
 
-    return program;
-}
+    uint32_t count = static_cast<uint32_t>(this->scratch.size() - base);
+    this->ast.root = this->add(NodeType::Program, line, flush_list(base), count);
 
+    return std::move(this->ast);
+}
@@ -1,48 +1,53 @@
 #pragma once
 
 #include "lexer.hh"
-#include "ast.hh"
+#include "flat_ast.hh"
 
 #include <memory>
+#include <string_view>
 #include <vector>
 
 class Parser {
 public:
-    Parser(std::vector<Token>& tokens);
-    std::shared_ptr<ASTProgram> produceAST();
+    // 'src' is the buffer the tokens were lexed from, it must outlive the parser
+    Parser(std::string_view src, std::vector<Token> tokens);
+    Ast produceAST();
 
 private:
     bool not_eof();
-    Token at();
-    Token eat();
-    Token expect(TokenType type, const std::string& msg, std::size_t l);
-    Token expect_str(std::string v, const std::string& msg, std::size_t l);
-
-    std::shared_ptr<Stmt> parse_stmt();
-    std::shared_ptr<Stmt> parse_block(std::size_t line);
-    std::shared_ptr<Stmt> parse_if_stmt();
-    std::shared_ptr<Stmt> parse_while_stmt();
-    std::shared_ptr<Stmt> parse_for_stmt();
-    std::shared_ptr<Stmt> parse_var_declaration();
-    std::shared_ptr<Stmt> parse_func_stmt();
-
-    std::vector<std::shared_ptr<ASTParam>> parse_func_params(std::size_t line);
-
-    std::shared_ptr<Expr> parse_expr();
-    std::shared_ptr<Expr> parse_primary_expr();
-    std::shared_ptr<Expr> parse_additive_expr();
-    std::shared_ptr<Expr> parse_multiplicative_expr();
-    std::shared_ptr<Expr> parse_call_expr(std::shared_ptr<Expr> expr);
-    std::shared_ptr<Expr> parse_unary_expr();
-    std::shared_ptr<Expr> parse_logical_or_expr();
-    std::shared_ptr<Expr> parse_logical_and_expr();
-    std::shared_ptr<Expr> parse_equality_expr();
-    std::shared_ptr<Expr> parse_comparison_expr();
-    std::shared_ptr<Expr> parse_assignment_expr();
-    std::shared_ptr<Expr> parse_member_expr(std::shared_ptr<Expr> expr);
-    std::shared_ptr<Expr> parse_array_literal();
-    std::shared_ptr<Expr> parse_array_element();
-
+    const Token& at();
+    const Token& eat();
+    const Token& expect(TokenType type, const char* msg, std::size_t l);
+    const Token& expect_str(std::string_view v, const char* msg, std::size_t l);
+    std::string_view text(const Token& tok) const;
+
+    NodeId add(NodeType kind, std::size_t line, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0);
+    uint32_t flush_list(std::size_t base);
+    NodeId fold_constants(NodeId left, NodeId right, OpKind op, std::size_t line);
+
+    NodeId parse_stmt();
+    NodeId parse_block(std::size_t line);
+    NodeId parse_if_stmt();
+    NodeId parse_while_stmt();
+    NodeId parse_for_stmt();
+    NodeId parse_var_declaration();
+    NodeId parse_func_stmt();
+
+    void parse_func_params(std::size_t line);
+
+    NodeId parse_expr();
+    NodeId parse_binary_expr(uint8_t min_power);
+    NodeId parse_primary_expr();
+    NodeId parse_call_expr(NodeId expr);
+    NodeId parse_unary_expr();
+    NodeId parse_member_expr(NodeId expr);
+    NodeId parse_array_literal();
+    NodeId parse_array_element();
+
+    std::string_view src;
     std::vector<Token> tokens;
     size_t current = 0;
+
+    Ast ast;
+    std::vector<NodeId> scratch; // children of the lists being parsed
 };
@@ -0,0 +1,245 @@
+/*
+
+scan.hh
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Byte-class scanners for the lexer's hot loops. Every scanner walks
+// [p, end) and returns the first byte that stops the scan, or 'end'.
+//
+// scan::scalar classifies one byte at a time through a lookup table.
+// scan::simd classifies a whole block per step (32 bytes with AVX2,
+// 16 with SSE2) and finishes the last partial block with the scalar
+// code. scan:: itself forwards to the widest implementation the build
+// targets; configure with -DRYLANG_NATIVE=ON to enable AVX2.
+namespace scan {
+
+enum : uint8_t {
+    CLASS_SPACE = 1 << 0, // ' ', \t, \n, \v, \f, \r (std::isspace in the C locale)
+    CLASS_IDENT = 1 << 1, // [A-Za-z0-9_]
+    CLASS_ALPHA = 1 << 2, // [A-Za-z]
+};
+
+constexpr std::array<uint8_t, 256> make_class_table()
+{
+    std::array<uint8_t, 256> t{};
+    for (int c = 0; c < 256; c++) {
+        bool alpha = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+        bool digit = c >= '0' && c <= '9';
+        if (c == ' ' || (c >= '\t' && c <= '\r')) t[c] |= CLASS_SPACE;
+        if (alpha || digit || c == '_') t[c] |= CLASS_IDENT;
+        if (alpha) t[c] |= CLASS_ALPHA;
+    }
+    return t;
+}
+
+inline constexpr std::array<uint8_t, 256> class_table = make_class_table();
+
+inline bool is_class(char c, uint8_t cls) { return class_table[static_cast<unsigned char>(c)] & cls; }
+
+namespace scalar {
+
+// Skips whitespace, adding the newlines crossed to 'newlines'
+inline const char* skip_whitespace(const char* p, const char* end, std::size_t& newlines)
+{
+    for (; p < end && is_class(*p, CLASS_SPACE); p++) {
+        if (*p == '\n') newlines++;
+    }
+    return p;
+}
+
+inline const char* skip_ident(const char* p, const char* end)
+{
+    while (p < end && is_class(*p, CLASS_IDENT)) p++;
+    return p;
+}
+
+inline const char* find_char(const char* p, const char* end, char c)
+{
+    while (p < end && *p != c) p++;
+    return p;
+}
+
+// Finds the '*' of the closing "*/", adding the newlines crossed to 'newlines'
+inline const char* find_comment_end(const char* p, const char* end, std::size_t& newlines)
+{
+    for (; p + 1 < end; p++) {
+        if (p[0] == '*' && p[1] == '/') return p;
+        if (p[0] == '\n') newlines++;
+    }
+    return end;
+}
+
+// Finds the closing quote or the next escape of a string body
+inline const char* find_quote_or_escape(const char* p, const char* end)
+{
+    while (p < end && *p != '"' && *p != '\\') p++;
+    return p;
+}
+
+// Finds the next byte that can change the lexer's state: a newline, a
+// quote or the '/' of a comment opener
+inline const char* find_lex_state(const char* p, const char* end)
+{
+    while (p < end && *p != '\n' && *p != '"' && *p != '\'' && *p != '/') p++;
+    return p;
+}
+
+} // namespace scalar
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#define RYLANG_SCAN_SIMD 1
+
+namespace simd {
+
+#if defined(__AVX2__)
+using vec = __m256i;
+using mask_t = uint32_t;
+constexpr std::size_t WIDTH = 32;
+constexpr const char* ISA = "avx2";
+
+inline vec load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const vec*>(p)); }
+inline vec splat(char c) { return _mm256_set1_epi8(c); }
+inline vec eq(vec a, vec b) { return _mm256_cmpeq_epi8(a, b); }
+inline vec any(vec a, vec b) { return _mm256_or_si256(a, b); }
+inline vec both(vec a, vec b) { return _mm256_and_si256(a, b); }
+inline vec sub(vec a, vec b) { return _mm256_sub_epi8(a, b); }
+inline vec umin(vec a, vec b) { return _mm256_min_epu8(a, b); }
+inline mask_t bits(vec a) { return static_cast<mask_t>(_mm256_movemask_epi8(a)); }
+#else
+using vec = __m128i;
+using mask_t = uint32_t;
+constexpr std::size_t WIDTH = 16;
+constexpr const char* ISA = "sse2";
+
+inline vec load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const vec*>(p)); }
+inline vec splat(char c) { return _mm_set1_epi8(c); }
+inline vec eq(vec a, vec b) { return _mm_cmpeq_epi8(a, b); }
+inline vec any(vec a, vec b) { return _mm_or_si128(a, b); }
+inline vec both(vec a, vec b) { return _mm_and_si128(a, b); }
+inline vec sub(vec a, vec b) { return _mm_sub_epi8(a, b); }
+inline vec umin(vec a, vec b) { return _mm_min_epu8(a, b); }
+inline mask_t bits(vec a) { return static_cast<mask_t>(_mm_movemask_epi8(a)); }
+#endif
+
+constexpr mask_t FULL = WIDTH == 32 ? ~mask_t(0) : (mask_t(1) << WIDTH) - 1;
+
+// Bytes in [lo, hi], compared as unsigned
+inline vec in_range(vec x, char lo, char hi)
+{
+    vec d = sub(x, splat(lo));
+    return eq(umin(d, splat(static_cast<char>(hi - lo))), d);
+}
+
+inline mask_t space_bits(vec x) { return bits(any(eq(x, splat(' ')), in_range(x, '\t', '\r'))); }
+
+inline mask_t ident_bits(vec x)
+{
+    vec letter = in_range(any(x, splat(0x20)), 'a', 'z'); // folds upper case onto lower case
+    return bits(any(any(letter, in_range(x, '0', '9')), eq(x, splat('_'))));
+}
+
+inline unsigned first(mask_t m) { return static_cast<unsigned>(__builtin_ctz(m)); }
+inline unsigned count(mask_t m) { return static_cast<unsigned>(__builtin_popcount(m)); }
+inline mask_t below(unsigned n) { return n >= 32 ? ~mask_t(0) : (mask_t(1) << n) - 1; }
+
+inline const char* skip_whitespace(const char* p, const char* end, std::size_t& newlines)
+{
+    while (static_cast<std::size_t>(end - p) >= WIDTH) {
+        vec x = load(p);
+        mask_t stop = ~space_bits(x) & FULL;
+        mask_t nl = bits(eq(x, splat('\n')));
+
+        if (stop) {
+            unsigned n = first(stop);
+            newlines += count(nl & below(n));
+            return p + n;
+        }
+        newlines += count(nl);
+        p += WIDTH;
+    }
+    return scalar::skip_whitespace(p, end, newlines);
+}
+
+inline const char* skip_ident(const char* p, const char* end)
+{
+    while (static_cast<std::size_t>(end - p) >= WIDTH) {
+        mask_t stop = ~ident_bits(load(p)) & FULL;
+        if (stop) return p + first(stop);
+        p += WIDTH;
+    }
+    return scalar::skip_ident(p, end);
+}
+
+inline const char* find_char(const char* p, const char* end, char c)
+{
+    vec needle = splat(c);
+    while (static_cast<std::size_t>(end - p) >= WIDTH) {
+        mask_t hit = bits(eq(load(p), needle));
+        if (hit) return p + first(hit);
+        p += WIDTH;
+    }
+    return scalar::find_char(p, end, c);
+}
+
+inline const char* find_comment_end(const char* p, const char* end, std::size_t& newlines)
+{
+    // Compares every byte with '*' and its successor with '/'
+    while (static_cast<std::size_t>(end - p) > WIDTH) {
+        vec x = load(p);
+        mask_t hit = bits(both(eq(x, splat('*')), eq(load(p + 1), splat('/'))));
+        mask_t nl = bits(eq(x, splat('\n')));
+
+        if (hit) {
+            unsigned n = first(hit);
+            newlines += count(nl & below(n));
+            return p + n;
+        }
+        newlines += count(nl);
+        p += WIDTH;
+    }
+    return scalar::find_comment_end(p, end, newlines);
+}
+
+inline const char* find_quote_or_escape(const char* p, const char* end)
+{
+    while (static_cast<std::size_t>(end - p) >= WIDTH) {
+        vec x = load(p);
+        mask_t hit = bits(any(eq(x, splat('"')), eq(x, splat('\\'))));
+        if (hit) return p + first(hit);
+        p += WIDTH;
+    }
+    return scalar::find_quote_or_escape(p, end);
+}
+
+inline const char* find_lex_state(const char* p, const char* end)
+{
+    while (static_cast<std::size_t>(end - p) >= WIDTH) {
+        vec x = load(p);
+        mask_t hit = bits(any(any(eq(x, splat('\n')), eq(x, splat('"'))),
+                              any(eq(x, splat('\'')), eq(x, splat('/')))));
+        if (hit) return p + first(hit);
+        p += WIDTH;
+    }
+    return scalar::find_lex_state(p, end);
+}
+
+} // namespace simd
+
+using namespace simd;
+#else
+constexpr const char* ISA = "scalar";
+using namespace scalar;
+#endif
+
+} // namespace scan
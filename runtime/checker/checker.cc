@@ -0,0 +1,438 @@
+#include "checker.hh"
+
+#include "../../utils/error.hh"
+
+// Internal result of an operation that rejects every value of its operand types
+constexpr uint8_t TYPE_ERROR = 0xFE;
+
+static std::string type_name(uint8_t type)
+{
+    return vtostr(static_cast<ValueType>(type));
+}
+
+uint8_t type_from_name(const std::string& name)
+{
+    if (name == "int") return VAL_INT;
+    if (name == "float") return VAL_FLOAT;
+    if (name == "bool") return VAL_BOOL;
+    if (name == "string") return VAL_STRING;
+    if (name == "char") return VAL_CHAR;
+    if (name == "null" || name == "void") return VAL_NULL;
+    return NO_TYPE;
+}
+
+// Kind produced by cast(value, target) for a value of kind 'from', see
+// statements.cc. A string only converts to a char when it is not empty,
+// that stays a runtime check.
+static uint8_t cast_result(uint8_t from, uint8_t target)
+{
+    if (from == target || target == VAL_NULL) return target;
+
+    switch (target) {
+        case VAL_INT:
+        case VAL_FLOAT:
+        case VAL_BOOL:
+            return from == VAL_INT || from == VAL_FLOAT || from == VAL_BOOL || from == VAL_CHAR ? target : TYPE_ERROR;
+        case VAL_STRING:
+            return from == VAL_ARRAY || from == VAL_FUNCTION ? TYPE_ERROR : target;
+        case VAL_CHAR:
+            return from == VAL_INT || from == VAL_STRING ? target : TYPE_ERROR;
+        default:
+            return TYPE_ERROR;
+    }
+}
+
+// Kind produced by static_cast_value(value, target), NO_TYPE when it depends
+// on the value (strings that may not parse)
+static uint8_t static_cast_result(uint8_t from, uint8_t target)
+{
+    if (from == NO_TYPE || target == NO_TYPE) return NO_TYPE;
+    if (from == VAL_NULL) {
+        if (target == VAL_CHAR) return VAL_NULL;
+        return target;
+    }
+
+    switch (target) {
+        case VAL_INT:
+        case VAL_FLOAT:
+            if (from == VAL_INT || from == VAL_FLOAT || from == VAL_BOOL) return target;
+            if (from == VAL_STRING) return NO_TYPE;
+            return VAL_NULL;
+        case VAL_BOOL:
+        case VAL_STRING:
+            if (from == VAL_CHAR || from == VAL_FUNCTION) return VAL_NULL;
+            return target;
+        case VAL_CHAR:
+            if (from == VAL_INT || from == VAL_CHAR) return target;
+            if (from == VAL_STRING) return NO_TYPE;
+            return VAL_NULL;
+        default:
+            return VAL_NULL;
+    }
+}
+
+// Kind produced by value_binary(op, a, b), following the dispatch table and
+// the generic kernels in values.cc
+static uint8_t binary_result(OpKind op, uint8_t a, uint8_t b)
+{
+    if (a == VAL_NULL || b == VAL_NULL) return VAL_NULL;
+
+    bool numeric = (a == VAL_INT || a == VAL_FLOAT) && (b == VAL_INT || b == VAL_FLOAT);
+    bool comparison = op >= OpKind::Eq && op <= OpKind::Lte;
+
+    if (numeric) {
+        if (comparison) return VAL_BOOL;
+        if (op == OpKind::Div) return VAL_FLOAT;
+        return a == VAL_INT && b == VAL_INT ? VAL_INT : VAL_FLOAT;
+    }
+
+    if (a == VAL_STRING && b == VAL_STRING) {
+        if (op == OpKind::Add) return VAL_STRING;
+        if (comparison) return VAL_BOOL;
+        return TYPE_ERROR;
+    }
+
+    switch (op) {
+        case OpKind::Add:
+            if (a == VAL_CHAR && (b == VAL_CHAR || b == VAL_STRING)) return VAL_STRING;
+            return TYPE_ERROR;
+        case OpKind::Eq:
+        case OpKind::Neq:
+            // Ints and bools compare with anything, chars only equal chars
+            if (a == VAL_INT || a == VAL_BOOL || a == VAL_CHAR) return VAL_BOOL;
+            return TYPE_ERROR;
+        default:
+            return TYPE_ERROR;
+    }
+}
+
+/* ------------------------------------------------------------------- */
+
+TypeChecker::TypeChecker(const std::vector<std::string>& predeclared, bool defer_functions)
+    : predeclared(predeclared), defer_functions(defer_functions) {}
+
+void TypeChecker::check(Ast& program)
+{
+    ast = &program;
+    scopes.clear();
+    begin_scope();
+
+    for (auto& name : predeclared) declare(ast->intern(name), VAL_FUNCTION);
+
+    const Node& root = (*ast)[ast->root];
+    for (uint32_t i = 0; i < root.b; i++) {
+        check_stmt(ast->lists[root.a + i]);
+    }
+
+    end_scope();
+}
+
+void TypeChecker::begin_scope()
+{
+    scopes.emplace_back();
+}
+
+void TypeChecker::end_scope()
+{
+    // The deferred list may grow while checking, so index instead of iterating
+    for (std::size_t i = 0; i < scopes.back().deferred.size(); i++) {
+        check_function_body(scopes.back().deferred[i]);
+    }
+    scopes.pop_back();
+}
+
+void TypeChecker::declare(NameId name, uint8_t type)
+{
+    auto [it, inserted] = scopes.back().names.emplace(name, type);
+
+    // A redeclaration fails at runtime; until then the name may hold either
+    if (!inserted && it->second != type) it->second = NO_TYPE;
+}
+
+uint8_t TypeChecker::lookup(NameId name) const
+{
+    for (std::size_t i = scopes.size(); i-- > 0;) {
+        auto it = scopes[i].names.find(name);
+        if (it != scopes[i].names.end()) return it->second;
+    }
+    return NO_TYPE;
+}
+
+void TypeChecker::check_function_body(uint32_t index)
+{
+    begin_scope();
+    const AstFunction& fn = ast->functions[index];
+    for (uint32_t i = 0; i < fn.params_count; i++) {
+        AstParam& param = ast->params[fn.params_begin + i];
+        param.value_type = type_from_name(ast->name(param.type));
+        declare(param.name, param.is_array ? static_cast<uint8_t>(VAL_ARRAY) : param.value_type);
+    }
+    check_stmt(fn.body);
+    end_scope();
+}
+
+/* Statements */
+
+void TypeChecker::check_stmt(NodeId id)
+{
+    if (id == NO_NODE) return;
+
+    // Checking never adds nodes, so references into the pool stay valid
+    Node& node = (*ast)[id];
+
+    switch (node.kind) {
+        case NodeType::ExprStmt:
+            check_expr(node.a);
+            break;
+        case NodeType::VarDeclaration:
+            check_var_declaration(node);
+            break;
+        case NodeType::BlockStmt:
+            begin_scope();
+            for (uint32_t i = 0; i < node.b; i++) check_stmt(ast->lists[node.a + i]);
+            end_scope();
+            break;
+        case NodeType::IfStmt:
+            check_expr(node.a);
+            check_stmt(node.b);
+            check_stmt(node.c);
+            break;
+        case NodeType::WhileStmt:
+            check_expr(node.a);
+            check_stmt(node.b);
+            break;
+        case NodeType::ForStmt:
+            check_stmt(node.a);
+            if (node.b != NO_NODE) check_expr(node.b);
+            if (ast->lists[node.c] != NO_NODE) check_expr(ast->lists[node.c]);
+            check_stmt(ast->lists[node.c + 1]);
+            break;
+        case NodeType::FunctionStmt:
+            // The vm compiles the body before the function's name exists
+            if (defer_functions) {
+                declare(ast->functions[node.a].name, VAL_FUNCTION);
+                scopes.back().deferred.push_back(node.a);
+            } else {
+                check_function_body(node.a);
+                declare(ast->functions[node.a].name, VAL_FUNCTION);
+            }
+            break;
+        case NodeType::ReturnStmt:
+            if (node.a != NO_NODE) check_expr(node.a);
+            break;
+        case NodeType::ContinueStmt:
+        case NodeType::BreakStmt:
+            break;
+        default:
+            // for-loop initializers may be bare expressions
+            check_expr(id);
+            break;
+    }
+}
+
+void TypeChecker::check_var_declaration(Node& node)
+{
+    AstVarDecl& var = ast->vars[node.a];
+    const std::string& name = ast->name(var.name);
+    var.value_type = type_from_name(ast->name(var.type));
+
+    // The initializer is evaluated before the name exists
+    uint8_t value = var.value != NO_NODE ? check_expr(var.value) : NO_TYPE;
+    uint8_t size = var.array_size != NO_NODE ? check_expr(var.array_size) : NO_TYPE;
+
+    if (node.has(FLAG_ARRAY)) {
+        if (value != NO_TYPE && value != VAL_ARRAY)
+            type_err("initializer of array '" + name + "' is not an array", node.line);
+        if (size != NO_TYPE && size != VAL_INT)
+            type_err("size of array '" + name + "' must be an int, not '" + type_name(size) + "'", node.line);
+
+        declare(var.name, VAL_ARRAY);
+        return;
+    }
+
+    uint8_t stored = var.value_type;
+
+    if (var.value == NO_NODE) {
+        // Default value of the declared type
+    } else if (var.value_type == NO_TYPE) {
+        // 'auto' takes the initializer's kind
+        stored = value;
+    } else if ((*ast)[var.value].kind == NodeType::CastExpr) {
+        // Kept as is, static_cast<T>() may have produced null
+        if (value != var.value_type) stored = NO_TYPE;
+    } else if (value != NO_TYPE) {
+        if (cast_result(value, var.value_type) == TYPE_ERROR)
+            type_err("cannot initialize '" + name + "' of type '" + type_name(var.value_type) + "' with a '" +
+                     type_name(value) + "'", node.line);
+        if (value == var.value_type) node.flags |= FLAG_NO_CAST;
+    }
+
+    declare(var.name, stored);
+}
+
+/* Expressions */
+
+uint8_t TypeChecker::check_expr(NodeId id)
+{
+    Node& node = (*ast)[id];
+    uint8_t type = NO_TYPE;
+
+    switch (node.kind) {
+        case NodeType::NumericLiteral:
+            type = node.has(FLAG_INT) ? VAL_INT : VAL_FLOAT;
+            break;
+        case NodeType::StringLiteral:
+            type = VAL_STRING;
+            break;
+        case NodeType::CharLiteral:
+            type = VAL_CHAR;
+            break;
+        case NodeType::BoolLiteral:
+            type = VAL_BOOL;
+            break;
+        case NodeType::NullLiteral:
+            type = VAL_NULL;
+            break;
+        case NodeType::IdentifierLiteral:
+            // Read through an outer fallback the name is the enclosing
+            // binding until its later declaration runs, either type is possible
+            type = ast->slot(node).has_outer() ? NO_TYPE : lookup(node.a);
+            break;
+        case NodeType::ArrayLiteral:
+            for (uint32_t i = 0; i < node.b; i++) check_expr(ast->lists[node.a + i]);
+            type = VAL_ARRAY;
+            break;
+        case NodeType::BinaryExpr:
+            type = check_binary(node);
+            break;
+        case NodeType::UnaryExpr:
+            type = check_unary(node);
+            break;
+        case NodeType::AssignmentExpr:
+            type = check_assign(node);
+            break;
+        case NodeType::MemberExpr:
+        {
+            uint8_t object = check_expr(node.a);
+            uint8_t index = check_expr(node.b);
+            if (index != NO_TYPE && index != VAL_INT)
+                type_err("array index must be an int, not '" + type_name(index) + "'", node.line);
+            if (object != NO_TYPE && object != VAL_ARRAY)
+                type_err("cannot index a value of type '" + type_name(object) + "'", node.line);
+            // Element kinds follow the array's current element type
+            break;
+        }
+        case NodeType::CallExpr:
+        {
+            uint8_t callee = check_expr(node.a);
+            for (uint32_t i = 0; i < node.c; i++) check_expr(ast->lists[node.b + i]);
+            if (callee != NO_TYPE && callee != VAL_FUNCTION)
+                type_err("cannot call a value of type '" + type_name(callee) + "'", node.line);
+            // Return values are not converted to the declared return type
+            break;
+        }
+        case NodeType::CastExpr:
+            type = check_cast(node);
+            break;
+        default:
+            break;
+    }
+
+    node.type = type;
+    return type;
+}
+
+uint8_t TypeChecker::check_binary(Node& node)
+{
+    uint8_t left = check_expr(node.a);
+    uint8_t right = check_expr(node.b);
+
+    if (node.op == OpKind::And || node.op == OpKind::Or) {
+        // Operands are converted with cast(v, bool)
+        for (uint8_t operand : {left, right}) {
+            if (operand != NO_TYPE && operand != VAL_NULL && cast_result(operand, VAL_BOOL) == TYPE_ERROR)
+                type_err(std::string("operator '") + op_str(node.op) + "' cannot be applied to '" +
+                         type_name(operand) + "'", node.line);
+        }
+
+        if (left == VAL_NULL) return VAL_NULL;
+        if (left == NO_TYPE || right == NO_TYPE || right == VAL_NULL) return NO_TYPE;
+        return VAL_BOOL;
+    }
+
+    if (node.op < OpKind::Add || node.op > OpKind::Lte || left == NO_TYPE || right == NO_TYPE) return NO_TYPE;
+
+    uint8_t result = binary_result(node.op, left, right);
+    if (result == TYPE_ERROR)
+        type_err(std::string("operator '") + op_str(node.op) + "' cannot be applied to '" + type_name(left) +
+                 "' and '" + type_name(right) + "'", node.line);
+
+    if (left == VAL_INT && right == VAL_INT) node.flags |= FLAG_INT_OPERANDS;
+    return result;
+}
+
+uint8_t TypeChecker::check_unary(Node& node)
+{
+    const std::string op = op_str(node.op);
+
+    if (node.op == OpKind::Inc || node.op == OpKind::Dec) {
+        uint8_t operand = check_expr(node.a);
+        if ((*ast)[node.a].kind != NodeType::IdentifierLiteral || operand == NO_TYPE) return NO_TYPE;
+
+        if (operand != VAL_INT && operand != VAL_FLOAT)
+            type_err("unary '" + op + "' cannot be applied to '" + type_name(operand) + "'", node.line);
+
+        // The stepped value has the variable's own type
+        node.flags |= FLAG_NO_CAST;
+        return operand;
+    }
+
+    uint8_t operand = check_expr(node.a);
+    if (operand == NO_TYPE) {
+        if (node.op == OpKind::Not) return VAL_BOOL;
+        return NO_TYPE;
+    }
+
+    switch (node.op) {
+        case OpKind::Sub:
+        case OpKind::Add:
+            if (operand != VAL_INT && operand != VAL_FLOAT)
+                type_err("unary '" + op + "' cannot be applied to '" + type_name(operand) + "'", node.line);
+            return operand;
+        case OpKind::Not:
+            if (operand != VAL_INT && operand != VAL_FLOAT && operand != VAL_BOOL && operand != VAL_NULL)
+                type_err("unary '" + op + "' cannot be applied to '" + type_name(operand) + "'", node.line);
+            return VAL_BOOL;
+        default:
+            return NO_TYPE;
+    }
+}
+
+uint8_t TypeChecker::check_assign(Node& node)
+{
+    uint8_t target = check_expr(node.a);
+    uint8_t value = check_expr(node.b);
+    const Node& assignee = (*ast)[node.a];
+
+    if (assignee.kind != NodeType::IdentifierLiteral || target == NO_TYPE) return NO_TYPE;
+
+    if (value != NO_TYPE) {
+        if (cast_result(value, target) == TYPE_ERROR)
+            type_err("cannot assign a '" + type_name(value) + "' to '" + ast->name(assignee.a) + "' of type '" +
+                     type_name(target) + "'", node.line);
+        if (value == target) node.flags |= FLAG_NO_CAST;
+    }
+
+    return target;
+}
+
+uint8_t TypeChecker::check_cast(Node& node)
+{
+    uint8_t operand = check_expr(node.b);
+
+    // Unknown target names are left to stoval() at runtime
+    uint8_t target = type_from_name(ast->name(node.a));
+    node.c = target;
+
+    return static_cast_result(operand, target);
+}
@@ -0,0 +1,66 @@
+/*
+
+checker.hh
+
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../parser/flat_ast.hh"
+#include "../values.hh"
+
+// Infers the static ValueType of every expression and reports operations
+// that fail for every value of their operand types before the program runs.
+// Node::type gets the inferred type, or NO_TYPE when it is only known at
+// runtime (call results, array elements, 'auto' parameters, ...).
+//
+// A variable's type is static when every value it can hold has that type:
+// declarations and assignments cast() to the declared type, so a typed
+// variable never changes kind. Where a value provably has the stored type
+// already, the node gets FLAG_NO_CAST and the engines skip the cast.
+//
+// Scoping mirrors the engine: the tree walker resolves function bodies when
+// their declaring scope closes (see Resolver), the vm compiles them in place.
+// With the tree engines the resolver runs first, and names it gave an outer
+// fallback (ScopeSlot::has_outer) are typed NO_TYPE.
+class TypeChecker {
+public:
+    TypeChecker(const std::vector<std::string>& predeclared, bool defer_functions);
+
+    void check(Ast& ast);
+
+private:
+    struct Scope {
+        std::unordered_map<NameId, uint8_t> names;
+        std::vector<uint32_t> deferred;
+    };
+
+    void check_stmt(NodeId id);
+    uint8_t check_expr(NodeId id);
+    void check_var_declaration(Node& node);
+    void check_function_body(uint32_t index);
+
+    uint8_t check_binary(Node& node);
+    uint8_t check_unary(Node& node);
+    uint8_t check_assign(Node& node);
+    uint8_t check_cast(Node& node);
+
+    void begin_scope();
+    void end_scope();
+
+    void declare(NameId name, uint8_t type);
+    uint8_t lookup(NameId name) const;
+
+    std::vector<std::string> predeclared;
+    bool defer_functions;
+    std::vector<Scope> scopes;
+    Ast* ast = nullptr;
+};
+
+// ValueType named by a declaration or cast ("int", "string", ...), NO_TYPE
+// for "auto" and unknown names
+uint8_t type_from_name(const std::string& name);
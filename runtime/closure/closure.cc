@@ -0,0 +1,659 @@
+#include "closure.hh"
+
+#include "../eval/expressions.hh"
+#include "../eval/statements.hh"
+#include "../interpreter/constants.hh"
+#include "../../utils/error.hh"
+#include "../../utils/int_ops.hh"
+#include "../../utils/utils.hh"
+
+#include <cassert>
+#include <iostream>
+
+ClosureCompiler::ClosureCompiler(const Ast& ast) : ast(ast) {}
+
+std::unique_ptr<ClosureProgram> ClosureCompiler::compile()
+{
+    auto result = std::make_unique<ClosureProgram>();
+    program = result.get();
+    program->ast = &ast;
+    program->functions.resize(ast.functions.size());
+
+    // Each top-level statement runs with its own line, like execute() does
+    std::vector<std::pair<StmtFn, std::size_t>> body;
+    const Node& root = ast[ast.root];
+    for (uint32_t i = 0; i < root.b; i++) {
+        NodeId id = ast.lists[root.a + i];
+        body.emplace_back(compile_stmt(id), ast[id].line);
+    }
+
+    program->root = [body = std::move(body)](Environment* env, std::size_t) {
+        Value last_eval;
+        for (auto& [stmt, line] : body) last_eval = stmt(env, line).value;
+        return Completion::normal(last_eval);
+    };
+
+    program = nullptr;
+    return result;
+}
+
+/* ------------------------- Statements ------------------------- */
+
+StmtFn ClosureCompiler::compile_stmt(NodeId id)
+{
+    const Node& node = ast[id];
+
+    switch (node.kind) {
+        case NodeType::ExprStmt:
+        {
+            ExprFn expr = compile_expr(node.a);
+            return [expr](Environment* env, std::size_t line) { return Completion::normal(expr(env, line)); };
+        }
+        case NodeType::VarDeclaration:
+            return compile_var_declaration(node);
+        case NodeType::IfStmt:
+            return compile_if_stmt(node);
+        case NodeType::WhileStmt:
+            return compile_while_stmt(node);
+        case NodeType::ForStmt:
+            return compile_for_stmt(node);
+        case NodeType::FunctionStmt:
+            return compile_func_stmt(node);
+        case NodeType::ReturnStmt:
+            return compile_return_stmt(node);
+        case NodeType::BreakStmt:
+            return [](Environment*, std::size_t) { return Completion{Completion::Break}; };
+        case NodeType::ContinueStmt:
+            return [](Environment*, std::size_t) { return Completion{Completion::Continue}; };
+        case NodeType::BlockStmt:
+            return compile_block(node);
+        default:
+        {
+            ExprFn expr = compile_expr(id);
+            return [expr](Environment* env, std::size_t line) { return Completion::normal(expr(env, line)); };
+        }
+    }
+}
+
+StmtFn ClosureCompiler::compile_block(const Node& node)
+{
+    std::vector<StmtFn> stmts;
+    stmts.reserve(node.b);
+    for (uint32_t i = 0; i < node.b; i++) stmts.push_back(compile_stmt(ast.lists[node.a + i]));
+
+    std::size_t scope_size = node.c;
+
+    return [stmts = std::move(stmts), scope_size](Environment* env, std::size_t line) {
+        Environment* child_env = Environment::push(env, scope_size);
+        child_env->current_return_type = env->current_return_type;
+
+        Value last_eval;
+        for (auto& stmt : stmts) {
+            Completion result = stmt(child_env, line);
+
+            if (result.type != Completion::Normal) {
+                Environment::pop(child_env);
+                return result;
+            }
+
+            last_eval = std::move(result.value);
+        }
+
+        Environment::pop(child_env);
+        return Completion::normal(last_eval);
+    };
+}
+
+StmtFn ClosureCompiler::compile_var_declaration(const Node& node)
+{
+    const AstVarDecl& var = ast.vars[node.a];
+    const Ast* tree = &ast;
+    const Node* decl = &node;
+
+    ExprFn value_fn = var.value != NO_NODE ? compile_expr(var.value) : nullptr;
+    ExprFn size_fn = node.has(FLAG_ARRAY) && var.array_size != NO_NODE ? compile_expr(var.array_size) : nullptr;
+
+    if (!value_fn) {
+        return [tree, decl](Environment* env, std::size_t line) {
+            return Completion::normal(declare_var(*tree, *decl, nullptr, nullptr, env, line));
+        };
+    }
+
+    if (size_fn) {
+        return [tree, decl, value_fn, size_fn](Environment* env, std::size_t line) {
+            Value value = value_fn(env, line);
+            Value size = size_fn(env, line);
+            return Completion::normal(declare_var(*tree, *decl, &value, &size, env, line));
+        };
+    }
+
+    return [tree, decl, value_fn](Environment* env, std::size_t line) {
+        Value value = value_fn(env, line);
+        return Completion::normal(declare_var(*tree, *decl, &value, nullptr, env, line));
+    };
+}
+
+StmtFn ClosureCompiler::compile_if_stmt(const Node& node)
+{
+    ExprFn condition = compile_expr(node.a);
+    StmtFn then_branch = compile_stmt(node.b);
+    StmtFn else_branch = node.c != NO_NODE ? compile_stmt(node.c) : nullptr;
+
+    return [condition, then_branch, else_branch](Environment* env, std::size_t line) {
+        if (is_truthy(condition(env, line))) return then_branch(env, line);
+        if (else_branch) return else_branch(env, line);
+        return Completion::normal(Value::Null());
+    };
+}
+
+StmtFn ClosureCompiler::compile_while_stmt(const Node& node)
+{
+    ExprFn condition = compile_expr(node.a);
+    StmtFn body = compile_block(ast[node.b]);
+
+    return [condition, body](Environment* env, std::size_t line) {
+        Value last_eval;
+
+        while (is_truthy(condition(env, line))) {
+            Completion result = body(env, line);
+
+            if (result.type == Completion::Break) break;
+            if (result.type == Completion::Continue) continue;
+            if (result.type == Completion::Return) return result;
+
+            last_eval = std::move(result.value);
+        }
+
+        return Completion::normal(last_eval);
+    };
+}
+
+StmtFn ClosureCompiler::compile_for_stmt(const Node& node)
+{
+    StmtFn init;
+    if (node.a != NO_NODE) {
+        if (ast[node.a].kind == NodeType::VarDeclaration) {
+            init = compile_var_declaration(ast[node.a]);
+        } else {
+            ExprFn expr = compile_expr(node.a);
+            init = [expr](Environment* env, std::size_t line) { return Completion::normal(expr(env, line)); };
+        }
+    }
+
+    ExprFn condition = node.b != NO_NODE ? compile_expr(node.b) : nullptr;
+    NodeId update_id = ast.lists[node.c];
+    ExprFn update = update_id != NO_NODE ? compile_expr(update_id) : nullptr;
+    StmtFn body = compile_block(ast[ast.lists[node.c + 1]]);
+
+    return [init, condition, update, body](Environment* env, std::size_t line) {
+        Value last_eval;
+
+        if (init) init(env, line);
+
+        while (!condition || is_truthy(condition(env, line))) {
+            Completion result = body(env, line);
+
+            if (result.type == Completion::Break) break;
+            if (result.type == Completion::Return) return result;
+            if (result.type == Completion::Normal) {
+                last_eval = std::move(result.value);
+            }
+
+            if (update) update(env, line);
+        }
+
+        return Completion::normal(last_eval);
+    };
+}
+
+StmtFn ClosureCompiler::compile_func_stmt(const Node& node)
+{
+    const AstFunction* decl = &ast.functions[node.a];
+    program->functions[node.a] = compile_block(ast[decl->body]);
+
+    const Ast* fn_ast = &ast;
+    return [fn_ast, decl](Environment* env, std::size_t line) {
+        auto funcVal = new FunctionValue(fn_ast, decl, env);
+        funcVal->closure->current_return_type = fn_ast->name(decl->ret_type);
+
+        return Completion::normal(
+            env->declareVar(decl->slot, fn_ast->name(decl->name), Value::Object(funcVal), VAL_FUNCTION, true, line));
+    };
+}
+
+StmtFn ClosureCompiler::compile_return_stmt(const Node& node)
+{
+    ExprFn value_fn = node.a != NO_NODE ? compile_expr(node.a) : nullptr;
+
+    return [value_fn](Environment* env, std::size_t line) {
+        Value value;
+
+        if (value_fn) {
+            value = value_fn(env, line);
+
+            if (env->current_return_type == "void") {
+                runtime_err("void functions cannot return a value", line);
+            }
+        }
+
+        return Completion{Completion::Return, value};
+    };
+}
+
+/* ------------------------- Expressions ------------------------- */
+
+ExprFn ClosureCompiler::compile_expr(NodeId id)
+{
+    const Node& node = ast[id];
+
+    switch (node.kind) {
+        case NodeType::NumericLiteral:
+        case NodeType::BoolLiteral:
+        case NodeType::StringLiteral:
+        case NodeType::CharLiteral:
+        {
+            Value constant = ConstantPool::instance().get(node.c);
+            return [constant](Environment*, std::size_t) { return constant; };
+        }
+        case NodeType::NullLiteral:
+            return [](Environment*, std::size_t) { return Value::Null(); };
+        case NodeType::IdentifierLiteral:
+        case NodeType::SlotIdentifier:
+        {
+            ScopeSlot slot = ast.slot(node);
+            const std::string* name = &ast.name(node.a);
+
+            // Unresolved names only ever report their error
+            if (!slot.resolved()) {
+                return [slot, name](Environment* env, std::size_t line) { return env->lookupVar(slot, *name, line); };
+            }
+
+            return [slot, name](Environment* env, std::size_t line) {
+                if (const VarInfo* var = env->find(slot)) return var->value;
+                return env->lookupVar(slot, *name, line);
+            };
+        }
+        case NodeType::ArrayLiteral:
+        {
+            std::vector<ExprFn> elements;
+            elements.reserve(node.b);
+            for (uint32_t i = 0; i < node.b; i++) elements.push_back(compile_expr(ast.lists[node.a + i]));
+
+            return [elements = std::move(elements)](Environment* env, std::size_t line) {
+                std::vector<Value> elems;
+                elems.reserve(elements.size());
+                for (auto& element : elements) elems.push_back(element(env, line));
+                return Value::Object(new ArrayValue(std::move(elems)));
+            };
+        }
+        // Quickened kinds only ever appear after a tree-walker run, they
+        // compile like the generic node they came from
+        case NodeType::BinaryExpr:
+        case NodeType::IntBinaryExpr:
+        case NodeType::FloatBinaryExpr:
+            return compile_binary_expr(node);
+        case NodeType::UnaryExpr:
+            return compile_unary_expr(node);
+        case NodeType::AssignmentExpr:
+            return compile_assign_expr(node);
+        case NodeType::MemberExpr:
+        case NodeType::IntIndexExpr:
+            return compile_member_expr(node);
+        case NodeType::CallExpr:
+            return compile_call_expr(node);
+        case NodeType::CastExpr:
+            return compile_cast_expr(node);
+
+        case NodeType::ExprStmt:
+        case NodeType::VarDeclaration:
+        case NodeType::IfStmt:
+        case NodeType::WhileStmt:
+        case NodeType::ForStmt:
+        case NodeType::FunctionStmt:
+        case NodeType::ReturnStmt:
+        case NodeType::BreakStmt:
+        case NodeType::ContinueStmt:
+        case NodeType::BlockStmt:
+        {
+            StmtFn stmt = compile_stmt(id);
+            return [stmt](Environment* env, std::size_t line) { return stmt(env, line).value; };
+        }
+        default:
+        {
+            int kind = static_cast<int>(node.kind);
+            return [kind](Environment*, std::size_t) -> Value {
+                std::cerr << "ryc: This AST Node has not yet been setup for interpretation: kind " << kind << std::endl;
+                std::exit(1);
+            };
+        }
+    }
+}
+
+static Value to_value(int v) { return Value::Int(v); }
+static Value to_value(bool v) { return Value::Bool(v); }
+
+// An operator on two operands the type checker proved to be ints
+template <typename Op>
+static ExprFn int_binary(ExprFn left, ExprFn right, Op op)
+{
+    return [left = std::move(left), right = std::move(right), op](Environment* env, std::size_t line) {
+        Value x = left(env, line);
+        Value y = right(env, line);
+        assert(x.kind == VAL_INT && y.kind == VAL_INT); // FLAG_INT_OPERANDS
+        return to_value(op(x.i, y.i));
+    };
+}
+
+ExprFn ClosureCompiler::compile_binary_expr(const Node& node)
+{
+    ExprFn left = compile_expr(node.a);
+    ExprFn right = compile_expr(node.b);
+    OpKind op = node.op;
+
+    // Short-circuit logical operators, the right side only runs when needed
+    if (op == OpKind::And || op == OpKind::Or) {
+        bool is_and = op == OpKind::And;
+
+        return [left, right, is_and](Environment* env, std::size_t line) {
+            Value left_val = left(env, line);
+            if (left_val.kind == VAL_NULL) return Value::Null();
+
+            bool left_bool = cast(left_val, VAL_BOOL, line).b;
+            if (is_and && !left_bool) return Value::Bool(false);
+            if (!is_and && left_bool) return Value::Bool(true);
+
+            Value right_val = right(env, line);
+            if (right_val.kind == VAL_NULL) return Value::Null();
+            return Value::Bool(cast(right_val, VAL_BOOL, line).b);
+        };
+    }
+
+    if (op < OpKind::Add || op > OpKind::Lte) {
+        return [left, right, op](Environment* env, std::size_t line) {
+            left(env, line);
+            right(env, line);
+            runtime_err(std::string("unknown binary operator '") + op_str(op) + "'", line);
+            return Value();
+        };
+    }
+
+    if (node.has(FLAG_INT_OPERANDS)) {
+        switch (op) {
+            case OpKind::Add: return int_binary(std::move(left), std::move(right), [](int x, int y) { return int_add(x, y); });
+            case OpKind::Sub: return int_binary(std::move(left), std::move(right), [](int x, int y) { return int_sub(x, y); });
+            case OpKind::Mul: return int_binary(std::move(left), std::move(right), [](int x, int y) { return int_mul(x, y); });
+            case OpKind::Eq:  return int_binary(std::move(left), std::move(right), std::equal_to<int>());
+            case OpKind::Neq: return int_binary(std::move(left), std::move(right), std::not_equal_to<int>());
+            case OpKind::Gt:  return int_binary(std::move(left), std::move(right), std::greater<int>());
+            case OpKind::Gte: return int_binary(std::move(left), std::move(right), std::greater_equal<int>());
+            case OpKind::Lt:  return int_binary(std::move(left), std::move(right), std::less<int>());
+            case OpKind::Lte: return int_binary(std::move(left), std::move(right), std::less_equal<int>());
+            default: break; // '/' and '%' keep their checks
+        }
+    }
+
+    return [left, right, op](Environment* env, std::size_t line) {
+        Value left_val = left(env, line);
+        Value right_val = right(env, line);
+        return value_binary(op, left_val, right_val, line);
+    };
+}
+
+ExprFn ClosureCompiler::compile_unary_expr(const Node& node)
+{
+    if (node.op == OpKind::Inc || node.op == OpKind::Dec) return compile_incdec_expr(node);
+
+    std::string op = op_str(node.op);
+
+    switch (node.op) {
+        case OpKind::Sub:
+        case OpKind::Add:
+        {
+            ExprFn operand = compile_expr(node.a);
+            bool neg = node.op == OpKind::Sub;
+
+            return [operand, neg, op](Environment* env, std::size_t line) {
+                Value value = operand(env, line);
+                switch (value.kind) {
+                    case VAL_INT:   return neg ? Value::Int(int_neg(value.i)) : value;
+                    case VAL_FLOAT: return neg ? Value::Float(-value.f) : value;
+                    default:
+                        runtime_err("ryc: unary '" + op + "' can only be applied to numeric types.", line);
+                }
+                return Value();
+            };
+        }
+        case OpKind::Not:
+        {
+            ExprFn operand = compile_expr(node.a);
+
+            return [operand](Environment* env, std::size_t line) {
+                Value value = operand(env, line);
+                switch (value.kind) {
+                    case VAL_INT:   return Value::Bool(value.i == 0);
+                    case VAL_FLOAT: return Value::Bool(value.f == 0.0);
+                    case VAL_BOOL:  return Value::Bool(!value.b);
+                    case VAL_NULL:  return Value::Bool(true);
+                    default:
+                        runtime_err("ryc: unary '!' can only be applied to truthy values.", line);
+                }
+                return Value();
+            };
+        }
+        default:
+            return [op](Environment*, std::size_t line) {
+                runtime_err("ryc: unknown unary operator '" + op + "'.", line);
+                return Value();
+            };
+    }
+}
+
+// Numeric value one step from 'old', or an error for any other kind
+static Value step(const Value& old, int delta, const std::string& op, std::size_t line)
+{
+    switch (old.kind) {
+        case VAL_INT:   return Value::Int(int_add(old.i, delta));
+        case VAL_FLOAT: return Value::Float(old.f + delta);
+        default:
+            runtime_err("ryc: unary '" + op + "' can only be applied to numeric values.", line);
+    }
+    return Value();
+}
+
+ExprFn ClosureCompiler::compile_incdec_expr(const Node& node)
+{
+    std::string op = op_str(node.op);
+    int delta = node.op == OpKind::Inc ? 1 : -1;
+    bool prefix = node.has(FLAG_PREFIX);
+    const Node& operand = ast[node.a];
+
+    if (operand.kind == NodeType::IdentifierLiteral) {
+        ScopeSlot slot = ast.slot(operand);
+        const std::string* name = &ast.name(operand.a);
+        bool no_cast = node.has(FLAG_NO_CAST);
+
+        return [=](Environment* env, std::size_t line) {
+            Value oldVal = env->lookupVar(slot, *name, line);
+            Value newVal = step(oldVal, delta, op, line);
+
+            if (no_cast) env->storeVar(slot, *name, newVal, line);
+            else env->assignVar(slot, *name, newVal, line);
+
+            return prefix ? newVal : oldVal;
+        };
+    }
+
+    if (operand.kind == NodeType::MemberExpr) {
+        ExprFn object = compile_expr(operand.a);
+        ExprFn index = compile_expr(operand.b);
+
+        return [=](Environment* env, std::size_t line) {
+            Value objVal = object(env, line);
+
+            if (objVal.kind != VAL_ARRAY) {
+                runtime_err("ryc: unary '" + op + "' can only be applied to numeric array elements", line);
+            }
+
+            auto arrVal = objVal.as<ArrayValue>();
+
+            Value idxVal = index(env, line);
+            if (idxVal.kind != VAL_INT) {
+                runtime_err("ryc: array index must be an integer", line);
+            }
+
+            int idx = idxVal.i;
+
+            if (idx < 0 || idx >= static_cast<int>(arrVal->size())) {
+                runtime_err("ryc: array index out of bounds", line);
+            }
+
+            Value oldVal = arrVal->get(idx);
+            Value newVal = step(oldVal, delta, op, line);
+            arrVal->set(idx, newVal);
+
+            return prefix ? newVal : oldVal;
+        };
+    }
+
+    return [op](Environment*, std::size_t line) {
+        runtime_err("ryc: " + op + " can only be applied to assignable values.", line);
+        return Value();
+    };
+}
+
+ExprFn ClosureCompiler::compile_assign_expr(const Node& node)
+{
+    const Node& assignee = ast[node.a];
+
+    if (assignee.kind == NodeType::MemberExpr) {
+        ExprFn object = compile_expr(assignee.a);
+        ExprFn index = compile_expr(assignee.b);
+        ExprFn value_fn = compile_expr(node.b);
+
+        return [object, index, value_fn](Environment* env, std::size_t line) {
+            Value objVal = object(env, line);
+            if (objVal.kind != VAL_ARRAY) runtime_err("attempting to index a non-array value", line);
+
+            auto arr = objVal.as<ArrayValue>();
+            Value indexVal = index(env, line);
+
+            if (indexVal.kind != VAL_INT) runtime_err("array index must be an integer", line);
+            size_t idx = static_cast<size_t>(indexVal.i);
+            if (idx >= arr->size()) runtime_err("array index out of bounds", line);
+
+            Value value = cast_element(arr, value_fn(env, line), line);
+            arr->set(idx, value);
+
+            return value;
+        };
+    }
+
+    if (assignee.kind == NodeType::IdentifierLiteral) {
+        ExprFn value_fn = compile_expr(node.b);
+        ScopeSlot slot = ast.slot(assignee);
+        const std::string* name = &ast.name(assignee.a);
+
+        if (node.has(FLAG_NO_CAST)) {
+            return [value_fn, slot, name](Environment* env, std::size_t line) {
+                return env->storeVar(slot, *name, value_fn(env, line), line);
+            };
+        }
+
+        return [value_fn, slot, name](Environment* env, std::size_t line) {
+            return env->assignVar(slot, *name, value_fn(env, line), line);
+        };
+    }
+
+    return [](Environment*, std::size_t line) {
+        runtime_err("invalid assignee in assignment expression", line);
+        return Value();
+    };
+}
+
+ExprFn ClosureCompiler::compile_member_expr(const Node& node)
+{
+    ExprFn object = compile_expr(node.a);
+
+    if (!node.has(FLAG_COMPUTED)) {
+        return [object](Environment* env, std::size_t line) {
+            object(env, line);
+            return Value();
+        };
+    }
+
+    ExprFn property = compile_expr(node.b);
+
+    return [object, property](Environment* env, std::size_t line) {
+        Value obj = object(env, line);
+        Value prop = property(env, line);
+
+        if (prop.kind != VAL_INT) runtime_err("array index must be an integer", line);
+        if (obj.kind != VAL_ARRAY) runtime_err("object is not an array", line);
+
+        auto arr = obj.as<ArrayValue>();
+        int idx = prop.i;
+        if (idx < 0 || idx >= (int)arr->size())
+            runtime_err("array index out of bounds", line);
+
+        return arr->get(idx);
+    };
+}
+
+ExprFn ClosureCompiler::compile_call_expr(const Node& node)
+{
+    ExprFn callee_fn = compile_expr(node.a);
+
+    std::vector<ExprFn> arg_fns;
+    arg_fns.reserve(node.c);
+    for (uint32_t i = 0; i < node.c; i++) arg_fns.push_back(compile_expr(ast.lists[node.b + i]));
+
+    const ClosureProgram* prog = program;
+
+    return [callee_fn, arg_fns = std::move(arg_fns), prog](Environment* env, std::size_t line) {
+        Value callee = callee_fn(env, line);
+
+        if (callee.kind != VAL_FUNCTION) {
+            runtime_err("attempted to call a non-function value", line);
+        }
+
+        std::vector<Value> args;
+        args.reserve(arg_fns.size());
+        for (auto& arg : arg_fns) args.push_back(arg(env, line));
+
+        if (auto native = dynamic_cast<NativeFunctionValue*>(callee.obj)) {
+            return native->func(args, env, line);
+        }
+
+        auto func = dynamic_cast<FunctionValue*>(callee.obj);
+        if (!func) runtime_err("unknown function type", line);
+
+        const Ast& fn_ast = *func->ast;
+        const AstFunction& decl = *func->declaration;
+
+        auto local_env = Environment::push(func->closure, decl.param_scope_size);
+        local_env->current_return_type = fn_ast.name(decl.ret_type);
+
+        bind_params(fn_ast, decl, args, local_env, env, line);
+
+        // Both a return and falling off the end yield the completion's value
+        const StmtFn& body = prog->functions[&decl - fn_ast.functions.data()];
+        Value res = body(local_env, line).value;
+
+        Environment::pop(local_env);
+        return res;
+    };
+}
+
+ExprFn ClosureCompiler::compile_cast_expr(const Node& node)
+{
+    ExprFn operand = compile_expr(node.b);
+    uint8_t target = static_cast<uint8_t>(node.c);
+    const std::string* type_name = &ast.name(node.a);
+
+    return [operand, target, type_name](Environment* env, std::size_t line) {
+        Value value = operand(env, line);
+        ValueType target_type = target != NO_TYPE ? static_cast<ValueType>(target) : stoval(*type_name, env, line);
+
+        return static_cast_value(value, target_type);
+    };
+}
@@ -0,0 +1,65 @@
+/*
+
+closure.hh
+
+*/
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../environment/environment.hh"
+#include "../interpreter/interpreter.hh"
+#include "../../parser/flat_ast.hh"
+
+// Closure compilation: the resolved program is walked once and every node
+// becomes a callable with its children, slots, operator and constants bound
+// at compile time. Running it calls straight through the closures, there is
+// no per-visit switch over node kinds. Semantics follow the tree walker
+// exactly, including its environments and error lines ('line' is the line
+// of the running top-level statement).
+using ExprFn = std::function<Value(Environment*, std::size_t)>;
+using StmtFn = std::function<Completion(Environment*, std::size_t)>;
+
+struct ClosureProgram {
+    StmtFn root;
+    // Function bodies by AstFunction index, FunctionValues are looked up here
+    std::vector<StmtFn> functions;
+    const Ast* ast = nullptr;
+
+    Value run(Environment* env) const { return root(env, 0).value; }
+};
+
+class ClosureCompiler {
+public:
+    // 'ast' must have been resolved, and outlive the compiled program
+    explicit ClosureCompiler(const Ast& ast);
+
+    std::unique_ptr<ClosureProgram> compile();
+
+private:
+    StmtFn compile_stmt(NodeId id);
+    ExprFn compile_expr(NodeId id);
+
+    StmtFn compile_block(const Node& node);
+    StmtFn compile_var_declaration(const Node& node);
+    StmtFn compile_if_stmt(const Node& node);
+    StmtFn compile_while_stmt(const Node& node);
+    StmtFn compile_for_stmt(const Node& node);
+    StmtFn compile_func_stmt(const Node& node);
+    StmtFn compile_return_stmt(const Node& node);
+
+    ExprFn compile_binary_expr(const Node& node);
+    ExprFn compile_unary_expr(const Node& node);
+    ExprFn compile_incdec_expr(const Node& node);
+    ExprFn compile_assign_expr(const Node& node);
+    ExprFn compile_member_expr(const Node& node);
+    ExprFn compile_call_expr(const Node& node);
+    ExprFn compile_cast_expr(const Node& node);
+
+    const Ast& ast;
+    ClosureProgram* program = nullptr;
+};
@@ -1,26 +1,51 @@
 #include <iostream>
+#include <new>
 
 #include "environment.hh"
 #include "statements.hh"
 
 #include "../../utils/error.hh"
 
-RVPtr Environment::declareVar( const std::string& name,RVPtr value,ValueType type, bool isConst,std::size_t line){
-    if (variables.find(name) != variables.end())
+Environment* Environment::push(Environment* parent, std::size_t size)
+{
+    FrameArena& arena = Allocator::instance().frames();
+    FrameArena::Mark mark = arena.mark();
+
+    // The slots follow the Environment in the same arena block
+    void* mem = arena.allocate(sizeof(Environment) + size * sizeof(VarInfo));
+    VarInfo* slots = reinterpret_cast<VarInfo*>(static_cast<char*>(mem) + sizeof(Environment));
+    for (std::size_t i = 0; i < size; i++) new (&slots[i]) VarInfo();
+
+    return new (mem) Environment(parent, slots, size, mark);
+}
+
+void Environment::pop(Environment* env)
+{
+    FrameArena::Mark mark = env->mark;
+
+    for (std::size_t i = 0; i < env->size; i++) env->slots[i].~VarInfo();
+    env->~Environment();
+
+    Allocator::instance().frames().release(mark);
+}
+
+Value Environment::declareVar(const ScopeSlot& slot, const std::string& name, const Value& value, ValueType type, bool isConst, std::size_t line){
+    VarInfo& info = slots[slot.index];
+    if (info.declared)
         runtime_err("ryc: cannot redeclare variable '" + name + "'", line);
 
-    variables[name] = VarInfo{
+    info = VarInfo{
         .value = value,
         .isConst = isConst,
-        .type = type
+        .type = type,
+        .declared = true
     };
     return value;
 }
 
-RVPtr Environment::assignVar(const std::string& name, RVPtr value, std::size_t line)
+Value Environment::assignVar(const ScopeSlot& slot, const std::string& name, const Value& value, std::size_t line)
 {
-    Environment* env = resolve(name, line);
-    VarInfo& info = env->variables[name];
+    VarInfo& info = resolve(slot, name, line);
 
     if (info.isConst)
         runtime_err("ryc: cannot assign to constant variable '" + name + "'", line);
@@ -31,24 +56,40 @@ RVPtr Environment::assignVar(const std::string& name, RVPtr value, std::size_t l
     return info.value;
 }
 
-RVPtr Environment::lookupVar(const std::string& name, std::size_t line)
+Value Environment::storeVar(const ScopeSlot& slot, const std::string& name, const Value& value, std::size_t line)
 {
-    return resolve(name, line)->variables[name].value;
+    VarInfo& info = resolve(slot, name, line);
+
+    if (info.isConst)
+        runtime_err("ryc: cannot assign to constant variable '" + name + "'", line);
+
+    info.value = value;
+
+    return info.value;
 }
 
+Value Environment::lookupVar(const ScopeSlot& slot, const std::string& name, std::size_t line)
+{
+    return resolve(slot, name, line).value;
+}
 
-Environment* Environment::resolve(const std::string& varname, std::size_t line)
+
+VarInfo& Environment::resolve(const ScopeSlot& slot, const std::string& name, std::size_t line)
 {
-    if (this->variables.find(varname) != this->variables.end())
+    Environment* env = this;
+    for (int d = slot.depth; d > 0 && env; d--)
     {
-        return this;
+        env = env->parent;
     }
 
-    if (this->parent == nullptr)
+    if (!slot.resolved() || env == nullptr || !env->slots[slot.index].declared)
     {
-        std::string err = "ryc: cannot resolve symbol '" + varname + "', as it does not exist.";
+        // Shadowed by a declaration that has not run yet
+        if (slot.has_outer()) return resolve(slot.outer(), name, line);
+
+        std::string err = "ryc: cannot resolve symbol '" + name + "', as it does not exist.";
         runtime_err(err, line);
     }
 
-    return this->parent->resolve(varname, line);
+    return env->slots[slot.index];
 }
@@ -7,32 +7,53 @@ environment.hh
 #pragma once
 
 #include "../values.hh"
+#include "../memory/allocator.hh"
 
 #include <optional>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <memory>
 
-using RVPtr = std::shared_ptr<RuntimeValue>;
-
 struct VarInfo {
-    RVPtr value;
-    bool isConst;
-    ValueType type;
+    Value value;
+    bool isConst = false;
+    ValueType type = VAL_NULL;
+    bool declared = false;
 };
 
+// A frame of variable slots. Slot indices and parent depths are assigned
+// ahead of time by the Resolver, names are only kept for error messages.
+// Environments live on the Allocator's frame arena: every push() has to be
+// matched by a pop() in LIFO order.
 class Environment {
 public:
-    explicit Environment(Environment* parent = nullptr)
-        : parent(parent) {}
+    static Environment* push(Environment* parent, std::size_t size);
+    static void pop(Environment* env);
 
     std::string current_return_type = "void";
 
-    RVPtr declareVar(const std::string& name, RVPtr value, ValueType type, bool isConst, std::size_t line);
-    RVPtr assignVar(const std::string& name, RVPtr value, std::size_t line);
-    RVPtr lookupVar(const std::string& varname, std::size_t line);
-    Environment* resolve(const std::string& varname, std::size_t line);
+    Value declareVar(const ScopeSlot& slot, const std::string& name, const Value& value, ValueType type, bool isConst, std::size_t line);
+    Value assignVar(const ScopeSlot& slot, const std::string& name, const Value& value, std::size_t line);
+    // assignVar() for a value the type checker proved to have the variable's type
+    Value storeVar(const ScopeSlot& slot, const std::string& name, const Value& value, std::size_t line);
+    Value lookupVar(const ScopeSlot& slot, const std::string& name, std::size_t line);
+    VarInfo& resolve(const ScopeSlot& slot, const std::string& name, std::size_t line);
+
+    // resolve() for an address known to be valid, nullptr if the variable is
+    // not declared yet. Errors are left to the caller.
+    const VarInfo* find(const ScopeSlot& slot) const {
+        const Environment* env = this;
+        for (int d = slot.depth; d > 0; d--) env = env->parent;
+        const VarInfo& info = env->slots[slot.index];
+        return info.declared ? &info : nullptr;
+    }
 private:
+    Environment(Environment* parent, VarInfo* slots, std::size_t size, const FrameArena::Mark& mark)
+        : parent(parent), slots(slots), size(size), mark(mark) {}
+    ~Environment() = default;
+
     Environment* parent = nullptr;
-    std::unordered_map<std::string, VarInfo> variables;
-};
\ No newline at end of file
+    VarInfo* slots;
+    std::size_t size;
+    FrameArena::Mark mark;
+};
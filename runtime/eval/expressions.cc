@@ -2,476 +2,575 @@
 #include "statements.hh"
 
 #include "../../utils/error.hh"
+#include "../../utils/int_ops.hh"
 #include "../../utils/utils.hh"
 
+#include <cassert>
 #include <iostream>
 
 /* Literals */
 
-RVPtr eval_array_literal(std::shared_ptr<ASTArrayLiteral> arr, Environment* env, std::size_t line)
+Value eval_array_literal(const Ast& ast, const Node& arr, Environment* env, std::size_t line)
 {
-    std::vector<RVPtr> elems;
+    std::vector<Value> elems;
+    elems.reserve(arr.b);
 
-    for (auto &expr : arr->elements)
-        elems.push_back(evaluate(expr, env, line));
+    const NodeId* elements = ast.list(arr.a);
+    for (uint32_t i = 0; i < arr.b; i++)
+        elems.push_back(evaluate(ast, elements[i], env, line));
 
-    return std::make_shared<ArrayValue>(elems);
+    return Value::Object(new ArrayValue(std::move(elems)));
 }
 
 /* ------------------------- */
 
-RVPtr eval_binary_expr(std::shared_ptr<ASTBinaryExpr> bin, Environment* env, std::size_t line)
+static Value make_number(int v) { return Value::Int(v); }
+static Value make_number(double v) { return Value::Float(v); }
+
+// Ints wrap around (int_ops.hh), floats are plain double arithmetic
+static int add(int x, int y) { return int_add(x, y); }
+static int sub(int x, int y) { return int_sub(x, y); }
+static int mul(int x, int y) { return int_mul(x, y); }
+static double add(double x, double y) { return x + y; }
+static double sub(double x, double y) { return x - y; }
+static double mul(double x, double y) { return x * y; }
+
+// Operators with a specialized form for two ints or two floats; '/' and '%'
+// keep the checks of value_binary()
+static bool specializable(OpKind op)
 {
-    RVPtr left_val = evaluate(bin->left, env, line);
-    RVPtr right_val = evaluate(bin->right, env, line);
-    const std::string& op = bin->op;
-
-    if (!left_val || !right_val || left_val->kind == VAL_NULL || right_val->kind == VAL_NULL)
-        return std::make_shared<NullValue>();
-
-    // Short-circuit logical operators
-    if (op == "&&" || op == "and") {
-        bool left_bool = std::dynamic_pointer_cast<BoolValue>(cast(left_val, VAL_BOOL, line))->value;
-        if (!left_bool) return std::make_shared<BoolValue>(false);
-        bool right_bool = std::dynamic_pointer_cast<BoolValue>(cast(right_val, VAL_BOOL, line))->value;
-        return std::make_shared<BoolValue>(left_bool && right_bool);
+    return op >= OpKind::Add && op <= OpKind::Lte && op != OpKind::Div && op != OpKind::Mod;
+}
+
+// A specializable operator applied to two operands of the same numeric type
+template <typename T>
+static Value numeric_binary(OpKind op, T x, T y)
+{
+    switch (op) {
+        case OpKind::Add: return make_number(add(x, y));
+        case OpKind::Sub: return make_number(sub(x, y));
+        case OpKind::Mul: return make_number(mul(x, y));
+        case OpKind::Eq:  return Value::Bool(x == y);
+        case OpKind::Neq: return Value::Bool(x != y);
+        case OpKind::Gt:  return Value::Bool(x > y);
+        case OpKind::Gte: return Value::Bool(x >= y);
+        case OpKind::Lt:  return Value::Bool(x < y);
+        default:          return Value::Bool(x <= y);
     }
-    if (op == "||" || op == "or") {
-        bool left_bool = std::dynamic_pointer_cast<BoolValue>(cast(left_val, VAL_BOOL, line))->value;
-        if (left_bool) return std::make_shared<BoolValue>(true);
-        bool right_bool = std::dynamic_pointer_cast<BoolValue>(cast(right_val, VAL_BOOL, line))->value;
-        return std::make_shared<BoolValue>(left_bool || right_bool);
+}
+
+Value eval_binary_expr(const Ast& ast, const Node& bin, Environment* env, std::size_t line)
+{
+    Value left_val = evaluate(ast, bin.a, env, line);
+
+    // Short-circuit logical operators, the right side only runs when needed
+    if (bin.op == OpKind::And || bin.op == OpKind::Or) {
+        if (left_val.kind == VAL_NULL) return Value::Null();
+
+        bool left_bool = cast(left_val, VAL_BOOL, line).b;
+        if (bin.op == OpKind::And && !left_bool) return Value::Bool(false);
+        if (bin.op == OpKind::Or && left_bool) return Value::Bool(true);
+
+        Value right_val = evaluate(ast, bin.b, env, line);
+        if (right_val.kind == VAL_NULL) return Value::Null();
+        return Value::Bool(cast(right_val, VAL_BOOL, line).b);
     }
 
-    // Arithmetic
-    if (op == "+") return left_val->add(right_val, line);
-    if (op == "-") return left_val->sub(right_val, line);
-    if (op == "*") return left_val->mul(right_val, line);
-    if (op == "/") return left_val->div(right_val, line);
-    if (op == "%") return left_val->mod(right_val, line);
-
-    if (op == "==") return left_val->eq(right_val, line);
-    if (op == "!=") return left_val->neq(right_val, line);
-    if (op == ">") return left_val->gt(right_val, line);
-    if (op == ">=") return left_val->gte(right_val, line);
-    if (op == "<") return left_val->lt(right_val, line);
-    if (op == "<=") return left_val->lte(right_val, line);
-
-    runtime_err("unknown binary operator '" + op + "'", line);
-    return nullptr;
-}
+    Value right_val = evaluate(ast, bin.b, env, line);
 
-RVPtr eval_unary_expr(std::shared_ptr<ASTUnaryExpr> unary, Environment* env, std::size_t line) {
-    auto value = evaluate(unary->operand, env, line);
+    // Both operands are proven ints, skip the dispatch table
+    if (bin.has(FLAG_INT_OPERANDS) && specializable(bin.op)) {
+        assert(left_val.kind == VAL_INT && right_val.kind == VAL_INT);
+        Ast::quicken(bin, NodeType::IntBinaryExpr);
+        return numeric_binary(bin.op, left_val.i, right_val.i);
+    }
 
-    if (!value) {
-        runtime_err("ryc: null value in unary expression.", line);
+    if (bin.op < OpKind::Add || bin.op > OpKind::Lte) {
+        runtime_err(std::string("unknown binary operator '") + op_str(bin.op) + "'", line);
     }
 
-    if (unary->op == "-") {
-        // Numeric negation
-        switch (value->kind) {
-            case VAL_INT: {
-                int iv = std::dynamic_pointer_cast<IntValue>(value)->value;
-                return std::make_shared<IntValue>(-iv);
-            }
-            case VAL_FLOAT: {
-                double fv = std::dynamic_pointer_cast<FloatValue>(value)->value;
-                return std::make_shared<FloatValue>(-fv);
-            }
-            default: {
-                runtime_err("ryc: unary '-' can only be applied to numeric types.", line);
-            }
+    // Specialize on the operand kinds seen by this first execution
+    if (!bin.has(FLAG_GENERIC) && specializable(bin.op)) {
+        if (left_val.kind == VAL_INT && right_val.kind == VAL_INT) {
+            Ast::quicken(bin, NodeType::IntBinaryExpr);
+        } else if (left_val.kind == VAL_FLOAT && right_val.kind == VAL_FLOAT) {
+            Ast::quicken(bin, NodeType::FloatBinaryExpr);
         }
     }
-    else if (unary->op == "+") {
-        switch (value->kind) {
-            case VAL_INT: {
-                int iv = std::dynamic_pointer_cast<IntValue>(value)->value;
-                return std::make_shared<IntValue>(iv);
-            }
-            case VAL_FLOAT: {
-                double fv = std::dynamic_pointer_cast<FloatValue>(value)->value;
-                return std::make_shared<FloatValue>(fv);
-            }
-            default: {
-                runtime_err("ryc: unary '+' can only be applied to numeric types.", line);
-            }
-        }
+
+    return value_binary(bin.op, left_val, right_val, line);
+}
+
+Value eval_int_binary_expr(const Ast& ast, const Node& bin, Environment* env, std::size_t line)
+{
+    Value left_val = evaluate(ast, bin.a, env, line);
+    Value right_val = evaluate(ast, bin.b, env, line);
+
+    if (left_val.kind == VAL_INT && right_val.kind == VAL_INT) {
+        return numeric_binary(bin.op, left_val.i, right_val.i);
     }
-    else if (unary->op == "!") {
-        // Boolean negation
-        switch (value->kind) {
-            case VAL_INT: {
-                int iv = std::dynamic_pointer_cast<IntValue>(value)->value;
-                return std::make_shared<BoolValue>(iv == 0);
-            }
-            case VAL_FLOAT: {
-                double fv = std::dynamic_pointer_cast<FloatValue>(value)->value;
-                return std::make_shared<BoolValue>(fv == 0.0);
-            }
-            case VAL_BOOL: {
-                bool bv = std::dynamic_pointer_cast<BoolValue>(value)->value;
-                return std::make_shared<BoolValue>(!bv);
-            }
-            case VAL_NULL: {
-                return std::make_shared<BoolValue>(true);
-            }
-            default: {
-                runtime_err("ryc: unary '!' can only be applied to truthy values.", line);
-            }
-        }
+
+    Ast::deoptimize(bin, NodeType::BinaryExpr);
+    return value_binary(bin.op, left_val, right_val, line);
+}
+
+Value eval_float_binary_expr(const Ast& ast, const Node& bin, Environment* env, std::size_t line)
+{
+    Value left_val = evaluate(ast, bin.a, env, line);
+    Value right_val = evaluate(ast, bin.b, env, line);
+
+    if (left_val.kind == VAL_FLOAT && right_val.kind == VAL_FLOAT) {
+        return numeric_binary(bin.op, left_val.f, right_val.f);
     }
-    else if (unary->op == "++" || unary->op == "--") {
-        RVPtr oldVal = nullptr;
-        RVPtr newVal = nullptr;
-
-        if (auto ident = std::dynamic_pointer_cast<ASTIdentifierLiteral>(unary->operand)) {
-            // Lookup the variable
-            oldVal = env->lookupVar(ident->name, line);
-            if (!oldVal) {
-                runtime_err("ryc: cannot " + std::string(unary->op == "++" ? "increment" : "decrement") + " uninitialized variable " + ident->name, line);
-            }
 
-            switch (oldVal->kind) {
+    Ast::deoptimize(bin, NodeType::BinaryExpr);
+    return value_binary(bin.op, left_val, right_val, line);
+}
+
+Value eval_unary_expr(const Ast& ast, const Node& unary, Environment* env, std::size_t line) {
+    const std::string op = op_str(unary.op);
+
+    switch (unary.op) {
+        case OpKind::Sub:
+        {
+            // Numeric negation
+            Value value = evaluate(ast, unary.a, env, line);
+            switch (value.kind) {
+                case VAL_INT:   return Value::Int(int_neg(value.i));
+                case VAL_FLOAT: return Value::Float(-value.f);
+                default:
+                    runtime_err("ryc: unary '-' can only be applied to numeric types.", line);
+            }
+            break;
+        }
+        case OpKind::Add:
+        {
+            Value value = evaluate(ast, unary.a, env, line);
+            switch (value.kind) {
                 case VAL_INT:
-                    newVal = std::make_shared<IntValue>(
-                        unary->op == "++" 
-                            ? std::dynamic_pointer_cast<IntValue>(oldVal)->value + 1
-                            : std::dynamic_pointer_cast<IntValue>(oldVal)->value - 1
-                    );
-                    break;
                 case VAL_FLOAT:
-                    newVal = std::make_shared<FloatValue>(
-                        unary->op == "++" 
-                            ? std::dynamic_pointer_cast<FloatValue>(oldVal)->value + 1.0
-                            : std::dynamic_pointer_cast<FloatValue>(oldVal)->value - 1.0
-                    );
-                    break;
+                    return value;
                 default:
-                    runtime_err("ryc: unary '" + unary->op + "' can only be applied to numeric values.", line);
+                    runtime_err("ryc: unary '+' can only be applied to numeric types.", line);
             }
-
-            env->assignVar(ident->name, newVal, line);
+            break;
+        }
+        case OpKind::Not:
+        {
+            // Boolean negation
+            Value value = evaluate(ast, unary.a, env, line);
+            switch (value.kind) {
+                case VAL_INT:   return Value::Bool(value.i == 0);
+                case VAL_FLOAT: return Value::Bool(value.f == 0.0);
+                case VAL_BOOL:  return Value::Bool(!value.b);
+                case VAL_NULL:  return Value::Bool(true);
+                default:
+                    runtime_err("ryc: unary '!' can only be applied to truthy values.", line);
+            }
+            break;
         }
-        else if (auto member = std::dynamic_pointer_cast<ASTMemberExpr>(unary->operand)) {
-            // Lookup the array or object
-            RVPtr objVal = evaluate(member->object, env, line);
+        case OpKind::Inc:
+        case OpKind::Dec:
+        {
+            Value oldVal;
+            Value newVal;
+            int delta = unary.op == OpKind::Inc ? 1 : -1;
+            const Node& operand = ast[unary.a];
+
+            if (operand.kind == NodeType::IdentifierLiteral) {
+                ScopeSlot slot = ast.slot(operand);
+                const std::string& name = ast.name(operand.a);
+
+                // Lookup the variable
+                oldVal = env->lookupVar(slot, name, line);
+
+                switch (oldVal.kind) {
+                    case VAL_INT:
+                        newVal = Value::Int(int_add(oldVal.i, delta));
+                        break;
+                    case VAL_FLOAT:
+                        newVal = Value::Float(oldVal.f + delta);
+                        break;
+                    default:
+                        runtime_err("ryc: unary '" + op + "' can only be applied to numeric values.", line);
+                }
 
-            if (objVal->kind != VAL_ARRAY) {
-                runtime_err("ryc: unary '" + unary->op + "' can only be applied to numeric array elements", line);
+                if (unary.has(FLAG_NO_CAST)) env->storeVar(slot, name, newVal, line);
+                else env->assignVar(slot, name, newVal, line);
             }
+            else if (operand.kind == NodeType::MemberExpr) {
+                // Lookup the array or object
+                Value objVal = evaluate(ast, operand.a, env, line);
 
-            auto arrVal = std::dynamic_pointer_cast<ArrayValue>(objVal);
+                if (objVal.kind != VAL_ARRAY) {
+                    runtime_err("ryc: unary '" + op + "' can only be applied to numeric array elements", line);
+                }
 
-            // Evaluate the index
-            auto idxVal = evaluate(member->property, env, line);
-            if (idxVal->kind != VAL_INT) {
-                runtime_err("ryc: array index must be an integer", line);
-            }
+                auto arrVal = objVal.as<ArrayValue>();
 
-            int idx = std::dynamic_pointer_cast<IntValue>(idxVal)->value;
+                // Evaluate the index
+                Value idxVal = evaluate(ast, operand.b, env, line);
+                if (idxVal.kind != VAL_INT) {
+                    runtime_err("ryc: array index must be an integer", line);
+                }
 
-            if (idx < 0 || idx >= static_cast<int>(arrVal->elements.size())) {
-                runtime_err("ryc: array index out of bounds", line);
-            }
+                int idx = idxVal.i;
 
-            oldVal = arrVal->elements[idx];
+                if (idx < 0 || idx >= static_cast<int>(arrVal->size())) {
+                    runtime_err("ryc: array index out of bounds", line);
+                }
 
-            switch (oldVal->kind) {
-                case VAL_INT:
-                    newVal = std::make_shared<IntValue>(
-                        unary->op == "++" 
-                            ? std::dynamic_pointer_cast<IntValue>(oldVal)->value + 1
-                            : std::dynamic_pointer_cast<IntValue>(oldVal)->value - 1
-                    );
-                    break;
-                case VAL_FLOAT:
-                    newVal = std::make_shared<FloatValue>(
-                        unary->op == "++" 
-                            ? std::dynamic_pointer_cast<FloatValue>(oldVal)->value + 1.0
-                            : std::dynamic_pointer_cast<FloatValue>(oldVal)->value - 1.0
-                    );
-                    break;
-                default:
-                    runtime_err("ryc: unary '" + unary->op + "' can only be applied to numeric values.", line);
+                oldVal = arrVal->get(idx);
+
+                switch (oldVal.kind) {
+                    case VAL_INT:
+                        newVal = Value::Int(int_add(oldVal.i, delta));
+                        break;
+                    case VAL_FLOAT:
+                        newVal = Value::Float(oldVal.f + delta);
+                        break;
+                    default:
+                        runtime_err("ryc: unary '" + op + "' can only be applied to numeric values.", line);
+                }
+
+                arrVal->set(idx, newVal);
+            }
+            else {
+                runtime_err("ryc: " + op + " can only be applied to assignable values.", line);
             }
 
-            arrVal->elements[idx] = newVal;
-        }
-        else {
-            runtime_err("ryc: " + unary->op + " can only be applied to assignable values.", line);
+            return unary.has(FLAG_PREFIX) ? newVal : oldVal;
         }
-
-        return unary->prefix ? newVal : oldVal;
-    }
-    else {
-        const std::string err = "ryc: unknown unary operator '" + unary->op + "'.";
-        runtime_err(err, line);
+        default:
+            break;
     }
 
-    return nullptr;
+    runtime_err("ryc: unknown unary operator '" + op + "'.", line);
+    return Value();
 }
 
-RVPtr eval_assign_expr(std::shared_ptr<ASTAssignExpr> assign, Environment* env, std::size_t line)
+Value eval_assign_expr(const Ast& ast, const Node& assign, Environment* env, std::size_t line)
 {
+    const Node& assignee = ast[assign.a];
+
     // --- Member / array assignment: x[i] = value ---
-    if (auto member = std::dynamic_pointer_cast<ASTMemberExpr>(assign->assignee)) {
-        RVPtr objVal = evaluate(member->object, env, line);
-        if (objVal->kind != VAL_ARRAY) runtime_err("attempting to index a non-array value", line);
+    if (assignee.kind == NodeType::MemberExpr) {
+        Value objVal = evaluate(ast, assignee.a, env, line);
+        if (objVal.kind != VAL_ARRAY) runtime_err("attempting to index a non-array value", line);
 
-        auto arr = std::dynamic_pointer_cast<ArrayValue>(objVal);
-        RVPtr indexVal = evaluate(member->property, env, line);
+        auto arr = objVal.as<ArrayValue>();
+        Value indexVal = evaluate(ast, assignee.b, env, line);
 
-        if (indexVal->kind != VAL_INT) runtime_err("array index must be an integer", line);
-        size_t idx = static_cast<size_t>(std::dynamic_pointer_cast<IntValue>(indexVal)->value);
-        if (idx >= arr->elements.size()) runtime_err("array index out of bounds", line);
+        if (indexVal.kind != VAL_INT) runtime_err("array index must be an integer", line);
+        size_t idx = static_cast<size_t>(indexVal.i);
+        if (idx >= arr->size()) runtime_err("array index out of bounds", line);
 
-        RVPtr value = evaluate(assign->value, env, line);
-        arr->elements[idx] = value;
+        Value value = cast_element(arr, evaluate(ast, assign.b, env, line), line);
+        arr->set(idx, value);
 
         return value;
     }
 
     // --- Regular assignment
-    if (auto ident = std::dynamic_pointer_cast<ASTIdentifierLiteral>(assign->assignee)) {
-        RVPtr value = evaluate(assign->value, env, line);
+    if (assignee.kind == NodeType::IdentifierLiteral) {
+        Value value = evaluate(ast, assign.b, env, line);
 
-        return env->assignVar(ident->name, value, line);
+        if (assign.has(FLAG_NO_CAST)) return env->storeVar(ast.slot(assignee), ast.name(assignee.a), value, line);
+        return env->assignVar(ast.slot(assignee), ast.name(assignee.a), value, line);
     }
 
     runtime_err("invalid assignee in assignment expression", line);
-    return nullptr;
+    return Value();
 }
 
-RVPtr eval_member_expr(std::shared_ptr<ASTMemberExpr> node, Environment* env, std::size_t line)
+static Value index_value(const Value& obj, const Value& prop, std::size_t line)
 {
-    RVPtr obj = evaluate(node->object, env, line);
+    int idx = 0;
+    if (prop.kind == VAL_INT) {
+        idx = prop.i;
+    } else {
+        runtime_err("array index must be an integer", line);
+    }
 
-    if (!obj) runtime_err("null object in member expression", line);
+    if (obj.kind != VAL_ARRAY) runtime_err("object is not an array", line);
+    auto arr = obj.as<ArrayValue>();
 
-    if (node->computed) {
-        RVPtr prop = evaluate(node->property, env, line);
+    if (idx < 0 || idx >= (int)arr->size())
+        runtime_err("array index out of bounds", line);
 
-        int idx = 0;
-        if (prop->kind == VAL_INT) {
-            idx = std::dynamic_pointer_cast<IntValue>(prop)->value;
-        } else {
-            runtime_err("array index must be an integer", line);
+    return arr->get(idx);
+}
+
+Value eval_member_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line)
+{
+    Value obj = evaluate(ast, node.a, env, line);
+
+    if (node.has(FLAG_COMPUTED)) {
+        Value prop = evaluate(ast, node.b, env, line);
+        Value value = index_value(obj, prop, line);
+
+        if (!node.has(FLAG_GENERIC) && obj.as<ArrayValue>()->elem_type == VAL_INT) {
+            Ast::quicken(node, NodeType::IntIndexExpr);
         }
 
-        auto arr = std::dynamic_pointer_cast<ArrayValue>(obj);
-        if (!arr) runtime_err("object is not an array", line);
+        return value;
+    }
 
-        if (idx < 0 || idx >= (int)arr->elements.size())
-            runtime_err("array index out of bounds", line);
+    return Value();
+}
 
-        return arr->elements[idx];
+Value eval_int_index_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line)
+{
+    Value obj = evaluate(ast, node.a, env, line);
+    Value prop = evaluate(ast, node.b, env, line);
+
+    if (obj.kind == VAL_ARRAY && prop.kind == VAL_INT) {
+        auto arr = obj.as<ArrayValue>();
+        if (arr->elem_type == VAL_INT) {
+            if (prop.i < 0 || prop.i >= static_cast<int>(arr->ints.size()))
+                runtime_err("array index out of bounds", line);
+            return Value::Int(arr->ints[prop.i]);
+        }
     }
+
+    Ast::deoptimize(node, NodeType::MemberExpr);
+    return index_value(obj, prop, line);
 }
 
-RVPtr eval_call_expr(std::shared_ptr<ASTCallExpr> node, Environment* env, std::size_t line)
+Value eval_identifier(const Ast& ast, const Node& node, Environment* env, std::size_t line)
 {
-    auto callee = evaluate(node->callee, env, line);
+    Value value = env->lookupVar(ast.slot(node), ast.name(node.a), line);
 
-    if (callee->kind != VAL_FUNCTION) {
+    // The address is valid, later reads skip the checks of lookupVar()
+    Ast::quicken(node, NodeType::SlotIdentifier);
+    return value;
+}
+
+Value eval_slot_identifier(const Ast& ast, const Node& node, Environment* env, std::size_t line)
+{
+    if (const VarInfo* var = env->find(ast.slot(node))) return var->value;
+
+    // Read before its declaration ran, lookupVar() reports it
+    return env->lookupVar(ast.slot(node), ast.name(node.a), line);
+}
+
+void bind_params(const Ast& fn_ast, const AstFunction& decl, std::vector<Value>& args,
+                 Environment* local_env, Environment* env, std::size_t line)
+{
+    if (args.size() < decl.params_count) {
+        runtime_err("function '" + fn_ast.name(decl.name) + "' expects " + std::to_string(decl.params_count) +
+                    " arguments but got " + std::to_string(args.size()), line);
+    }
+
+    for (uint32_t i = 0; i < decl.params_count; i++) {
+        const AstParam& param = fn_ast.params[decl.params_begin + i];
+        const std::string& param_type = fn_ast.name(param.type);
+        bool is_auto = param_type == "auto";
+        Value& arg_val = args[i];
+
+        // Non-auto types come from the type checker when it knew them
+        ValueType declared = VAL_NULL;
+        if (!is_auto) {
+            declared = param.value_type != NO_TYPE ? static_cast<ValueType>(param.value_type)
+                                                   : stoval(param_type, env, line);
+        }
+
+        if (param.is_array) {
+            if (arg_val.kind != VAL_ARRAY) {
+                runtime_err("expected array argument for parameter '" + fn_ast.name(param.name) + "'", line);
+            }
+            auto arr = arg_val.as<ArrayValue>();
+
+            ValueType elemType = declared;
+            if (is_auto) {
+                // Keep the recorded element type, untyped arrays infer it
+                // from their first element (or null if empty)
+                elemType = arr->elem_type;
+                if (elemType == VAL_NULL && !arr->empty()) elemType = arr->get(0).kind;
+            }
+
+            cast_elements(arr, elemType, line);
+            local_env->declareVar(param.slot, fn_ast.name(param.name), arg_val, VAL_ARRAY, true, line);
+        } else {
+            // auto parameters take the argument's type
+            ValueType expected_type = is_auto ? arg_val.kind : declared;
+            local_env->declareVar(param.slot, fn_ast.name(param.name), cast(arg_val, expected_type, line), expected_type, true, line);
+        }
+    }
+}
+
+Value eval_call_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line)
+{
+    Value callee = evaluate(ast, node.a, env, line);
+
+    if (callee.kind != VAL_FUNCTION) {
         runtime_err("attempted to call a non-function value", line);
     }
 
-    std::vector<RVPtr> args;
-    for (auto& a : node->args) {
-        args.push_back(evaluate(a, env, line));
+    std::vector<Value> args;
+    args.reserve(node.c);
+    const NodeId* arg_nodes = ast.list(node.b);
+    for (uint32_t i = 0; i < node.c; i++) {
+        args.push_back(evaluate(ast, arg_nodes[i], env, line));
     }
 
     // ----------------------------
     // Native function
-    if (auto native = std::dynamic_pointer_cast<NativeFunctionValue>(callee)) {
+    if (auto native = dynamic_cast<NativeFunctionValue*>(callee.obj)) {
         return native->func(args, env, line);
     }
 
     // ----------------------------
     // User-defined function
-    if (auto func = std::dynamic_pointer_cast<FunctionValue>(callee)) {
-        auto local_env = new Environment(func->closure);
-        local_env->current_return_type = func->declaration->ret_type;
+    if (auto func = dynamic_cast<FunctionValue*>(callee.obj)) {
+        const Ast& fn_ast = *func->ast;
+        const AstFunction& decl = *func->declaration;
 
-        for (size_t i = 0; i < func->declaration->params.size(); i++) {
-            auto param = func->declaration->params[i];
-            RVPtr arg_val = args[i];
+        auto local_env = Environment::push(func->closure, decl.param_scope_size);
+        local_env->current_return_type = fn_ast.name(decl.ret_type);
 
-            if (param->isArray) {
-                if (arg_val->kind != VAL_ARRAY) {
-                    runtime_err("expected array argument for parameter '" + param->name + "'", line);
-                }
-                auto arr = std::dynamic_pointer_cast<ArrayValue>(arg_val);
-                
-                ValueType elemType;
-                if (param->type == "auto") {
-                    // Infer element type from the first array element (or null if empty)
-                    elemType = arr->elements.empty() ? VAL_NULL : arr->elements[0]->kind;
-                } else {
-                    elemType = stoval(param->type, func->declaration, env, line);
-                }
-                
-                for (auto& elem : arr->elements) {
-                    elem = cast(elem, elemType, line);
-                }
-                local_env->declareVar(param->name, arr, VAL_ARRAY, true, line);
-            } else {
-                ValueType expected_type;
-                if (param->type == "auto") {
-                    // Infer type directly from the argument's kind
-                    expected_type = arg_val->kind;
-                } else {
-                    expected_type = stoval(param->type, func->declaration, env, line);
-                }
-                
-                arg_val = cast(arg_val, expected_type, line);
-                local_env->declareVar(param->name, arg_val, expected_type, true, line);
-            }
-        }
+        bind_params(fn_ast, decl, args, local_env, env, line);
 
-        auto body = std::static_pointer_cast<ASTBlockStmt>(func->declaration->body);
-        auto res = eval_block_stmt(body, local_env, line);
+        // Both a return and falling off the end yield the completion's value
+        Value res = eval_block_stmt(fn_ast, fn_ast[decl.body], local_env, line).value;
 
-        if (res->kind == VAL_RETURN) {
-            res = std::dynamic_pointer_cast<ReturnValue>(res)->value;
-        
-        }
-        delete local_env;
+        Environment::pop(local_env);
         return res;
     }
 
     runtime_err("unknown function type", line);
-    return nullptr;
+    return Value();
 }
 
-RVPtr eval_cast_expr(std::shared_ptr<ASTCastExpr> node, Environment* env, std::size_t line) {
-    auto value = evaluate(node->target, env, line);
-    ValueType target_type = stoval(node->type, node, env, line);
+Value eval_cast_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line) {
+    Value value = evaluate(ast, node.b, env, line);
+    // The checker leaves unknown target names to stoval() and its error
+    ValueType target_type = node.c != NO_TYPE ? static_cast<ValueType>(node.c) : stoval(ast.name(node.a), env, line);
+
+    return static_cast_value(value, target_type);
+}
 
+Value static_cast_value(const Value& value, ValueType target_type) {
     // Null always converts to default values
-    if (value->kind == VAL_NULL) {
+    if (value.kind == VAL_NULL) {
         switch (target_type) {
-            case VAL_INT:    return std::make_shared<IntValue>(0);
-            case VAL_FLOAT:  return std::make_shared<FloatValue>(0.0);
-            case VAL_BOOL:   return std::make_shared<BoolValue>(false);
-            case VAL_STRING: return std::make_shared<StringValue>("null");
-            case VAL_ARRAY:  return std::make_shared<ArrayValue>(std::vector<RVPtr>{});
-            case VAL_NULL:   return std::make_shared<NullValue>();
-            default:         return std::make_shared<NullValue>();
+            case VAL_INT:    return Value::Int(0);
+            case VAL_FLOAT:  return Value::Float(0.0);
+            case VAL_BOOL:   return Value::Bool(false);
+            case VAL_STRING: return Value::String("null");
+            case VAL_ARRAY:  return Value::Object(new ArrayValue({}));
+            case VAL_NULL:   return Value::Null();
+            default:         return Value::Null();
         }
     }
 
     switch (target_type) {
         case VAL_INT:
-            switch (value->kind) {
+            switch (value.kind) {
                 case VAL_FLOAT:
-                    return std::make_shared<IntValue>(static_cast<int>(std::dynamic_pointer_cast<FloatValue>(value)->value));
+                    return Value::Int(static_cast<int>(value.f));
                 case VAL_BOOL:
-                    return std::make_shared<IntValue>(std::dynamic_pointer_cast<BoolValue>(value)->value ? 1 : 0);
+                    return Value::Int(value.b ? 1 : 0);
                 case VAL_STRING: {
                     try {
-                        int v = std::stoi(std::dynamic_pointer_cast<StringValue>(value)->value);
-                        return std::make_shared<IntValue>(v);
+                        return Value::Int(std::stoi(value.as_string()));
                     } catch (...) {
-                        return std::make_shared<NullValue>();
+                        return Value::Null();
                     }
                 }
                 case VAL_INT:
                     return value;
                 default:
-                    return std::make_shared<NullValue>();
+                    return Value::Null();
             }
             break;
 
         case VAL_FLOAT:
-            switch (value->kind) {
+            switch (value.kind) {
                 case VAL_INT:
-                    return std::make_shared<FloatValue>(static_cast<double>(std::dynamic_pointer_cast<IntValue>(value)->value));
+                    return Value::Float(static_cast<double>(value.i));
                 case VAL_BOOL:
-                    return std::make_shared<FloatValue>(std::dynamic_pointer_cast<BoolValue>(value)->value ? 1.0 : 0.0);
+                    return Value::Float(value.b ? 1.0 : 0.0);
                 case VAL_STRING: {
                     try {
-                        double v = std::stod(std::dynamic_pointer_cast<StringValue>(value)->value);
-                        return std::make_shared<FloatValue>(v);
+                        return Value::Float(std::stod(value.as_string()));
                     } catch (...) {
-                        return std::make_shared<NullValue>();
+                        return Value::Null();
                     }
                 }
                 case VAL_FLOAT:
                     return value;
                 default:
-                    return std::make_shared<NullValue>();
+                    return Value::Null();
             }
             break;
 
         case VAL_BOOL:
-            switch (value->kind) {
+            switch (value.kind) {
                 case VAL_INT:
-                    return std::make_shared<BoolValue>(std::dynamic_pointer_cast<IntValue>(value)->value != 0);
+                    return Value::Bool(value.i != 0);
                 case VAL_FLOAT:
-                    return std::make_shared<BoolValue>(std::dynamic_pointer_cast<FloatValue>(value)->value != 0.0);
+                    return Value::Bool(value.f != 0.0);
                 case VAL_STRING:
-                    return std::make_shared<BoolValue>(!std::dynamic_pointer_cast<StringValue>(value)->value.empty());
+                    return Value::Bool(!value.as_string().empty());
                 case VAL_BOOL:
                     return value;
                 case VAL_ARRAY:
-                    return std::make_shared<BoolValue>(!std::dynamic_pointer_cast<ArrayValue>(value)->elements.empty());
+                    return Value::Bool(!value.as<ArrayValue>()->empty());
                 default:
-                    return std::make_shared<NullValue>();
+                    return Value::Null();
             }
             break;
 
         case VAL_STRING:
-            switch (value->kind) {
+            switch (value.kind) {
                 case VAL_INT:
-                    return std::make_shared<StringValue>(std::to_string(std::dynamic_pointer_cast<IntValue>(value)->value));
+                    return Value::String(std::to_string(value.i));
                 case VAL_FLOAT:
-                    return std::make_shared<StringValue>(std::to_string(std::dynamic_pointer_cast<FloatValue>(value)->value));
+                    return Value::String(std::to_string(value.f));
                 case VAL_BOOL:
-                    return std::make_shared<StringValue>(std::dynamic_pointer_cast<BoolValue>(value)->value ? "true" : "false");
+                    return Value::String(value.b ? "true" : "false");
                 case VAL_STRING:
                     return value;
                 case VAL_ARRAY: {
                     std::string s = "[";
-                    auto arr = std::dynamic_pointer_cast<ArrayValue>(value);
-                    for (size_t i = 0; i < arr->elements.size(); ++i) {
-                        s += vtostr(arr->elements[i]->kind);
-                        if (i + 1 < arr->elements.size()) s += ", ";
+                    auto arr = value.as<ArrayValue>();
+                    for (size_t i = 0; i < arr->size(); ++i) {
+                        s += vtostr(arr->get(i).kind);
+                        if (i + 1 < arr->size()) s += ", ";
                     }
                     s += "]";
-                    return std::make_shared<StringValue>(s);
+                    return Value::String(s);
                 }
                 case VAL_NULL:
-                    return std::make_shared<StringValue>("null");
+                    return Value::String("null");
                 default:
-                    return std::make_shared<NullValue>();
+                    return Value::Null();
             }
             break;
         case VAL_CHAR:
-            switch (value->kind) {
+            switch (value.kind) {
                 case VAL_INT:
-                    return std::make_shared<CharValue>(static_cast<char>(std::dynamic_pointer_cast<IntValue>(value)->value));
+                    return Value::Char(static_cast<char>(value.i));
                 case VAL_STRING: {
-                    auto s = std::dynamic_pointer_cast<StringValue>(value)->value;
-                    if (!s.empty()) return std::make_shared<CharValue>(s[0]);
-                    return std::make_shared<NullValue>();
+                    const std::string& s = value.as_string();
+                    if (!s.empty()) return Value::Char(s[0]);
+                    return Value::Null();
                 }
                 case VAL_CHAR:
                     return value;
                 default:
-                    return std::make_shared<NullValue>();
+                    return Value::Null();
             }
         case VAL_ARRAY:
-            return std::make_shared<ArrayValue>(std::vector<RVPtr>{value});
+            return Value::Object(new ArrayValue({value}));
 
         case VAL_NULL:
-            return std::make_shared<NullValue>();
+            return Value::Null();
 
         default:
-            return std::make_shared<NullValue>();
+            return Value::Null();
     }
 
-    return nullptr;
+    return Value();
 }
@@ -12,13 +12,27 @@ expressions.hh
 #include "../values.hh"
 #include "../interpreter/interpreter.hh"
 
-using RVPtr = std::shared_ptr<RuntimeValue>;
+Value eval_binary_expr(const Ast& ast, const Node& bin, Environment* env, std::size_t line);
+Value eval_unary_expr(const Ast& ast, const Node& unary, Environment* env, std::size_t line);
+Value eval_assign_expr(const Ast& ast, const Node& assign, Environment* env, std::size_t line);
+Value eval_member_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Value eval_call_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Value eval_cast_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Value eval_identifier(const Ast& ast, const Node& node, Environment* env, std::size_t line);
 
-RVPtr eval_binary_expr(std::shared_ptr<ASTBinaryExpr> bin, Environment* env, std::size_t line);
-RVPtr eval_unary_expr(std::shared_ptr<ASTUnaryExpr> unary, Environment* env, std::size_t line);
-RVPtr eval_assign_expr(std::shared_ptr<ASTAssignExpr> assign, Environment* env, std::size_t line);
-RVPtr eval_member_expr(std::shared_ptr<ASTMemberExpr> node, Environment* env, std::size_t line);
-RVPtr eval_call_expr(std::shared_ptr<ASTCallExpr> node, Environment* env, std::size_t line);
-RVPtr eval_cast_expr(std::shared_ptr<ASTCastExpr> node, Environment* env, std::size_t line);
+// Declares a call's arguments as the parameters of 'decl' in local_env, cast
+// to their declared types. Shared by the tree walker and the closure engine.
+void bind_params(const Ast& fn_ast, const AstFunction& decl, std::vector<Value>& args,
+                 Environment* local_env, Environment* env, std::size_t line);
 
-RVPtr eval_array_literal(std::shared_ptr<ASTArrayLiteral> arr, Environment* env, std::size_t line);
\ No newline at end of file
+// Quickened forms (see Ast::quicken). Each checks the operand kinds it was
+// specialized for and turns back into the generic node when they differ.
+Value eval_int_binary_expr(const Ast& ast, const Node& bin, Environment* env, std::size_t line);
+Value eval_float_binary_expr(const Ast& ast, const Node& bin, Environment* env, std::size_t line);
+Value eval_int_index_expr(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Value eval_slot_identifier(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+
+// static_cast<T>() conversion rules, shared with the bytecode VM
+Value static_cast_value(const Value& value, ValueType target_type);
+
+Value eval_array_literal(const Ast& ast, const Node& arr, Environment* env, std::size_t line);
\ No newline at end of file
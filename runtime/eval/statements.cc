@@ -2,133 +2,115 @@
 #include "../../utils/utils.hh"
 #include "../../utils/error.hh"
 
-RVPtr default_val(ValueType targetType, std::size_t line)
+Value default_val(ValueType targetType, std::size_t line)
 {
     switch (targetType) {
-        case VAL_INT:     return std::make_shared<IntValue>(0); break;
-        case VAL_FLOAT:   return std::make_shared<FloatValue>(0.0); break;
-        case VAL_BOOL:    return std::make_shared<BoolValue>(false); break;
-        case VAL_STRING:  return std::make_shared<StringValue>(""); break;
-        case VAL_CHAR:    return std::make_shared<CharValue>('\0'); break;
-        case VAL_NULL:    return std::make_shared<NullValue>(); break;
+        case VAL_INT:     return Value::Int(0); break;
+        case VAL_FLOAT:   return Value::Float(0.0); break;
+        case VAL_BOOL:    return Value::Bool(false); break;
+        case VAL_STRING:  return Value::String(""); break;
+        case VAL_CHAR:    return Value::Char('\0'); break;
+        case VAL_NULL:    return Value::Null(); break;
         default: runtime_err("unknown variable type", line);
     }
 
-    return nullptr;
+    return Value();
 }
 
-RVPtr cast(RVPtr value, ValueType targetType, std::size_t line)
+Value cast(const Value& value, ValueType targetType, std::size_t line)
 {
-    if (!value) return std::make_shared<NullValue>();
-    if (value->kind == targetType) return value;
+    if (value.kind == targetType) return value;
 
     try {
         switch (targetType) {
             case VAL_INT:
-                if (value->kind == VAL_FLOAT)
-                    return std::make_shared<IntValue>(
-                        static_cast<int>(std::dynamic_pointer_cast<FloatValue>(value)->value)
-                    );
-                if (value->kind == VAL_BOOL)
-                    return std::make_shared<IntValue>(
-                        std::dynamic_pointer_cast<BoolValue>(value)->value ? 1 : 0
-                    );
-                if (value->kind == VAL_CHAR)
-                    return std::make_shared<IntValue>(
-                        static_cast<int>(std::dynamic_pointer_cast<CharValue>(value)->value)
-                    );
+                if (value.kind == VAL_FLOAT) return Value::Int(static_cast<int>(value.f));
+                if (value.kind == VAL_BOOL) return Value::Int(value.b ? 1 : 0);
+                if (value.kind == VAL_CHAR) return Value::Int(static_cast<int>(value.c));
                 break;
 
             case VAL_FLOAT:
-                if (value->kind == VAL_INT)
-                    return std::make_shared<FloatValue>(
-                        static_cast<double>(std::dynamic_pointer_cast<IntValue>(value)->value)
-                    );
-                if (value->kind == VAL_BOOL)
-                    return std::make_shared<FloatValue>(
-                        std::dynamic_pointer_cast<BoolValue>(value)->value ? 1.0 : 0.0
-                    );
-                if (value->kind == VAL_CHAR)
-                    return std::make_shared<FloatValue>(
-                        static_cast<double>(std::dynamic_pointer_cast<CharValue>(value)->value)
-                    );
+                if (value.kind == VAL_INT) return Value::Float(static_cast<double>(value.i));
+                if (value.kind == VAL_BOOL) return Value::Float(value.b ? 1.0 : 0.0);
+                if (value.kind == VAL_CHAR) return Value::Float(static_cast<double>(value.c));
                 break;
 
             case VAL_BOOL:
-                if (value->kind == VAL_INT)
-                    return std::make_shared<BoolValue>(
-                        std::dynamic_pointer_cast<IntValue>(value)->value != 0
-                    );
-                if (value->kind == VAL_FLOAT)
-                    return std::make_shared<BoolValue>(
-                        std::dynamic_pointer_cast<FloatValue>(value)->value != 0.0
-                    );
-                if (value->kind == VAL_CHAR)
-                    return std::make_shared<BoolValue>(std::dynamic_pointer_cast<CharValue>(value)->value != 0);
+                if (value.kind == VAL_INT) return Value::Bool(value.i != 0);
+                if (value.kind == VAL_FLOAT) return Value::Bool(value.f != 0.0);
+                if (value.kind == VAL_CHAR) return Value::Bool(value.c != 0);
                 break;
 
             case VAL_STRING:
-                switch (value->kind) {
+                switch (value.kind) {
                     case VAL_INT:
-                        return std::make_shared<StringValue>(std::to_string(std::dynamic_pointer_cast<IntValue>(value)->value));
+                        return Value::String(std::to_string(value.i));
                     case VAL_FLOAT:
-                        return std::make_shared<StringValue>(std::to_string(std::dynamic_pointer_cast<FloatValue>(value)->value));
+                        return Value::String(std::to_string(value.f));
                     case VAL_BOOL:
-                        return std::make_shared<StringValue>(std::dynamic_pointer_cast<BoolValue>(value)->value ? "true" : "false");
+                        return Value::String(value.b ? "true" : "false");
                     case VAL_CHAR:
-                        return std::make_shared<StringValue>(std::string(1, std::dynamic_pointer_cast<CharValue>(value)->value));
-                    case VAL_STRING:
-                        return value;
+                        return Value::String(std::string(1, value.c));
                     case VAL_NULL:
-                        return std::make_shared<StringValue>("null");
+                        return Value::String("null");
+                    default:
+                        break;
                 }
                 break;
             case VAL_CHAR:
-                if (value->kind == VAL_INT)
-                    return std::make_shared<CharValue>(static_cast<char>(std::dynamic_pointer_cast<IntValue>(value)->value));
-                if (value->kind == VAL_STRING) {
-                    std::string s = std::dynamic_pointer_cast<StringValue>(value)->value;
-                    if (!s.empty()) return std::make_shared<CharValue>(s[0]);
+                if (value.kind == VAL_INT) return Value::Char(static_cast<char>(value.i));
+                if (value.kind == VAL_STRING) {
+                    const std::string& s = value.as_string();
+                    if (!s.empty()) return Value::Char(s[0]);
                 }
                 break;
-            case VAL_ARRAY:
-                if (value->kind == VAL_ARRAY)
-                    return value;
-                break;
 
             case VAL_NULL:
-                return std::make_shared<NullValue>();
+                return Value::Null();
+
+            default:
+                break;
         }
     } catch (...) {
         runtime_err("cannot cast type", line);
     }
 
     runtime_err("cannot cast type", line);
+    return Value();
+}
+
+void cast_elements(ArrayValue* arr, ValueType elemType, std::size_t line)
+{
+    // Every element is already of elemType, untyped arrays always convert
+    if (arr->elem_type == elemType && elemType != VAL_NULL) return;
+
+    ArrayValue converted(elemType);
+    converted.reserve(arr->size());
+
+    for (std::size_t i = 0; i < arr->size(); i++) {
+        converted.push(cast(arr->get(i), elemType, line));
+    }
+
+    arr->swap(converted);
 }
 
-bool is_truthy(RVPtr value)
+Value cast_element(const ArrayValue* arr, const Value& value, std::size_t line)
 {
-    switch (value->kind) {
+    if (arr->elem_type == VAL_NULL) return value;
+    return cast(value, arr->elem_type, line);
+}
+
+bool is_truthy(const Value& value)
+{
+    switch (value.kind) {
         case VAL_INT:
-        {
-            auto num = std::static_pointer_cast<IntValue>(value);
-            return num->value != 0;
-        }
+            return value.i != 0;
         case VAL_FLOAT:
-        {
-            auto num = std::static_pointer_cast<FloatValue>(value);
-            return num->value != 0.0;
-        }
+            return value.f != 0.0;
         case VAL_BOOL:
-        {
-            auto b = std::static_pointer_cast<BoolValue>(value);
-            return b->value;
-        }
+            return value.b;
         case VAL_STRING:
-        {
-            auto str = std::static_pointer_cast<StringValue>(value);
-            return !str->value.empty();
-        }
+            return !value.as_string().empty();
         case VAL_NULL:
             return false;
         default:
@@ -136,202 +118,221 @@ bool is_truthy(RVPtr value)
     }
 }
 
+// Type of a non-auto declaration, as recorded by the type checker
+static ValueType declared_type(const Ast& ast, const AstVarDecl& var, Environment* env, std::size_t line)
+{
+    if (var.value_type != NO_TYPE) return static_cast<ValueType>(var.value_type);
+    return stoval(ast.name(var.type), env, line);
+}
 
-RVPtr eval_var_declaration(std::shared_ptr<ASTVarDecl> node, Environment* env, std::size_t line)
+Value declare_var(const Ast& ast, const Node& node, Value* value, const Value* size,
+                  Environment* env, std::size_t line)
 {
-    bool infer_type = (node->type == "auto");
+    const AstVarDecl& var = ast.vars[node.a];
+    // A type the checker recorded is never auto, skip the name compare
+    bool infer_type = var.value_type == NO_TYPE && ast.name(var.type) == "auto";
     ValueType type = VAL_NULL;
-    RVPtr value = nullptr;
 
-    if (node->is_array) {
-        if (!node->value.has_value() || !node->value.value()) {
+    if (node.has(FLAG_ARRAY)) {
+        if (!value) {
             runtime_err("cannot declare array without initializer", line);
         }
 
-        auto arrLit = std::dynamic_pointer_cast<ASTArrayLiteral>(node->value.value());
-        value = evaluate(arrLit, env, line);
-
         if (value->kind != VAL_ARRAY) {
             runtime_err("initializer is not an array", line);
         }
 
-        auto arrVal = std::dynamic_pointer_cast<ArrayValue>(value);
+        auto arrVal = value->as<ArrayValue>();
 
         ValueType elemType;
         if (infer_type) {
-            if (arrVal->elements.empty()) {
+            if (arrVal->empty()) {
                 runtime_err("cannot infer type of empty array", line);
             }
-            elemType = arrVal->elements[0]->kind;
-            type = elemType;
+            elemType = arrVal->get(0).kind;
         } else {
-            type = stoval(node->type, node, env, line);
-            elemType = type;
+            elemType = declared_type(ast, var, env, line);
         }
 
         std::size_t declared_size = 0;
-        if (node->array_size.has_value()) {
-            declared_size = std::dynamic_pointer_cast<IntValue>(
-                evaluate(node->array_size.value(), env, line)
-            )->value;
+        if (size) {
+            if (size->kind != VAL_INT) runtime_err("array size must be an integer", line);
+            declared_size = size->i;
 
-            if (arrVal->elements.size() > declared_size) {
+            if (arrVal->size() > declared_size) {
                 runtime_err("array initializer has more elements than declared size", line);
             }
-
-            while (arrVal->elements.size() < declared_size) {
-                arrVal->elements.push_back(default_val(elemType, line));
-            }
         }
 
-        for (auto& elem : arrVal->elements) {
-            elem = cast(elem, elemType, line);
+        cast_elements(arrVal, elemType, line);
+
+        if (declared_size > 0) {
+            Value fill = default_val(elemType, line);
+            arrVal->reserve(declared_size);
+            while (arrVal->size() < declared_size) {
+                arrVal->push(fill);
+            }
         }
 
         type = VAL_ARRAY;
 
     } else {
-        if (!node->value.has_value() || !node->value.value()) {
+        if (!value) {
             if (infer_type)
                 runtime_err("cannot infer type for uninitialized 'auto' variable", line);
 
-            type = stoval(node->type, node, env, line);
-            value = default_val(type, line);
+            type = declared_type(ast, var, env, line);
+            Value fill = default_val(type, line);
+            env->declareVar(var.slot, ast.name(var.name), fill, type, node.has(FLAG_CONST), line);
+            return fill;
+        } else if (infer_type) {
+            type = value->kind;
         } else {
-            value = evaluate(node->value.value(), env, line);
-            if (infer_type) {
-                type = value->kind;
-            } else {
-                type = stoval(node->type, node, env, line);
-                if (!std::dynamic_pointer_cast<ASTCastExpr>(node->value.value())) {
-                    value = cast(value, type, line);
-                }
+            type = declared_type(ast, var, env, line);
+            if (ast[var.value].kind != NodeType::CastExpr && !node.has(FLAG_NO_CAST)) {
+                *value = cast(*value, type, line);
             }
         }
     }
 
-    env->declareVar(node->name, value, type, node->is_const, line);
-    return value;
+    env->declareVar(var.slot, ast.name(var.name), *value, type, node.has(FLAG_CONST), line);
+    return *value;
 }
 
-RVPtr eval_if_stmt(std::shared_ptr<ASTIfStmt> node, Environment* env, std::size_t line)
+Value eval_var_declaration(const Ast& ast, const Node& node, Environment* env, std::size_t line)
 {
-    auto condition = evaluate(node->condition, env, line);
+    const AstVarDecl& var = ast.vars[node.a];
+    if (var.value == NO_NODE) return declare_var(ast, node, nullptr, nullptr, env, line);
+
+    Value value = evaluate(ast, var.value, env, line);
+    if (node.has(FLAG_ARRAY) && var.array_size != NO_NODE) {
+        Value size = evaluate(ast, var.array_size, env, line);
+        return declare_var(ast, node, &value, &size, env, line);
+    }
+    return declare_var(ast, node, &value, nullptr, env, line);
+}
+
+Completion eval_if_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line)
+{
+    auto condition = evaluate(ast, node.a, env, line);
 
     if (is_truthy(condition))
     {
-        return evaluate(node->thenBranch, env, line);
+        return execute(ast, node.b, env, line);
     }
-    else if (node->elseBranch.has_value())
+    else if (node.c != NO_NODE)
     {
-        return evaluate(node->elseBranch.value(), env, line);
+        return execute(ast, node.c, env, line);
     }
 
 
-    return std::make_shared<NullValue>();
+    return Completion::normal(Value::Null());
 }
 
-RVPtr eval_while_stmt(std::shared_ptr<ASTWhileStmt> node, Environment* env, std::size_t line)
+Completion eval_while_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line)
 {
-    RVPtr last_eval = std::make_shared<NullValue>();
+    Value last_eval;
+    const Node& body = ast[node.b];
 
     while (true)
     {
-        auto condition = evaluate(node->condition, env, line);
+        auto condition = evaluate(ast, node.a, env, line);
         if (!is_truthy(condition)) break;
 
-        RVPtr result = eval_block_stmt(std::static_pointer_cast<ASTBlockStmt>(node->doBranch), env, line);
+        Completion result = eval_block_stmt(ast, body, env, line);
 
-        if (result->kind == VAL_BREAK) break;
-        if (result->kind == VAL_CONTINUE) continue;
+        if (result.type == Completion::Break) break;
+        if (result.type == Completion::Continue) continue;
+        if (result.type == Completion::Return) return result;
 
-        last_eval = result;
+        last_eval = std::move(result.value);
     }
 
-    return last_eval;
+    return Completion::normal(last_eval);
 }
 
-RVPtr eval_for_stmt(std::shared_ptr<ASTForStmt> node, Environment* env, std::size_t line)
+Completion eval_for_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line)
 {
-    RVPtr last_eval = std::make_shared<NullValue>();
-
-    if (node->init) {
-        if (auto varDecl = std::dynamic_pointer_cast<ASTVarDecl>(node->init)) {
-            eval_var_declaration(varDecl, env, line);
+    Value last_eval;
+    NodeId update = ast.lists[node.c];
+    const Node& body = ast[ast.lists[node.c + 1]];
+
+    if (node.a != NO_NODE) {
+        const Node& init = ast[node.a];
+        if (init.kind == NodeType::VarDeclaration) {
+            eval_var_declaration(ast, init, env, line);
         } else {
-            evaluate(std::dynamic_pointer_cast<Expr>(node->init), env, line);
+            evaluate(ast, node.a, env, line);
         }
     }
 
     while (true) {
-        if (node->condition) {
-            auto condVal = evaluate(node->condition, env, line);
+        if (node.b != NO_NODE) {
+            auto condVal = evaluate(ast, node.b, env, line);
             if (!is_truthy(condVal)) break;
         }
 
-        RVPtr result = eval_block_stmt(std::dynamic_pointer_cast<ASTBlockStmt>(node->body), env, line);
+        Completion result = eval_block_stmt(ast, body, env, line);
 
-        if (result->kind == VAL_BREAK) break;
-        if (result->kind == VAL_CONTINUE) {
-        } else {
-            last_eval = result;
+        if (result.type == Completion::Break) break;
+        if (result.type == Completion::Return) return result;
+        if (result.type == Completion::Normal) {
+            last_eval = std::move(result.value);
         }
 
-        if (node->update) {
-            evaluate(node->update, env, line);
+        if (update != NO_NODE) {
+            evaluate(ast, update, env, line);
         }
     }
 
-    return last_eval;
+    return Completion::normal(last_eval);
 }
 
 
-RVPtr eval_block_stmt(std::shared_ptr<ASTBlockStmt> node, Environment* env, std::size_t line)
+Completion eval_block_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line)
 {
-    Environment* child_env = new Environment(env);
+    Environment* child_env = Environment::push(env, node.c);
     child_env->current_return_type = env->current_return_type;
 
-    RVPtr last_eval = std::make_shared<NullValue>();
+    Value last_eval;
+    const NodeId* block = ast.list(node.a);
 
-    for (auto &stmt : node->block)
+    for (uint32_t i = 0; i < node.b; i++)
     {
-        RVPtr result = evaluate(stmt, child_env, line);
+        Completion result = execute(ast, block[i], child_env, line);
 
-        if (result->kind == VAL_BREAK || result->kind == VAL_CONTINUE || result->kind == VAL_RETURN)
+        if (result.type != Completion::Normal)
         {
-            delete child_env;
+            Environment::pop(child_env);
             return result;
         }
 
-        last_eval = result;
+        last_eval = std::move(result.value);
     }
 
-    delete child_env;
-    return last_eval;
+    Environment::pop(child_env);
+    return Completion::normal(last_eval);
 }
 
-RVPtr eval_func_stmt(std::shared_ptr<ASTFunctionStmt> node, Environment* env, std::size_t line)
+Value eval_func_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line)
 {
-    auto funcVal = std::make_shared<FunctionValue>(node, env);
-    funcVal->closure->current_return_type = funcVal->declaration->ret_type;
+    const AstFunction& decl = ast.functions[node.a];
+    auto funcVal = new FunctionValue(&ast, &decl, env);
+    funcVal->closure->current_return_type = ast.name(decl.ret_type);
 
-    env->declareVar(node->name, funcVal, VAL_FUNCTION, true, line);
-
-    return funcVal;
+    return env->declareVar(decl.slot, ast.name(decl.name), Value::Object(funcVal), VAL_FUNCTION, true, line);
 }
 
-RVPtr eval_return_stmt(std::shared_ptr<ASTReturnStmt> node, Environment* env, std::size_t line) {
-    RVPtr value = nullptr;
+Completion eval_return_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line) {
+    Value value;
 
-    if (node->value) {
-        value = evaluate(node->value, env, line);
-    } else {
-        value = std::make_shared<NullValue>();
+    if (node.a != NO_NODE) {
+        value = evaluate(ast, node.a, env, line);
     }
 
-    if (env->current_return_type == "void" && node->value) {
+    if (env->current_return_type == "void" && node.a != NO_NODE) {
         runtime_err("void functions cannot return a value", line);
     }
 
-    return std::make_shared<ReturnValue>(value);
+    return Completion{Completion::Return, value};
 }
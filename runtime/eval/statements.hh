@@ -13,13 +13,26 @@ statements.hh
 #include "../values.hh"
 #include "../interpreter/interpreter.hh"
 
-using RVPtr = std::shared_ptr<RuntimeValue>;
-
-RVPtr cast(RVPtr value, ValueType targetType, std::size_t line);
-RVPtr eval_var_declaration(std::shared_ptr<ASTVarDecl> node, Environment* env, std::size_t line);
-RVPtr eval_if_stmt(std::shared_ptr<ASTIfStmt> node, Environment* env, std::size_t line);
-RVPtr eval_block_stmt(std::shared_ptr<ASTBlockStmt> node, Environment* env, std::size_t line);
-RVPtr eval_while_stmt(std::shared_ptr<ASTWhileStmt> node, Environment* env, std::size_t line);
-RVPtr eval_for_stmt(std::shared_ptr<ASTForStmt> node, Environment* env, std::size_t line);
-RVPtr eval_func_stmt(std::shared_ptr<ASTFunctionStmt> node, Environment* env, std::size_t line);
-RVPtr eval_return_stmt(std::shared_ptr<ASTReturnStmt> node, Environment* env, std::size_t line);
\ No newline at end of file
+Value cast(const Value& value, ValueType targetType, std::size_t line);
+Value default_val(ValueType targetType, std::size_t line);
+bool is_truthy(const Value& value);
+
+// Converts every element of 'arr' to elemType and switches it to that storage.
+// Free when the array already holds elemType.
+void cast_elements(ArrayValue* arr, ValueType elemType, std::size_t line);
+// Converts a value about to be stored into 'arr' to its element type
+Value cast_element(const ArrayValue* arr, const Value& value, std::size_t line);
+
+// Declares the variable of a VarDeclaration node given its evaluated
+// initializer and array size, nullptr when absent. Shared by the tree walker
+// and the closure engine.
+Value declare_var(const Ast& ast, const Node& node, Value* value, const Value* size,
+                  Environment* env, std::size_t line);
+
+Value eval_var_declaration(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Completion eval_if_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Completion eval_block_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Completion eval_while_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Completion eval_for_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Value eval_func_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line);
+Completion eval_return_stmt(const Ast& ast, const Node& node, Environment* env, std::size_t line);
\ No newline at end of file
@@ -0,0 +1,49 @@
+/*
+
+constants.hh
+
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../values.hh"
+
+// Immutable values for the program's literals. The resolver materializes
+// each literal once after parsing and records its index on the node, the
+// tree walker then hands out copies of the pooled value. Identical string
+// literals share one StringValue.
+class ConstantPool {
+private:
+    std::vector<Value> values;
+    std::unordered_map<std::string, int> strings;
+
+    // Pooled strings live in the Allocator, so it has to outlive the pool
+    ConstantPool() { Allocator::instance(); }
+
+public:
+    static ConstantPool& instance() {
+        static ConstantPool inst;
+        return inst;
+    }
+
+    int add(Value value) {
+        values.push_back(std::move(value));
+        return static_cast<int>(values.size() - 1);
+    }
+
+    int add_string(const std::string& s) {
+        auto it = strings.find(s);
+        if (it != strings.end()) return it->second;
+
+        int index = add(Value::String(s));
+        strings.emplace(s, index);
+        return index;
+    }
+
+    const Value& get(int index) const { return values[index]; }
+    std::size_t size() const { return values.size(); }
+};
@@ -12,7 +12,24 @@ interpreter.hh
 #include "../../parser/parser.hh"
 #include "../values.hh"
 
-using RVPtr = std::shared_ptr<RuntimeValue>;
-using SPtr = std::shared_ptr<Stmt>;
+// Outcome of executing a statement, passed around by value. A normal
+// completion carries the value of the last evaluated statement, a return
+// carries the returned value.
+struct Completion {
+    enum Type : uint8_t {
+        Normal,
+        Break,
+        Continue,
+        Return,
+    };
 
-RVPtr evaluate(SPtr node, Environment* env, std::size_t line);
\ No newline at end of file
+    Type type = Normal;
+    Value value;
+
+    static Completion normal(Value v) { return Completion{Normal, std::move(v)}; }
+};
+
+// Both walk the program's node pool, which outlives the run; children are
+// plain indices into it.
+Completion execute(const Ast& ast, NodeId id, Environment* env, std::size_t line);
+Value evaluate(const Ast& ast, NodeId id, Environment* env, std::size_t line);
@@ -0,0 +1,125 @@
+#include "allocator.hh"
+
+#include <algorithm>
+#include <new>
+
+/* Frame arena */
+
+FrameArena::~FrameArena()
+{
+    for (auto& c : chunks) ::operator delete(c.data);
+}
+
+void* FrameArena::allocate(std::size_t bytes)
+{
+    bytes = (bytes + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    // Move on to the next chunk that fits, the skipped tail comes back on release()
+    while (current >= chunks.size() || offset + bytes > chunks[current].size) {
+        if (current < chunks.size()) {
+            used += chunks[current].size - offset;
+            current++;
+        }
+        offset = 0;
+
+        if (current == chunks.size()) {
+            std::size_t size = std::max(CHUNK_SIZE, bytes);
+            chunks.push_back(Chunk{static_cast<char*>(::operator new(size)), size});
+            stats.frame_chunks++;
+        }
+    }
+
+    void* p = chunks[current].data + offset;
+    offset += bytes;
+    used += bytes;
+
+    stats.frames++;
+    stats.frame_bytes = used;
+    stats.frame_peak_bytes = std::max(stats.frame_peak_bytes, used);
+    return p;
+}
+
+void FrameArena::release(const Mark& m)
+{
+    current = m.chunk;
+    offset = m.offset;
+    used = m.used;
+    stats.frame_bytes = used;
+}
+
+/* Size-class pools */
+
+Allocator::~Allocator()
+{
+    for (void* s : slabs) ::operator delete(s);
+}
+
+void Allocator::refill(std::size_t cls)
+{
+    std::size_t block = (cls + 1) * GRANULE;
+    char* slab = static_cast<char*>(::operator new(SLAB_SIZE));
+    slabs.push_back(slab);
+    counters.slabs++;
+
+    // Thread the whole slab onto the free list
+    for (std::size_t off = 0; off + block <= SLAB_SIZE; off += block) {
+        auto node = reinterpret_cast<FreeNode*>(slab + off);
+        node->next = free_lists[cls];
+        free_lists[cls] = node;
+    }
+}
+
+void* Allocator::allocate(std::size_t size)
+{
+    if (size > NUM_CLASSES * GRANULE) {
+        counters.large_allocs++;
+        return ::operator new(size);
+    }
+
+    std::size_t cls = size_class(size);
+    if (free_lists[cls]) {
+        counters.pool_reused++;
+    } else {
+        refill(cls);
+    }
+
+    FreeNode* node = free_lists[cls];
+    free_lists[cls] = node->next;
+
+    counters.pool_allocs++;
+    counters.live_bytes += (cls + 1) * GRANULE;
+    counters.peak_bytes = std::max(counters.peak_bytes, counters.live_bytes);
+    return node;
+}
+
+void Allocator::deallocate(void* p, std::size_t size)
+{
+    if (!p) return;
+
+    if (size > NUM_CLASSES * GRANULE) {
+        ::operator delete(p);
+        return;
+    }
+
+    std::size_t cls = size_class(size);
+    auto node = static_cast<FreeNode*>(p);
+    node->next = free_lists[cls];
+    free_lists[cls] = node;
+
+    counters.pool_frees++;
+    counters.live_bytes -= (cls + 1) * GRANULE;
+}
+
+void Allocator::print_stats(std::ostream& out) const
+{
+    const AllocStats& s = counters;
+    out << "===== ALLOCATOR STATS =====" << std::endl;
+    out << "pool allocs:    " << s.pool_allocs << " (" << s.pool_reused << " reused)" << std::endl;
+    out << "pool frees:     " << s.pool_frees << std::endl;
+    out << "pool live:      " << s.live_bytes << " bytes (peak " << s.peak_bytes << ")" << std::endl;
+    out << "pool slabs:     " << s.slabs << std::endl;
+    out << "large allocs:   " << s.large_allocs << std::endl;
+    out << "frames:         " << s.frames << " (peak " << s.frame_peak_bytes << " bytes)" << std::endl;
+    out << "frame chunks:   " << s.frame_chunks << std::endl;
+    out << "system allocs:  " << s.system_allocs() << std::endl;
+}
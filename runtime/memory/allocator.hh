@@ -0,0 +1,105 @@
+/*
+
+allocator.hh
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Counters kept by the Allocator, see Allocator::stats()
+struct AllocStats {
+    // Size-class pools (heap runtime values)
+    std::size_t pool_allocs = 0;
+    std::size_t pool_frees = 0;
+    std::size_t pool_reused = 0;    // allocations served straight from a free list
+    std::size_t large_allocs = 0;   // objects bigger than the largest size class
+    std::size_t live_bytes = 0;
+    std::size_t peak_bytes = 0;
+    std::size_t slabs = 0;
+
+    // Frame arena (Environments)
+    std::size_t frames = 0;
+    std::size_t frame_bytes = 0;
+    std::size_t frame_peak_bytes = 0;
+    std::size_t frame_chunks = 0;
+
+    // Requests that actually reached the system allocator
+    std::size_t system_allocs() const { return slabs + large_allocs + frame_chunks; }
+};
+
+// Bump allocator for memory released in LIFO order. Callers take a Mark
+// before allocating and hand it back to release() when they are done.
+class FrameArena {
+public:
+    struct Mark {
+        std::size_t chunk = 0;
+        std::size_t offset = 0;
+        std::size_t used = 0;
+    };
+
+    explicit FrameArena(AllocStats& stats) : stats(stats) {}
+    ~FrameArena();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    Mark mark() const { return Mark{current, offset, used}; }
+    void* allocate(std::size_t bytes);
+    void release(const Mark& m);
+
+private:
+    static constexpr std::size_t CHUNK_SIZE = 64 * 1024;
+
+    struct Chunk {
+        char* data;
+        std::size_t size;
+    };
+
+    AllocStats& stats;
+    std::vector<Chunk> chunks;
+    std::size_t current = 0;
+    std::size_t offset = 0;
+    std::size_t used = 0;
+};
+
+// Allocation subsystem of the interpreter. Heap runtime values are carved
+// out of per size-class free lists, Environments come from the frame arena.
+class Allocator {
+public:
+    static Allocator& instance() {
+        static Allocator inst;
+        return inst;
+    }
+
+    void* allocate(std::size_t size);
+    void deallocate(void* p, std::size_t size);
+
+    FrameArena& frames() { return frame_arena; }
+
+    const AllocStats& stats() const { return counters; }
+    void print_stats(std::ostream& out) const;
+
+private:
+    Allocator() : frame_arena(counters) {}
+    ~Allocator();
+
+    static constexpr std::size_t GRANULE = 16;
+    static constexpr std::size_t NUM_CLASSES = 16; // 16 .. 256 bytes
+    static constexpr std::size_t SLAB_SIZE = 64 * 1024;
+
+    struct FreeNode {
+        FreeNode* next;
+    };
+
+    static std::size_t size_class(std::size_t size) { return (size + GRANULE - 1) / GRANULE - 1; }
+    void refill(std::size_t cls);
+
+    AllocStats counters;
+    FreeNode* free_lists[NUM_CLASSES] = {};
+    std::vector<void*> slabs;
+    FrameArena frame_arena;
+};
@@ -30,12 +30,12 @@ std::string process_escapes(const std::string& s) {
 void register_default_native_functions() {
     auto& registry = NativeRegistry::instance();
 
-    registry.register_function("puts", [](const std::vector<RVPtr>& args, Environment*, std::size_t line) -> RVPtr {
-        if (args.empty() || args[0]->kind != VAL_STRING) {
+    registry.register_function("puts", [](const std::vector<Value>& args, Environment*, std::size_t line) -> Value {
+        if (args.empty() || args[0].kind != VAL_STRING) {
             runtime_err("puts: first argument must be a format string", line);
         }
 
-        std::string fmt = std::dynamic_pointer_cast<StringValue>(args[0])->value;
+        std::string fmt = args[0].as_string();
         fmt = process_escapes(fmt);
         std::string output;
         size_t arg_idx = 1;
@@ -51,38 +51,27 @@ void register_default_native_functions() {
                         runtime_err("puts: not enough arguments for format string", line);
                     }
 
-                    RVPtr v = args[arg_idx++];
+                    const Value& v = args[arg_idx++];
 
                     switch (spec) {
                         case 'd': {
-                            auto iv = std::dynamic_pointer_cast<IntValue>(cast(v, VAL_INT, line));
-                            output += std::to_string(iv->value);
+                            output += std::to_string(cast(v, VAL_INT, line).as_int());
                             break;
                         }
                         case 'f': {
-                            RVPtr fv_val = cast(v, VAL_FLOAT, line);
-                            if (fv_val->kind == VAL_FLOAT) {
-                                auto fv = std::dynamic_pointer_cast<FloatValue>(fv_val);
-                                output += std::to_string(fv->value);
-                            } else {
-                                auto iv = std::dynamic_pointer_cast<IntValue>(fv_val);
-                                output += std::to_string(static_cast<double>(iv->value));
-                            }
+                            output += std::to_string(cast(v, VAL_FLOAT, line).as_float());
                             break;
                         }
                         case 's': {
-                            auto sv = std::dynamic_pointer_cast<StringValue>(cast(v, VAL_STRING, line));
-                            output += sv->value;
+                            output += cast(v, VAL_STRING, line).as_string();
                             break;
                         }
                         case 'b': {
-                            auto bv = std::dynamic_pointer_cast<BoolValue>(cast(v, VAL_BOOL, line));
-                            output += (bv->value ? "true" : "false");
+                            output += (cast(v, VAL_BOOL, line).as_bool() ? "true" : "false");
                             break;
                         }
                         case 'c': {
-                            auto cv = std::dynamic_pointer_cast<CharValue>(cast(v, VAL_CHAR, line));
-                            output += cv->value;
+                            output += cast(v, VAL_CHAR, line).as_char();
                             break;
                         }
 
@@ -98,22 +87,22 @@ void register_default_native_functions() {
 
         // Only print after all formatting succeeds
         std::cout << output << std::endl;
-        return std::make_shared<NullValue>();
+        return Value::Null();
     });
 
-    registry.register_function("gets", [](const std::vector<RVPtr>& args, Environment* env, std::size_t line) -> RVPtr {
+    registry.register_function("gets", [](const std::vector<Value>& args, Environment* env, std::size_t line) -> Value {
         std::string prompt;
         if (!args.empty()) {
-            if (args[0]->kind != VAL_STRING) {
+            if (args[0].kind != VAL_STRING) {
                 runtime_err("gets: argument must be a string", line);
             }
-            prompt = std::dynamic_pointer_cast<StringValue>(args[0])->value;
+            prompt = args[0].as_string();
         }
 
         std::cout << prompt;
         std::string input;
         std::getline(std::cin, input);
 
-        return std::make_shared<StringValue>(input);
+        return Value::String(input);
     });
 }
@@ -0,0 +1,207 @@
+#include "resolver.hh"
+#include "../interpreter/constants.hh"
+
+Resolver::Resolver(const std::vector<std::string>& predeclared) : predeclared(predeclared) {}
+
+void Resolver::resolve(Ast& program)
+{
+    ast = &program;
+    scopes.clear();
+    horizons.clear();
+    begin_scope();
+
+    for (auto& name : predeclared) declare(ast->intern(name));
+
+    Node& root = (*ast)[ast->root];
+    for (uint32_t i = 0; i < root.b; i++) {
+        resolve_stmt(ast->lists[root.a + i]);
+    }
+
+    (*ast)[ast->root].c = static_cast<uint32_t>(end_scope());
+}
+
+void Resolver::begin_scope()
+{
+    scopes.emplace_back();
+}
+
+int Resolver::end_scope()
+{
+    // The deferred list may grow while resolving, so index instead of iterating
+    for (std::size_t i = 0; i < scopes.back().deferred.size(); i++) {
+        resolve_function_body(scopes.back().deferred[i]);
+    }
+
+    int size = scopes.back().size;
+    scopes.pop_back();
+    return size;
+}
+
+ScopeSlot Resolver::declare(NameId name)
+{
+    Scope& scope = scopes.back();
+
+    // Redeclaring reuses the slot, the environment reports the error at runtime
+    auto it = scope.names.find(name);
+    if (it != scope.names.end()) return ScopeSlot{0, it->second};
+
+    int index = scope.size++;
+    scope.names[name] = index;
+    return ScopeSlot{0, index};
+}
+
+ScopeSlot Resolver::lookup(NameId name) const
+{
+    ScopeSlot slot;
+    for (std::size_t i = scopes.size(); i-- > 0;) {
+        auto it = scopes[i].names.find(name);
+        if (it == scopes[i].names.end()) continue;
+
+        int depth = static_cast<int>(scopes.size() - 1 - i);
+        if (slot.resolved()) {
+            slot.outer_depth = depth;
+            slot.outer_index = it->second;
+            break;
+        }
+
+        slot = ScopeSlot{depth, it->second};
+        if (!declared_later(i, it->second)) break;
+    }
+
+    // Unresolved, reported by the environment if it is ever evaluated
+    return slot;
+}
+
+bool Resolver::declared_later(std::size_t scope, int index) const
+{
+    for (auto& horizon : horizons) {
+        if (horizon.scope == scope && index >= horizon.visible) return true;
+    }
+    return false;
+}
+
+void Resolver::resolve_function_body(Deferred deferred)
+{
+    horizons.push_back(Horizon{scopes.size() - 1, deferred.visible});
+
+    begin_scope();
+    AstFunction& fn = ast->functions[deferred.function];
+    for (uint32_t i = 0; i < fn.params_count; i++) {
+        AstParam& param = ast->params[fn.params_begin + i];
+        param.slot = declare(param.name);
+    }
+    resolve_stmt(fn.body);
+    fn.param_scope_size = end_scope();
+
+    horizons.pop_back();
+}
+
+void Resolver::resolve_stmt(NodeId id)
+{
+    if (id == NO_NODE) return;
+
+    // Resolving never adds nodes, so references into the pool stay valid
+    const Node& n = (*ast)[id];
+
+    switch (n.kind) {
+        case NodeType::ExprStmt:
+            resolve_expr(n.a);
+            break;
+        case NodeType::VarDeclaration:
+        {
+            AstVarDecl& var = ast->vars[n.a];
+            // The initializer is evaluated before the name exists
+            resolve_expr(var.value);
+            resolve_expr(var.array_size);
+            var.slot = declare(var.name);
+            break;
+        }
+        case NodeType::BlockStmt:
+        {
+            begin_scope();
+            for (uint32_t i = 0; i < n.b; i++) resolve_stmt(ast->lists[n.a + i]);
+            (*ast)[id].c = static_cast<uint32_t>(end_scope());
+            break;
+        }
+        case NodeType::IfStmt:
+            resolve_expr(n.a);
+            resolve_stmt(n.b);
+            resolve_stmt(n.c);
+            break;
+        case NodeType::WhileStmt:
+            resolve_expr(n.a);
+            resolve_stmt(n.b);
+            break;
+        case NodeType::ForStmt:
+            resolve_stmt(n.a);
+            resolve_expr(n.b);
+            resolve_expr(ast->lists[n.c]);
+            resolve_stmt(ast->lists[n.c + 1]);
+            break;
+        case NodeType::FunctionStmt:
+            ast->functions[n.a].slot = declare(ast->functions[n.a].name);
+            // The function's own name counts as visible, it may recurse
+            scopes.back().deferred.push_back(Deferred{n.a, scopes.back().size});
+            break;
+        case NodeType::ReturnStmt:
+            resolve_expr(n.a);
+            break;
+        case NodeType::ContinueStmt:
+        case NodeType::BreakStmt:
+            break;
+        default:
+            // for-loop initializers may be bare expressions
+            resolve_expr(id);
+            break;
+    }
+}
+
+void Resolver::resolve_expr(NodeId id)
+{
+    if (id == NO_NODE) return;
+
+    Node& n = (*ast)[id];
+
+    switch (n.kind) {
+        case NodeType::IdentifierLiteral:
+            ast->set_slot(n, lookup(n.a));
+            break;
+        case NodeType::BinaryExpr:
+        case NodeType::AssignmentExpr:
+        case NodeType::MemberExpr:
+            resolve_expr(n.a);
+            resolve_expr(n.b);
+            break;
+        case NodeType::UnaryExpr:
+            resolve_expr(n.a);
+            break;
+        case NodeType::CallExpr:
+        {
+            resolve_expr(n.a);
+            for (uint32_t i = 0; i < n.c; i++) resolve_expr(ast->lists[n.b + i]);
+            break;
+        }
+        case NodeType::CastExpr:
+            resolve_expr(n.b);
+            break;
+        case NodeType::ArrayLiteral:
+            for (uint32_t i = 0; i < n.b; i++) resolve_expr(ast->lists[n.a + i]);
+            break;
+        case NodeType::NumericLiteral:
+            n.c = ConstantPool::instance().add(n.has(FLAG_INT) ? Value::Int(Ast::int_value(n))
+                                                               : Value::Float(Ast::float_value(n)));
+            break;
+        case NodeType::StringLiteral:
+            n.c = ConstantPool::instance().add_string(ast->name(n.a));
+            break;
+        case NodeType::CharLiteral:
+            n.c = ConstantPool::instance().add(Value::Char(static_cast<char>(n.a)));
+            break;
+        case NodeType::BoolLiteral:
+            n.c = ConstantPool::instance().add(Value::Bool(n.a != 0));
+            break;
+        default:
+            // null literals have nothing to resolve
+            break;
+    }
+}
@@ -0,0 +1,65 @@
+/*
+
+resolver.hh
+
+*/
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../parser/flat_ast.hh"
+
+// Assigns every identifier, declaration and parameter a (depth, slot) address
+// mirroring the Environments the tree walker creates at runtime:
+//   Program      -> global environment (predeclared natives first)
+//   BlockStmt    -> one environment per execution of the block
+//   FunctionStmt -> one environment for the parameters, the body block nests in it
+// 'for' initializers declare into the enclosing environment.
+// Literals are materialized into the ConstantPool along the way.
+class Resolver {
+public:
+    explicit Resolver(const std::vector<std::string>& predeclared);
+
+    void resolve(Ast& ast);
+
+private:
+    struct Deferred {
+        uint32_t function;
+        int visible; // slots of the declaring scope declared before the function
+    };
+
+    // A function body being resolved: names of 'scope' from slot 'visible'
+    // on are declared after the function, until then calls see the
+    // enclosing binding of the name
+    struct Horizon {
+        std::size_t scope;
+        int visible;
+    };
+
+    struct Scope {
+        std::unordered_map<NameId, int> names;
+        int size = 0;
+        // Function bodies are resolved when their declaring scope closes, so
+        // they can see names declared after them (globals, mutual recursion)
+        std::vector<Deferred> deferred;
+    };
+
+    void resolve_stmt(NodeId id);
+    void resolve_expr(NodeId id);
+    void resolve_function_body(Deferred deferred);
+
+    void begin_scope();
+    int end_scope();
+
+    ScopeSlot declare(NameId name);
+    ScopeSlot lookup(NameId name) const;
+    bool declared_later(std::size_t scope, int index) const;
+
+    std::vector<std::string> predeclared;
+    std::vector<Scope> scopes;
+    std::vector<Horizon> horizons;
+    Ast* ast = nullptr;
+};
@@ -1,263 +1,418 @@
 #include "values.hh"
+#include "../utils/int_ops.hh"
 
 #include <cmath>
+#include <type_traits>
 
 // ---------------------- ArrayValue ----------------------
-ArrayValue::ArrayValue(std::vector<RVPtr> e) : RuntimeValue(VAL_ARRAY), elements(std::move(e)) {}
-
-// ---------------------- BoolValue ----------------------
-BoolValue::BoolValue(bool v) : RuntimeValue(VAL_BOOL), value(v) {}
-RVPtr BoolValue::eq(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_BOOL) return std::make_shared<BoolValue>(value == std::dynamic_pointer_cast<BoolValue>(other)->value);
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>((value ? 1 : 0) == std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>((value ? 1.0 : 0.0) == std::dynamic_pointer_cast<FloatValue>(other)->value);
-    return std::make_shared<BoolValue>(false);
-}
-RVPtr BoolValue::not_op(std::size_t line) { return std::make_shared<BoolValue>(!value); }
-
-// ---------------------- FloatValue ----------------------
-FloatValue::FloatValue(double v) : RuntimeValue(VAL_FLOAT), value(v) {}
-RVPtr FloatValue::neg(std::size_t line) { return std::make_shared<FloatValue>(-value); }
-RVPtr FloatValue::pos(std::size_t line) { return std::make_shared<FloatValue>(value); }
-RVPtr FloatValue::not_op(std::size_t line) { return std::make_shared<BoolValue>(value == 0.0); }
-
-RVPtr FloatValue::add(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<FloatValue>(value + std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(value + std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot add Float and non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::sub(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<FloatValue>(value - std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(value - std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot subtract Float and non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::mul(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<FloatValue>(value * std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(value * std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot multiply Float and non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::div(RVPtr other, std::size_t line) {
-    double b = 0.0;
-    if (other->kind == VAL_INT) b = std::dynamic_pointer_cast<IntValue>(other)->value;
-    else if (other->kind == VAL_FLOAT) b = std::dynamic_pointer_cast<FloatValue>(other)->value;
-    else runtime_err("cannot divide Float and non-numeric type", line);
-    if (b == 0.0) runtime_err("Division by zero error", line);
-    return std::make_shared<FloatValue>(value / b);
-}
-RVPtr FloatValue::mod(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<FloatValue>(std::fmod(value, std::dynamic_pointer_cast<IntValue>(other)->value));
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(std::fmod(value, std::dynamic_pointer_cast<FloatValue>(other)->value));
-    runtime_err("cannot module Float and non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::eq(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value == std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value == std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Float with non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::gt(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value > std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value > std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Float with non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::gte(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value >= std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value >= std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Float with non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::lt(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value < std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value < std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Float with non-numeric type", line);
-    return nullptr;
-}
-RVPtr FloatValue::lte(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value <= std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value <= std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Float with non-numeric type", line);
-    return nullptr;
-}
+ArrayValue::ArrayValue(ValueType elem_type) : RuntimeValue(VAL_ARRAY), elem_type(elem_type) {}
 
-// ---------------------- IntValue ----------------------
-IntValue::IntValue(int v) : RuntimeValue(VAL_INT), value(v) {}
-RVPtr IntValue::neg(std::size_t line) { return std::make_shared<IntValue>(-value); }
-RVPtr IntValue::pos(std::size_t line) { return std::make_shared<IntValue>(value); }
-RVPtr IntValue::not_op(std::size_t line) { return std::make_shared<BoolValue>(value == 0); }
-
-RVPtr IntValue::add(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<IntValue>(value + std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(value + std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot add Int and non-numeric type", line);
-    return nullptr;
-}
-RVPtr IntValue::sub(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<IntValue>(value - std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(value - std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot subtract Int and non-numeric type", line);
-    return nullptr;
-}
-RVPtr IntValue::mul(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<IntValue>(value * std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(value * std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot multiply Int and non-numeric type", line);
-    return nullptr;
-}
-RVPtr IntValue::div(RVPtr other, std::size_t line) {
-    double b = 0.0;
-    if (other->kind == VAL_INT) b = std::dynamic_pointer_cast<IntValue>(other)->value;
-    else if (other->kind == VAL_FLOAT) b = std::dynamic_pointer_cast<FloatValue>(other)->value;
-    else runtime_err("cannot divide Int and non-numeric type", line);
-    if (b == 0.0) runtime_err("Division by zero", line);
-    return std::make_shared<FloatValue>(value / b);
+ArrayValue::ArrayValue(std::vector<Value> e) : RuntimeValue(VAL_ARRAY)
+{
+    if (e.empty()) return;
+
+    ValueType kind = e[0].kind;
+    for (auto& v : e) {
+        if (v.kind != kind) {
+            values = std::move(e);
+            return;
+        }
+    }
+
+    elem_type = kind;
+    if (kind == VAL_INT || kind == VAL_FLOAT || kind == VAL_CHAR || kind == VAL_BOOL) {
+        reserve(e.size());
+        for (auto& v : e) push(v);
+    } else {
+        values = std::move(e);
+    }
 }
-RVPtr IntValue::mod(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<IntValue>(std::fmod(value, std::dynamic_pointer_cast<IntValue>(other)->value));
-    if (other->kind == VAL_FLOAT) return std::make_shared<FloatValue>(std::fmod(value, std::dynamic_pointer_cast<FloatValue>(other)->value));
-    runtime_err("cannot module Int and non-numeric type", line);
-    return nullptr;
+
+std::size_t ArrayValue::size() const
+{
+    switch (elem_type) {
+        case VAL_INT:   return ints.size();
+        case VAL_FLOAT: return floats.size();
+        case VAL_CHAR:
+        case VAL_BOOL:  return bytes.size();
+        default:        return values.size();
+    }
 }
-RVPtr IntValue::eq(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value == std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value == std::dynamic_pointer_cast<FloatValue>(other)->value);
-    if (other->kind == VAL_BOOL) return std::make_shared<BoolValue>(value == (std::dynamic_pointer_cast<BoolValue>(other)->value ? 1 : 0));
-    return std::make_shared<BoolValue>(false);
+
+void ArrayValue::reserve(std::size_t n)
+{
+    switch (elem_type) {
+        case VAL_INT:   ints.reserve(n); break;
+        case VAL_FLOAT: floats.reserve(n); break;
+        case VAL_CHAR:
+        case VAL_BOOL:  bytes.reserve(n); break;
+        default:        values.reserve(n); break;
+    }
 }
-RVPtr IntValue::gt(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value > std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value > std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Int with non-numeric type", line);
-    return nullptr;
+
+Value ArrayValue::get(std::size_t i) const
+{
+    switch (elem_type) {
+        case VAL_INT:   return Value::Int(ints[i]);
+        case VAL_FLOAT: return Value::Float(floats[i]);
+        case VAL_CHAR:  return Value::Char(bytes[i]);
+        case VAL_BOOL:  return Value::Bool(bytes[i] != 0);
+        default:        return values[i];
+    }
 }
-RVPtr IntValue::gte(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value >= std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value >= std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Int with non-numeric type", line);
-    return nullptr;
+
+void ArrayValue::set(std::size_t i, const Value& v)
+{
+    switch (elem_type) {
+        case VAL_INT:   ints[i] = v.i; break;
+        case VAL_FLOAT: floats[i] = v.f; break;
+        case VAL_CHAR:  bytes[i] = v.c; break;
+        case VAL_BOOL:  bytes[i] = v.b; break;
+        default:        values[i] = v; break;
+    }
 }
-RVPtr IntValue::lt(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value < std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value < std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Int with non-numeric type", line);
-    return nullptr;
+
+void ArrayValue::push(const Value& v)
+{
+    switch (elem_type) {
+        case VAL_INT:   ints.push_back(v.i); break;
+        case VAL_FLOAT: floats.push_back(v.f); break;
+        case VAL_CHAR:  bytes.push_back(v.c); break;
+        case VAL_BOOL:  bytes.push_back(v.b); break;
+        default:        values.push_back(v); break;
+    }
 }
-RVPtr IntValue::lte(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_INT) return std::make_shared<BoolValue>(value <= std::dynamic_pointer_cast<IntValue>(other)->value);
-    if (other->kind == VAL_FLOAT) return std::make_shared<BoolValue>(value <= std::dynamic_pointer_cast<FloatValue>(other)->value);
-    runtime_err("cannot compare Int with non-numeric type", line);
-    return nullptr;
+
+void ArrayValue::swap(ArrayValue& other)
+{
+    std::swap(elem_type, other.elem_type);
+    ints.swap(other.ints);
+    floats.swap(other.floats);
+    bytes.swap(other.bytes);
+    values.swap(other.values);
 }
 
 // ---------------------- StringValue ----------------------
-StringValue::StringValue(std::string v) : RuntimeValue(VAL_STRING), value(v) {}
-RVPtr StringValue::add(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_STRING)
-    {
-        runtime_err("cannot add String and non-string type", line);
+StringValue::StringValue(std::string v) : RuntimeValue(VAL_STRING), value(std::move(v)) {}
+
+// ---------------------- FunctionValue ----------------------
+FunctionValue::FunctionValue(const Ast* a, const AstFunction* d, Environment* c)
+    : RuntimeValue(VAL_FUNCTION),
+      ast(a),
+      declaration(d),
+      closure(c)
+{}
+
+// ---------------------- Operators ----------------------
+// Generic kernels: each switches on the left kind, then checks the right
+// one. The table only falls back to them for pairs without a specialised
+// kernel, so in practice they report type errors and mixed bool/int equality.
+
+static bool is_numeric(const Value& v) { return v.kind == VAL_INT || v.kind == VAL_FLOAT; }
+static double num(const Value& v) { return v.kind == VAL_INT ? v.i : v.f; }
+
+static Value value_add(const Value& a, const Value& b, std::size_t line) {
+    switch (a.kind) {
+        case VAL_INT:
+            if (b.kind == VAL_INT) return Value::Int(int_add(a.i, b.i));
+            if (b.kind == VAL_FLOAT) return Value::Float(a.i + b.f);
+            runtime_err("cannot add Int and non-numeric type", line);
+            break;
+        case VAL_FLOAT:
+            if (is_numeric(b)) return Value::Float(a.f + num(b));
+            runtime_err("cannot add Float and non-numeric type", line);
+            break;
+        case VAL_STRING:
+            if (b.kind != VAL_STRING) runtime_err("cannot add String and non-string type", line);
+            return Value::String(a.as_string() + b.as_string());
+        case VAL_CHAR:
+        {
+            std::string s(1, a.c);
+            if (b.kind == VAL_CHAR) return Value::String(s + b.c);
+            if (b.kind == VAL_STRING) return Value::String(s + b.as_string());
+            runtime_err("cannot add Char and " + vtostr(b.kind), line);
+            break;
+        }
+        default:
+            runtime_err("cannot add these types", line);
     }
-    return std::make_shared<StringValue>(value + std::static_pointer_cast<StringValue>(other)->value);
+    return Value();
 }
-RVPtr StringValue::eq(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_STRING)
-    {
-        runtime_err("cannot compare String and non-string type", line);
+
+static Value value_sub(const Value& a, const Value& b, std::size_t line) {
+    switch (a.kind) {
+        case VAL_INT:
+            if (b.kind == VAL_INT) return Value::Int(int_sub(a.i, b.i));
+            if (b.kind == VAL_FLOAT) return Value::Float(a.i - b.f);
+            runtime_err("cannot subtract Int and non-numeric type", line);
+            break;
+        case VAL_FLOAT:
+            if (is_numeric(b)) return Value::Float(a.f - num(b));
+            runtime_err("cannot subtract Float and non-numeric type", line);
+            break;
+        default:
+            runtime_err("cannot subtract these types", line);
     }
-    return std::make_shared<BoolValue>(value == std::static_pointer_cast<StringValue>(other)->value);
+    return Value();
 }
-RVPtr StringValue::gt(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_STRING)
-    {
-        runtime_err("cannot compare String and non-string type", line);
+
+static Value value_mul(const Value& a, const Value& b, std::size_t line) {
+    switch (a.kind) {
+        case VAL_INT:
+            if (b.kind == VAL_INT) return Value::Int(int_mul(a.i, b.i));
+            if (b.kind == VAL_FLOAT) return Value::Float(a.i * b.f);
+            runtime_err("cannot multiply Int and non-numeric type", line);
+            break;
+        case VAL_FLOAT:
+            if (is_numeric(b)) return Value::Float(a.f * num(b));
+            runtime_err("cannot multiply Float and non-numeric type", line);
+            break;
+        default:
+            runtime_err("cannot multiply these types", line);
     }
-    return std::make_shared<BoolValue>(value > std::static_pointer_cast<StringValue>(other)->value);
+    return Value();
 }
-RVPtr StringValue::gte(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_STRING)
-    {
-        runtime_err("cannot compare String and non-string type", line);
+
+static Value value_div(const Value& a, const Value& b, std::size_t line) {
+    switch (a.kind) {
+        case VAL_INT:
+        {
+            if (!is_numeric(b)) runtime_err("cannot divide Int and non-numeric type", line);
+            double d = num(b);
+            if (d == 0.0) runtime_err("Division by zero", line);
+            return Value::Float(a.i / d);
+        }
+        case VAL_FLOAT:
+        {
+            if (!is_numeric(b)) runtime_err("cannot divide Float and non-numeric type", line);
+            double d = num(b);
+            if (d == 0.0) runtime_err("Division by zero error", line);
+            return Value::Float(a.f / d);
+        }
+        default:
+            runtime_err("cannot divide these types", line);
     }
-    return std::make_shared<BoolValue>(value < std::static_pointer_cast<StringValue>(other)->value);
+    return Value();
 }
-RVPtr StringValue::lt(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_STRING)
-    {
-        runtime_err("cannot compare String and non-string type", line);
+
+static Value value_mod(const Value& a, const Value& b, std::size_t line) {
+    switch (a.kind) {
+        case VAL_INT:
+            if (b.kind == VAL_INT) return Value::Int(int_mod(a.i, b.i));
+            if (b.kind == VAL_FLOAT) return Value::Float(std::fmod(a.i, b.f));
+            runtime_err("cannot module Int and non-numeric type", line);
+            break;
+        case VAL_FLOAT:
+            if (is_numeric(b)) return Value::Float(std::fmod(a.f, num(b)));
+            runtime_err("cannot module Float and non-numeric type", line);
+            break;
+        default:
+            runtime_err("cannot module these types", line);
     }
-    return std::make_shared<BoolValue>(value >= std::static_pointer_cast<StringValue>(other)->value);
+    return Value();
 }
-RVPtr StringValue::lte(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_STRING)
-    {
-        runtime_err("cannot compare String and non-string type", line);
+
+static Value value_eq(const Value& a, const Value& b, std::size_t line) {
+    switch (a.kind) {
+        case VAL_INT:
+            if (b.kind == VAL_INT) return Value::Bool(a.i == b.i);
+            if (b.kind == VAL_FLOAT) return Value::Bool(a.i == b.f);
+            if (b.kind == VAL_BOOL) return Value::Bool(a.i == (b.b ? 1 : 0));
+            return Value::Bool(false);
+        case VAL_FLOAT:
+            if (is_numeric(b)) return Value::Bool(a.f == num(b));
+            runtime_err("cannot compare Float with non-numeric type", line);
+            break;
+        case VAL_BOOL:
+            if (b.kind == VAL_BOOL) return Value::Bool(a.b == b.b);
+            if (b.kind == VAL_INT) return Value::Bool((a.b ? 1 : 0) == b.i);
+            if (b.kind == VAL_FLOAT) return Value::Bool((a.b ? 1.0 : 0.0) == b.f);
+            return Value::Bool(false);
+        case VAL_STRING:
+            if (b.kind != VAL_STRING) runtime_err("cannot compare String and non-string type", line);
+            return Value::Bool(a.as_string() == b.as_string());
+        case VAL_CHAR:
+            return Value::Bool(b.kind == VAL_CHAR && a.c == b.c);
+        default:
+            runtime_err("cannot compare these types", line);
     }
-    return std::make_shared<BoolValue>(value <= std::static_pointer_cast<StringValue>(other)->value);
+    return Value();
+}
+
+static Value value_neq(const Value& a, const Value& b, std::size_t line) {
+    return Value::Bool(!value_eq(a, b, line).b);
 }
-// ---------------------- CharValue ----------------------
-CharValue::CharValue(char v) : RuntimeValue(VAL_CHAR), value(v) {}
-
-RVPtr CharValue::add(RVPtr other, std::size_t line) {
-    if (other->kind == VAL_CHAR) {
-        std::string s;
-        s += value;
-        s += std::dynamic_pointer_cast<CharValue>(other)->value;
-        return std::make_shared<StringValue>(s);
+
+// Ordering comparisons share their type checks; 'cmp' gets both operands
+template <typename NumCmp>
+static Value compare(const Value& a, const Value& b, std::size_t line, NumCmp cmp) {
+    switch (a.kind) {
+        case VAL_INT:
+            if (is_numeric(b)) return Value::Bool(b.kind == VAL_INT ? cmp(a.i, b.i) : cmp(a.i, b.f));
+            runtime_err("cannot compare Int with non-numeric type", line);
+            break;
+        case VAL_FLOAT:
+            if (is_numeric(b)) return Value::Bool(cmp(a.f, num(b)));
+            runtime_err("cannot compare Float with non-numeric type", line);
+            break;
+        case VAL_STRING:
+            runtime_err("cannot compare String and non-string type", line);
+            break;
+        default:
+            runtime_err("cannot compare these types", line);
     }
-    if (other->kind == VAL_STRING) {
-        std::string s;
-        s += value;
-        s += std::dynamic_pointer_cast<StringValue>(other)->value;
-        return std::make_shared<StringValue>(s);
+    return Value();
+}
+
+static Value value_gt(const Value& a, const Value& b, std::size_t line) {
+    return compare(a, b, line, [](auto x, auto y) { return x > y; });
+}
+
+static Value value_gte(const Value& a, const Value& b, std::size_t line) {
+    return compare(a, b, line, [](auto x, auto y) { return x >= y; });
+}
+
+static Value value_lt(const Value& a, const Value& b, std::size_t line) {
+    return compare(a, b, line, [](auto x, auto y) { return x < y; });
+}
+
+static Value value_lte(const Value& a, const Value& b, std::size_t line) {
+    return compare(a, b, line, [](auto x, auto y) { return x <= y; });
+}
+
+// ---------------------- Dispatch table ----------------------
+template <typename T> static T load(const Value& v);
+template <> int load<int>(const Value& v) { return v.i; }
+template <> double load<double>(const Value& v) { return v.f; }
+
+// Int op Int stays Int (except '/'), anything involving a Float is a Float
+template <OpKind Op, typename A, typename B>
+static Value numeric_kernel(const Value& a, const Value& b, std::size_t line)
+{
+    A x = load<A>(a);
+    B y = load<B>(b);
+    constexpr bool ints = std::is_same_v<A, int> && std::is_same_v<B, int>;
+
+    if constexpr (ints && Op == OpKind::Add) return Value::Int(int_add(x, y));
+    else if constexpr (ints && Op == OpKind::Sub) return Value::Int(int_sub(x, y));
+    else if constexpr (ints && Op == OpKind::Mul) return Value::Int(int_mul(x, y));
+    else if constexpr (Op == OpKind::Add) return Value::Float(x + y);
+    else if constexpr (Op == OpKind::Sub) return Value::Float(x - y);
+    else if constexpr (Op == OpKind::Mul) return Value::Float(x * y);
+    if constexpr (Op == OpKind::Div) {
+        if (y == 0) runtime_err(std::is_same_v<A, int> ? "Division by zero" : "Division by zero error", line);
+        return Value::Float(static_cast<double>(x) / y);
     }
-    runtime_err("cannot add Char and " + vtostr(other->kind), line);
-    return nullptr;
+    if constexpr (Op == OpKind::Mod) {
+        if constexpr (ints) return Value::Int(int_mod(x, y));
+        else return Value::Float(std::fmod(x, y));
+    }
+    if constexpr (Op == OpKind::Eq)  return Value::Bool(x == y);
+    if constexpr (Op == OpKind::Neq) return Value::Bool(x != y);
+    if constexpr (Op == OpKind::Gt)  return Value::Bool(x > y);
+    if constexpr (Op == OpKind::Gte) return Value::Bool(x >= y);
+    if constexpr (Op == OpKind::Lt)  return Value::Bool(x < y);
+    if constexpr (Op == OpKind::Lte) return Value::Bool(x <= y);
 }
 
-RVPtr CharValue::eq(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_CHAR) return std::make_shared<BoolValue>(false);
-    return std::make_shared<BoolValue>(value == std::dynamic_pointer_cast<CharValue>(other)->value);
+template <OpKind Op>
+static Value string_kernel(const Value& a, const Value& b, std::size_t)
+{
+    const std::string& x = a.as_string();
+    const std::string& y = b.as_string();
+
+    if constexpr (Op == OpKind::Add) return Value::String(x + y);
+    if constexpr (Op == OpKind::Eq)  return Value::Bool(x == y);
+    if constexpr (Op == OpKind::Neq) return Value::Bool(x != y);
+    if constexpr (Op == OpKind::Gt)  return Value::Bool(x > y);
+    if constexpr (Op == OpKind::Gte) return Value::Bool(x >= y);
+    if constexpr (Op == OpKind::Lt)  return Value::Bool(x < y);
+    if constexpr (Op == OpKind::Lte) return Value::Bool(x <= y);
 }
 
-RVPtr CharValue::neq(RVPtr other, std::size_t line) {
-    if (other->kind != VAL_CHAR) return std::make_shared<BoolValue>(true);
-    return std::make_shared<BoolValue>(value != std::dynamic_pointer_cast<CharValue>(other)->value);
+// Bool and Char only support equality among themselves
+template <OpKind Op>
+static Value scalar_eq_kernel(const Value& a, const Value& b, std::size_t)
+{
+    bool equal = a.kind == VAL_BOOL ? a.b == b.b : a.c == b.c;
+    return Value::Bool(Op == OpKind::Eq ? equal : !equal);
 }
 
-RVPtr CharValue::neg(std::size_t line) {
-    runtime_err("cannot negate a char", line);
-    return nullptr;
+static Value null_kernel(const Value&, const Value&, std::size_t) { return Value::Null(); }
+
+static Value unknown_kernel(const Value&, const Value&, std::size_t line)
+{
+    runtime_err("unknown binary operator", line);
+    return Value();
 }
 
-RVPtr CharValue::pos(std::size_t line) {
-    runtime_err("cannot apply unary + to a char", line);
-    return nullptr;
+template <OpKind Op>
+static constexpr void fill_numeric(BinaryTable& t)
+{
+    auto& k = t.kernels[static_cast<std::size_t>(Op)];
+    k[VAL_INT][VAL_INT]     = numeric_kernel<Op, int, int>;
+    k[VAL_INT][VAL_FLOAT]   = numeric_kernel<Op, int, double>;
+    k[VAL_FLOAT][VAL_INT]   = numeric_kernel<Op, double, int>;
+    k[VAL_FLOAT][VAL_FLOAT] = numeric_kernel<Op, double, double>;
 }
 
-RVPtr CharValue::not_op(std::size_t line) {
-    runtime_err("cannot apply ! to a char", line);
-    return nullptr;
+template <OpKind Op>
+static constexpr void fill_string(BinaryTable& t)
+{
+    t.kernels[static_cast<std::size_t>(Op)][VAL_STRING][VAL_STRING] = string_kernel<Op>;
 }
 
-// ---------------------- NullValue ----------------------
-NullValue::NullValue() : RuntimeValue(VAL_NULL) {}
+template <OpKind Op>
+static constexpr void fill_equality(BinaryTable& t)
+{
+    auto& k = t.kernels[static_cast<std::size_t>(Op)];
+    k[VAL_BOOL][VAL_BOOL] = scalar_eq_kernel<Op>;
+    k[VAL_CHAR][VAL_CHAR] = scalar_eq_kernel<Op>;
+}
 
-// ---------------------- Break&Continue ----------------------
-BreakValue::BreakValue() : RuntimeValue(VAL_BREAK) {}
-ContinueValue::ContinueValue() : RuntimeValue(VAL_CONTINUE) {}
+static constexpr BinaryTable make_binary_table()
+{
+    BinaryTable t{};
 
-// ---------------------- FunctionValue ----------------------
-FunctionValue::FunctionValue(std::shared_ptr<ASTFunctionStmt> d, Environment* c)
-    : RuntimeValue(VAL_FUNCTION),
-      declaration(std::move(d)),
-      closure(c)
-{}
+    constexpr BinaryKernel generic[NUM_BINARY_OPS] = {
+        unknown_kernel,
+        value_add, value_sub, value_mul, value_div, value_mod,
+        value_eq, value_neq, value_gt, value_gte, value_lt, value_lte,
+    };
+
+    for (std::size_t op = 0; op < NUM_BINARY_OPS; op++) {
+        for (std::size_t a = 0; a < NUM_VALUE_TYPES; a++) {
+            for (std::size_t b = 0; b < NUM_VALUE_TYPES; b++) {
+                bool has_null = a == VAL_NULL || b == VAL_NULL;
+                t.kernels[op][a][b] = has_null && op != 0 ? null_kernel : generic[op];
+            }
+        }
+    }
 
-// ---------------------- Base helper ----------------------
-RVPtr RuntimeValue::neq(RVPtr other, std::size_t line) {
-    auto result = std::dynamic_pointer_cast<BoolValue>(eq(other, line));
-    return std::make_shared<BoolValue>(!result->value);
+    fill_numeric<OpKind::Add>(t);
+    fill_numeric<OpKind::Sub>(t);
+    fill_numeric<OpKind::Mul>(t);
+    fill_numeric<OpKind::Div>(t);
+    fill_numeric<OpKind::Mod>(t);
+    fill_numeric<OpKind::Eq>(t);
+    fill_numeric<OpKind::Neq>(t);
+    fill_numeric<OpKind::Gt>(t);
+    fill_numeric<OpKind::Gte>(t);
+    fill_numeric<OpKind::Lt>(t);
+    fill_numeric<OpKind::Lte>(t);
+
+    fill_string<OpKind::Add>(t);
+    fill_string<OpKind::Eq>(t);
+    fill_string<OpKind::Neq>(t);
+    fill_string<OpKind::Gt>(t);
+    fill_string<OpKind::Gte>(t);
+    fill_string<OpKind::Lt>(t);
+    fill_string<OpKind::Lte>(t);
+
+    fill_equality<OpKind::Eq>(t);
+    fill_equality<OpKind::Neq>(t);
+
+    return t;
 }
+
+constexpr BinaryTable binary_table = make_binary_table();
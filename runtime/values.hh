@@ -1,193 +1,185 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <memory>
 #include <functional>
+#include <vector>
 
-#include "../parser/ast.hh"
+#include "../parser/flat_ast.hh"
 #include "../utils/error.hh"
+#include "memory/allocator.hh"
 
 struct Environment;
 
 // ---------------------- Forward declarations ----------------------
 struct RuntimeValue;
-struct IntValue;
-struct FloatValue;
-struct BoolValue;
 struct StringValue;
-struct CharValue;
 struct ArrayValue;
-struct NullValue;
 struct FunctionValue;
-struct ReturnValue;
 
-using RVPtr = std::shared_ptr<RuntimeValue>;
-
-// Supported runtime types
+// Supported runtime types. Everything before VAL_STRING is stored inline in
+// a Value, everything from VAL_STRING on lives on the heap.
 enum ValueType {
     VAL_INT,
     VAL_FLOAT,
     VAL_BOOL,
-    VAL_STRING,
     VAL_CHAR,
     VAL_NULL,
+
+    VAL_STRING,
     VAL_ARRAY,
-    VAL_CONTINUE,
-    VAL_BREAK,
     VAL_FUNCTION,
-    VAL_RETURN,
 };
 
 // ---------------------- Base RuntimeValue ----------------------
+// Heap objects (strings, arrays, functions) are reference counted by the
+// Values pointing at them. The interpreter is single threaded, so the count
+// is a plain integer. Their memory comes from the Allocator's size-class pools.
 struct RuntimeValue {
     ValueType kind;
+    uint32_t refcount = 0;
 
     explicit RuntimeValue(ValueType k) : kind(k) {}
     virtual ~RuntimeValue() = default;
 
-    // Binary operations
-    virtual RVPtr add(RVPtr other, std::size_t line) { runtime_err("cannot add these types", line); return nullptr; }
-    virtual RVPtr sub(RVPtr other, std::size_t line) { runtime_err("cannot subtract these types", line); return nullptr; }
-    virtual RVPtr mul(RVPtr other, std::size_t line) { runtime_err("cannot multiply these types", line); return nullptr; }
-    virtual RVPtr div(RVPtr other, std::size_t line) { runtime_err("cannot divide these types", line); return nullptr; }
-    virtual RVPtr mod(RVPtr other, std::size_t line) { runtime_err("cannot module these types", line); return nullptr; }
-
-    virtual RVPtr eq(RVPtr other, std::size_t line) { runtime_err("cannot compare these types", line); return nullptr; }
-    virtual RVPtr neq(RVPtr other, std::size_t line);
-    virtual RVPtr gt(RVPtr other, std::size_t line) { runtime_err("cannot compare these types", line); return nullptr; }
-    virtual RVPtr gte(RVPtr other, std::size_t line) { runtime_err("cannot compare these types", line); return nullptr; }
-    virtual RVPtr lt(RVPtr other, std::size_t line) { runtime_err("cannot compare these types", line); return nullptr; }
-    virtual RVPtr lte(RVPtr other, std::size_t line) { runtime_err("cannot compare these types", line); return nullptr; }
-
-    // Unary operations
-    virtual RVPtr neg(std::size_t line) { runtime_err("cannot negate this type", line); return nullptr; }
-    virtual RVPtr pos(std::size_t line) { runtime_err("cannot apply unary +", line); return nullptr; }
-    virtual RVPtr not_op(std::size_t line) { runtime_err("cannot apply ! to this type", line); return nullptr; }
-};
-
-// ---------------------- ArrayValue ----------------------
-struct ArrayValue final : RuntimeValue {
-    std::vector<RVPtr> elements;
-    explicit ArrayValue(std::vector<RVPtr> e);
+    static void* operator new(std::size_t size) { return Allocator::instance().allocate(size); }
+    static void operator delete(void* p, std::size_t size) { Allocator::instance().deallocate(p, size); }
 };
 
-// ---------------------- BoolValue ----------------------
-struct BoolValue final : RuntimeValue {
-    bool value;
-    explicit BoolValue(bool v);
-
-    RVPtr eq(RVPtr other, std::size_t line) override;
-    RVPtr not_op(std::size_t line) override;
-};
+// ---------------------- Value ----------------------
+// 16 byte tagged value. Scalars are held inline, heap kinds hold a pointer.
+struct Value {
+    ValueType kind;
+    union {
+        int i;
+        double f;
+        bool b;
+        char c;
+        RuntimeValue* obj;
+    };
+
+    Value() : kind(VAL_NULL), obj(nullptr) {}
+    ~Value() { release(); }
+
+    Value(const Value& other) : kind(other.kind), obj(other.obj) { retain(); }
+    Value(Value&& other) noexcept : kind(other.kind), obj(other.obj) { other.kind = VAL_NULL; other.obj = nullptr; }
+
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            if (other.is_heap()) other.obj->refcount++;
+            release();
+            kind = other.kind;
+            obj = other.obj;
+        }
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            kind = other.kind;
+            obj = other.obj;
+            other.kind = VAL_NULL;
+            other.obj = nullptr;
+        }
+        return *this;
+    }
 
-// ---------------------- FloatValue ----------------------
-struct FloatValue final : RuntimeValue {
-    double value;
-    explicit FloatValue(double v);
-
-    RVPtr add(RVPtr other, std::size_t line) override;
-    RVPtr sub(RVPtr other, std::size_t line) override;
-    RVPtr mul(RVPtr other, std::size_t line) override;
-    RVPtr div(RVPtr other, std::size_t line) override;
-    RVPtr mod(RVPtr other, std::size_t line) override;
-
-    RVPtr eq(RVPtr other, std::size_t line) override;
-    RVPtr gt(RVPtr other, std::size_t line) override;
-    RVPtr gte(RVPtr other, std::size_t line) override;
-    RVPtr lt(RVPtr other, std::size_t line) override;
-    RVPtr lte(RVPtr other, std::size_t line) override;
-
-    RVPtr neg(std::size_t line) override;
-    RVPtr pos(std::size_t line) override;
-    RVPtr not_op(std::size_t line) override;
+    static Value Int(int v)      { Value r; r.kind = VAL_INT; r.i = v; return r; }
+    static Value Float(double v) { Value r; r.kind = VAL_FLOAT; r.f = v; return r; }
+    static Value Bool(bool v)    { Value r; r.kind = VAL_BOOL; r.b = v; return r; }
+    static Value Char(char v)    { Value r; r.kind = VAL_CHAR; r.c = v; return r; }
+    static Value Null()          { return Value(); }
+    static Value String(std::string v);
+    static Value Object(RuntimeValue* o) { Value r; r.kind = o->kind; r.obj = o; o->refcount++; return r; }
+
+    bool is_heap() const { return kind >= VAL_STRING; }
+
+    int as_int() const { return i; }
+    double as_float() const { return f; }
+    bool as_bool() const { return b; }
+    char as_char() const { return c; }
+    const std::string& as_string() const;
+    template <typename T> T* as() const { return static_cast<T*>(obj); }
+
+private:
+    void retain() const { if (is_heap()) obj->refcount++; }
+    void release() { if (is_heap() && --obj->refcount == 0) delete obj; }
 };
 
-// ---------------------- IntValue ----------------------
-struct IntValue final : RuntimeValue {
-    int value;
-    explicit IntValue(int v);
-
-    RVPtr add(RVPtr other, std::size_t line) override;
-    RVPtr sub(RVPtr other, std::size_t line) override;
-    RVPtr mul(RVPtr other, std::size_t line) override;
-    RVPtr div(RVPtr other, std::size_t line) override;
-    RVPtr mod(RVPtr other, std::size_t line) override;
-
-    RVPtr eq(RVPtr other, std::size_t line) override;
-    RVPtr gt(RVPtr other, std::size_t line) override;
-    RVPtr gte(RVPtr other, std::size_t line) override;
-    RVPtr lt(RVPtr other, std::size_t line) override;
-    RVPtr lte(RVPtr other, std::size_t line) override;
-
-    RVPtr neg(std::size_t line) override;
-    RVPtr pos(std::size_t line) override;
-    RVPtr not_op(std::size_t line) override;
-};
+static_assert(sizeof(Value) == 16, "Value should stay two words wide");
 
-// ---------------------- StringValue ----------------------
-struct StringValue final : RuntimeValue {
-    std::string value;
-    explicit StringValue(std::string v);
+// ---------------------- Operators ----------------------
+// Arithmetic and comparison operators dispatch through a table indexed by
+// (operator, left kind, right kind). Numeric, string, bool and char pairs get
+// specialised kernels, a null operand yields null, every other pair reaches
+// a generic kernel that reports the type error through runtime_err.
+using BinaryKernel = Value (*)(const Value& a, const Value& b, std::size_t line);
 
-    RVPtr add(RVPtr other, std::size_t line) override;
+constexpr std::size_t NUM_VALUE_TYPES = VAL_FUNCTION + 1;
+constexpr std::size_t NUM_BINARY_OPS = static_cast<std::size_t>(OpKind::Lte) + 1;
 
-    RVPtr eq(RVPtr other, std::size_t line) override;
-    RVPtr gt(RVPtr other, std::size_t line) override;
-    RVPtr gte(RVPtr other, std::size_t line) override;
-    RVPtr lt(RVPtr other, std::size_t line) override;
-    RVPtr lte(RVPtr other, std::size_t line) override;
+struct BinaryTable {
+    BinaryKernel kernels[NUM_BINARY_OPS][NUM_VALUE_TYPES][NUM_VALUE_TYPES];
 };
 
-// ---------------------- CharValue ----------------------
-struct CharValue final : RuntimeValue {
-    char value;
-    explicit CharValue(char v);
+extern const BinaryTable binary_table;
 
-    RVPtr add(RVPtr other, std::size_t line) override;
-    RVPtr eq(RVPtr other, std::size_t line) override;
-    RVPtr neq(RVPtr other, std::size_t line);
+// 'op' must be one of OpKind::Add .. OpKind::Lte
+inline Value value_binary(OpKind op, const Value& a, const Value& b, std::size_t line) {
+    return binary_table.kernels[static_cast<std::size_t>(op)][a.kind][b.kind](a, b, line);
+}
 
-    RVPtr neg(std::size_t line) override;
-    RVPtr pos(std::size_t line) override;
-    RVPtr not_op(std::size_t line) override;
-};
+// ---------------------- ArrayValue ----------------------
+// Arrays of int, float, char and bool keep their elements unboxed in a flat
+// buffer selected by elem_type; other element types are stored as boxed
+// Values. elem_type is the kind of every element, or VAL_NULL when the
+// array is untyped (a literal mixing kinds).
+struct ArrayValue final : RuntimeValue {
+    ValueType elem_type = VAL_NULL;
 
+    std::vector<int32_t> ints;   // VAL_INT
+    std::vector<double> floats;  // VAL_FLOAT
+    std::vector<char> bytes;     // VAL_CHAR, VAL_BOOL
+    std::vector<Value> values;   // anything else
 
-// ---------------------- NullValue ----------------------
-struct NullValue final : RuntimeValue {
-    NullValue();
-};
+    // Picks the flat representation when every element shares one kind
+    explicit ArrayValue(std::vector<Value> e);
+    explicit ArrayValue(ValueType elem_type);
 
-// ---------------------- Break&Continue ----------------------
+    std::size_t size() const;
+    bool empty() const { return size() == 0; }
+    void reserve(std::size_t n);
 
-struct BreakValue : public RuntimeValue {
-    explicit BreakValue();
-};
+    // 'v' must already be of elem_type, unless the array is untyped
+    Value get(std::size_t i) const;
+    void set(std::size_t i, const Value& v);
+    void push(const Value& v);
 
-struct ContinueValue : public RuntimeValue {
-    explicit ContinueValue();
+    void swap(ArrayValue& other);
 };
 
-// ---------------------- Return ----------------------
-struct ReturnValue : public RuntimeValue {
-    RVPtr value;
-
-    explicit ReturnValue(RVPtr v) 
-        : RuntimeValue(VAL_RETURN), value(v) {}
+// ---------------------- StringValue ----------------------
+struct StringValue final : RuntimeValue {
+    std::string value;
+    explicit StringValue(std::string v);
 };
 
+inline Value Value::String(std::string v) { return Object(new StringValue(std::move(v))); }
+inline const std::string& Value::as_string() const { return static_cast<StringValue*>(obj)->value; }
 
 // ---------------------- FunctionValue ----------------------
 struct FunctionValue final : RuntimeValue {
-    std::shared_ptr<ASTFunctionStmt> declaration;
+    const Ast* ast;                  // the program, alive for the whole run
+    const AstFunction* declaration;  // in ast->functions
     Environment* closure;
 
-    explicit FunctionValue(std::shared_ptr<ASTFunctionStmt> d, Environment* c);
+    FunctionValue(const Ast* a, const AstFunction* d, Environment* c);
 };
 
 struct NativeFunctionValue : public RuntimeValue {
-    using FuncType = std::function<RVPtr(const std::vector<RVPtr>&, Environment*, std::size_t)>;
+    using FuncType = std::function<Value(const std::vector<Value>&, Environment*, std::size_t)>;
 
     std::string name;
     FuncType func;
@@ -208,10 +200,6 @@ inline std::string vtostr(ValueType type) {
         case VAL_ARRAY:    return "array";
         case VAL_FUNCTION: return "function";
         case VAL_NULL:     return "null";
-        case VAL_CONTINUE: return "continue";
-        case VAL_BREAK:    return "break";
-        case VAL_RETURN:   return "return";
         default:           return "unknown";
     }
 }
-
@@ -0,0 +1,221 @@
+#include "chunk.hh"
+
+#include <iostream>
+#include <iomanip>
+
+void Chunk::write(uint8_t byte, std::size_t line)
+{
+    code.push_back(byte);
+    lines.push_back(static_cast<uint32_t>(line));
+}
+
+void Chunk::write_u16(uint16_t v, std::size_t line)
+{
+    write(v & 0xFF, line);
+    write((v >> 8) & 0xFF, line);
+}
+
+void Chunk::write_u32(uint32_t v, std::size_t line)
+{
+    for (int i = 0; i < 4; i++) write((v >> (8 * i)) & 0xFF, line);
+}
+
+void Chunk::patch_u32(std::size_t offset, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) code[offset + i] = (v >> (8 * i)) & 0xFF;
+}
+
+uint32_t Chunk::add_constant(Value value)
+{
+    constants.push_back(std::move(value));
+    return static_cast<uint32_t>(constants.size() - 1);
+}
+
+struct Superinstruction {
+    const char* name;
+    std::vector<uint8_t> parts;
+};
+
+static const Superinstruction* superinstruction(uint8_t op)
+{
+    static const Superinstruction table[] = {
+#define SUPERINSTRUCTION(name, ...) {#name + 3, {__VA_ARGS__}},
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION
+        {nullptr, {}}
+    };
+
+    if (op < OP__BASE_COUNT || op >= OP__COUNT) return nullptr;
+    return &table[op - OP__BASE_COUNT];
+}
+
+const std::vector<uint8_t>& superinstruction_parts(uint8_t op)
+{
+    static const std::vector<uint8_t> none;
+    auto super = superinstruction(op);
+    return super ? super->parts : none;
+}
+
+Fusion fusion_kind(uint8_t op)
+{
+    switch (op) {
+        case OP_CONSTANT: case OP_NULL: case OP_POP:
+        case OP_GET_LOCAL: case OP_SET_LOCAL: case OP_DEFINE_LOCAL: case OP_STORE_LOCAL:
+        case OP_GET_GLOBAL: case OP_SET_GLOBAL: case OP_STORE_GLOBAL:
+        case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MOD:
+        case OP_EQ: case OP_NEQ: case OP_GT: case OP_GTE: case OP_LT: case OP_LTE:
+        case OP_ADD_INT: case OP_SUB_INT: case OP_MUL_INT:
+        case OP_EQ_INT: case OP_NEQ_INT: case OP_GT_INT: case OP_GTE_INT: case OP_LT_INT: case OP_LTE_INT:
+        case OP_NEG: case OP_NOT: case OP_INCDEC: case OP_COERCE:
+        case OP_INDEX: case OP_SET_INDEX:
+            return Fusion::Any;
+        case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_LOOP: case OP_CALL:
+            return Fusion::Last;
+        default:
+            return Fusion::None;
+    }
+}
+
+const char* opcode_name(uint8_t op)
+{
+    if (auto super = superinstruction(op)) return super->name;
+
+    switch (op) {
+        case OP_CONSTANT:       return "CONSTANT";
+        case OP_NULL:           return "NULL";
+        case OP_DEFAULT:        return "DEFAULT";
+        case OP_POP:            return "POP";
+        case OP_GET_LOCAL:      return "GET_LOCAL";
+        case OP_SET_LOCAL:      return "SET_LOCAL";
+        case OP_DEFINE_LOCAL:   return "DEFINE_LOCAL";
+        case OP_GET_GLOBAL:     return "GET_GLOBAL";
+        case OP_SET_GLOBAL:     return "SET_GLOBAL";
+        case OP_DEFINE_GLOBAL:  return "DEFINE_GLOBAL";
+        case OP_STORE_LOCAL:    return "STORE_LOCAL";
+        case OP_STORE_GLOBAL:   return "STORE_GLOBAL";
+        case OP_ADD:            return "ADD";
+        case OP_SUB:            return "SUB";
+        case OP_MUL:            return "MUL";
+        case OP_DIV:            return "DIV";
+        case OP_MOD:            return "MOD";
+        case OP_EQ:             return "EQ";
+        case OP_NEQ:            return "NEQ";
+        case OP_GT:             return "GT";
+        case OP_GTE:            return "GTE";
+        case OP_LT:             return "LT";
+        case OP_LTE:            return "LTE";
+        case OP_AND:            return "AND";
+        case OP_OR:             return "OR";
+        case OP_TO_BOOL:        return "TO_BOOL";
+        case OP_ADD_INT:        return "ADD_INT";
+        case OP_SUB_INT:        return "SUB_INT";
+        case OP_MUL_INT:        return "MUL_INT";
+        case OP_EQ_INT:         return "EQ_INT";
+        case OP_NEQ_INT:        return "NEQ_INT";
+        case OP_GT_INT:         return "GT_INT";
+        case OP_GTE_INT:        return "GTE_INT";
+        case OP_LT_INT:         return "LT_INT";
+        case OP_LTE_INT:        return "LTE_INT";
+        case OP_NEG:            return "NEG";
+        case OP_POS:            return "POS";
+        case OP_NOT:            return "NOT";
+        case OP_INCDEC:         return "INCDEC";
+        case OP_INCDEC_INDEX:   return "INCDEC_INDEX";
+        case OP_COERCE:         return "COERCE";
+        case OP_CAST:           return "CAST";
+        case OP_ARRAY:          return "ARRAY";
+        case OP_ARRAY_DECL:     return "ARRAY_DECL";
+        case OP_INDEX:          return "INDEX";
+        case OP_SET_INDEX:      return "SET_INDEX";
+        case OP_JUMP:           return "JUMP";
+        case OP_JUMP_IF_FALSE:  return "JUMP_IF_FALSE";
+        case OP_LOOP:           return "LOOP";
+        case OP_CALL:           return "CALL";
+        case OP_RETURN:         return "RETURN";
+        case OP_ERROR:          return "ERROR";
+        default:                return "UNKNOWN";
+    }
+}
+
+std::size_t operand_size(uint8_t op)
+{
+    switch (op) {
+        case OP_CONSTANT: case OP_ARRAY: case OP_ERROR:
+        case OP_JUMP: case OP_JUMP_IF_FALSE: case OP_LOOP:
+        case OP_AND: case OP_OR:
+            return 4;
+        case OP_GET_LOCAL: case OP_SET_LOCAL: case OP_GET_GLOBAL: case OP_SET_GLOBAL:
+        case OP_STORE_LOCAL: case OP_STORE_GLOBAL:
+            return 2;
+        case OP_DEFINE_LOCAL:
+            return 3;
+        case OP_DEFINE_GLOBAL:
+            return 4;
+        case OP_DEFAULT: case OP_INCDEC: case OP_COERCE: case OP_CAST: case OP_CALL:
+            return 1;
+        case OP_INCDEC_INDEX: case OP_ARRAY_DECL:
+            return 2;
+        default:
+            break;
+    }
+
+    std::size_t size = 0;
+    for (uint8_t part : superinstruction_parts(op)) size += operand_size(part);
+    return size;
+}
+
+// Prints the operands of base opcode 'op' starting at 'at'
+static void print_operands(const Chunk& chunk, uint8_t op, std::size_t at)
+{
+    switch (operand_size(op)) {
+        case 1: std::cout << " " << int(chunk.code[at]); break;
+        case 2:
+            if (op == OP_INCDEC_INDEX || op == OP_ARRAY_DECL)
+                std::cout << " " << int(chunk.code[at]) << " " << int(chunk.code[at + 1]);
+            else
+                std::cout << " " << chunk.read_u16(at);
+            break;
+        case 3: std::cout << " " << chunk.read_u16(at) << " " << int(chunk.code[at + 2]); break;
+        case 4:
+            if (op == OP_DEFINE_GLOBAL)
+                std::cout << " " << chunk.read_u16(at) << " " << int(chunk.code[at + 2]) << " " << int(chunk.code[at + 3]);
+            else
+                std::cout << " " << chunk.read_u32(at);
+            break;
+    }
+}
+
+void disassemble(const CompiledFunction& fn)
+{
+    const Chunk& chunk = fn.chunk;
+    std::cout << "== " << fn.name << " (" << fn.num_slots << " slots) ==" << std::endl;
+
+    for (std::size_t ip = 0; ip < chunk.code.size();)
+    {
+        uint8_t op = chunk.code[ip];
+        std::cout << std::setw(5) << std::setfill('0') << ip << std::setfill(' ')
+                  << "  line " << std::setw(4) << chunk.lines[ip] << "  " << opcode_name(op);
+
+        auto& parts = superinstruction_parts(op);
+        if (parts.empty()) {
+            print_operands(chunk, op, ip + 1);
+        } else {
+            // Operands of each part, in order
+            std::size_t at = ip + 1;
+            for (uint8_t part : parts) {
+                std::cout << " |";
+                print_operands(chunk, part, at);
+                at += operand_size(part);
+            }
+        }
+        std::cout << std::endl;
+
+        ip += 1 + operand_size(op);
+    }
+
+    for (auto& c : chunk.constants) {
+        if (auto f = c.kind == VAL_FUNCTION ? dynamic_cast<CompiledFunctionValue*>(c.obj) : nullptr) {
+            disassemble(*f->function);
+        }
+    }
+}
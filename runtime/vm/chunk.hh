@@ -0,0 +1,159 @@
+/*
+
+chunk.hh
+
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "../values.hh"
+
+// Bytecode instruction set. Operands follow the opcode byte inline:
+//   u8  -> 1 byte, u16 -> 2 bytes, u32 -> 4 bytes (little endian)
+enum OpCode : uint8_t {
+    OP_CONSTANT,        // u32 const index          -> push constants[idx]
+    OP_NULL,            //                          -> push null
+    OP_DEFAULT,         // u8 type                  -> push default value of type
+    OP_POP,
+
+    OP_GET_LOCAL,       // u16 slot
+    OP_SET_LOCAL,       // u16 slot                 (casts to the slot type, keeps value on stack)
+    OP_DEFINE_LOCAL,    // u16 slot, u8 type        (pops value; type 0xFF = infer from value)
+    OP_GET_GLOBAL,      // u16 global
+    OP_SET_GLOBAL,      // u16 global
+    OP_DEFINE_GLOBAL,   // u16 global, u8 type, u8 const
+    OP_STORE_LOCAL,     // u16 slot                 (SET_LOCAL without the cast, the checker proved the type)
+    OP_STORE_GLOBAL,    // u16 global               (SET_GLOBAL without the cast)
+
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_EQ,
+    OP_NEQ,
+    OP_GT,
+    OP_GTE,
+    OP_LT,
+    OP_LTE,
+    OP_AND,             // u32 forward offset       (left is null or false: jump, keeping null / false)
+    OP_OR,              // u32 forward offset       (left is null or true: jump, keeping null / true)
+    OP_TO_BOOL,         //                          -> right operand of && / ||, null stays null
+
+    // Binary operators on two operands the type checker proved to be ints
+    OP_ADD_INT,
+    OP_SUB_INT,
+    OP_MUL_INT,
+    OP_EQ_INT,
+    OP_NEQ_INT,
+    OP_GT_INT,
+    OP_GTE_INT,
+    OP_LT_INT,
+    OP_LTE_INT,
+
+    OP_NEG,
+    OP_POS,
+    OP_NOT,
+    OP_INCDEC,          // u8 delta (0 = --, 1 = ++) -> replaces numeric top with top +/- 1
+    OP_INCDEC_INDEX,    // u8 delta, u8 prefix      arr idx -> result
+
+    OP_COERCE,          // u8 type                  -> cast() used by declarations
+    OP_CAST,            // u8 type                  -> static_cast<T>()
+
+    OP_ARRAY,           // u32 count                -> build array from the top count values
+    OP_ARRAY_DECL,      // u8 elem type, u8 sized   arr [size] -> checked, padded and cast array
+    OP_INDEX,           // arr idx -> element
+    OP_SET_INDEX,       // arr idx value -> value
+
+    OP_JUMP,            // u32 forward offset
+    OP_JUMP_IF_FALSE,   // u32 forward offset (pops condition)
+    OP_LOOP,            // u32 backward offset
+
+    OP_CALL,            // u8 argc
+    OP_RETURN,
+
+    OP_ERROR,           // u32 const index of the message -> runtime error
+
+    // Superinstructions: runs of the opcodes above fused into one dispatch,
+    // with the operands of their parts back to back
+#define SUPERINSTRUCTION(name, ...) name,
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION
+
+    OP__COUNT
+};
+
+// Opcodes below this are the base instruction set
+constexpr uint8_t OP__BASE_COUNT = OP_ERROR + 1;
+
+static_assert(OP_LTE - OP_ADD == static_cast<int>(OpKind::Lte) - static_cast<int>(OpKind::Add),
+              "binary opcodes must follow the OpKind order");
+
+const char* opcode_name(uint8_t op);
+
+// Size of the inline operands following each opcode
+std::size_t operand_size(uint8_t op);
+
+// Where a base opcode may appear in a superinstruction. Control transfers
+// only end one, the parts after them would run at the jump target.
+enum class Fusion : uint8_t {
+    None,
+    Any,
+    Last,
+};
+
+Fusion fusion_kind(uint8_t op);
+
+// The base opcodes a superinstruction runs, empty for base opcodes
+const std::vector<uint8_t>& superinstruction_parts(uint8_t op);
+
+// Marker for OP_DEFINE_* when the declared type is 'auto'
+constexpr uint8_t TYPE_INFER = 0xFF;
+
+struct Chunk {
+    std::vector<uint8_t> code;
+    std::vector<Value> constants;
+    std::vector<uint32_t> lines; // one entry per byte of code
+
+    void write(uint8_t byte, std::size_t line);
+    void write_u16(uint16_t v, std::size_t line);
+    void write_u32(uint32_t v, std::size_t line);
+    void patch_u32(std::size_t offset, uint32_t v);
+
+    uint32_t add_constant(Value value);
+
+    uint16_t read_u16(std::size_t offset) const { return code[offset] | (code[offset + 1] << 8); }
+    uint32_t read_u32(std::size_t offset) const {
+        return code[offset] | (code[offset + 1] << 8) | (code[offset + 2] << 16) | (uint32_t(code[offset + 3]) << 24);
+    }
+};
+
+struct ParamSpec {
+    std::string name;
+    ValueType type;
+    bool is_auto;
+    bool is_array;
+};
+
+// A function body compiled to bytecode. The top-level script is one too.
+struct CompiledFunction {
+    std::string name;
+    std::string ret_type;
+    std::vector<ParamSpec> params;
+    uint16_t num_slots = 0;
+    Chunk chunk;
+};
+
+struct CompiledFunctionValue final : RuntimeValue {
+    std::shared_ptr<CompiledFunction> function;
+
+    explicit CompiledFunctionValue(std::shared_ptr<CompiledFunction> f)
+        : RuntimeValue(VAL_FUNCTION), function(std::move(f)) {}
+};
+
+void disassemble(const CompiledFunction& fn);
@@ -0,0 +1,761 @@
+#include "compiler.hh"
+
+#include "../../utils/error.hh"
+#include "../../utils/utils.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+Compiler::Compiler(const std::vector<std::string>& predeclared)
+{
+    for (auto& name : predeclared) global_index(name);
+
+    for (std::size_t op = OP__BASE_COUNT; op < OP__COUNT; op++) {
+        auto& parts = superinstruction_parts(static_cast<uint8_t>(op));
+        superinstructions[parts] = static_cast<uint8_t>(op);
+        longest_superinstruction = std::max(longest_superinstruction, parts.size());
+    }
+}
+
+std::shared_ptr<CompiledFunction> Compiler::compile(const Ast& program)
+{
+    FunctionState script;
+    script.function = std::make_shared<CompiledFunction>();
+    script.function->name = "<script>";
+    script.function->ret_type = "void";
+    script.is_script = true;
+    current = &script;
+    ast = &program;
+
+    const Node& root = program[program.root];
+    for (uint32_t i = 0; i < root.b; i++) {
+        compile_stmt(program.lists[root.a + i]);
+    }
+
+    emit_op(OP_NULL, root.line);
+    emit_op(OP_RETURN, root.line);
+
+    current = nullptr;
+    ast = nullptr;
+    return script.function;
+}
+
+/* ------------------------- Emission ------------------------- */
+
+Chunk& Compiler::chunk()
+{
+    return current->function->chunk;
+}
+
+void Compiler::emit(uint8_t byte, std::size_t line)
+{
+    chunk().write(byte, line);
+}
+
+// Fusable opcodes on the same line join the current run, which is then
+// re-split into the fewest instructions the superinstruction set allows.
+// Nothing refers to code inside a run: jump targets end it (label()) and a
+// jump is only ever the last instruction of a superinstruction, emitted
+// before its operand is.
+void Compiler::emit_op(uint8_t op, std::size_t line)
+{
+    FunctionState& fs = *current;
+    Chunk& c = chunk();
+
+    if (!fs.run.empty()) {
+        // The previous instruction's operands are complete by now
+        fs.run.back().operands.assign(c.code.begin() + fs.run_end, c.code.end());
+
+        if (fusion_kind(fs.run.back().op) != Fusion::Any || line != fs.run_line) fs.run.clear();
+    }
+
+    if (!fuse || superinstructions.empty() || fusion_kind(op) == Fusion::None) {
+        fs.run.clear();
+        emit(op, line);
+        return;
+    }
+
+    if (fs.run.empty()) {
+        fs.run_start = c.code.size();
+        fs.run_line = line;
+    }
+    fs.run.push_back(Pending{op, {}});
+    emit(op, line);
+    fs.run_end = c.code.size();
+
+    if (fs.run.size() > 1) fuse_run();
+}
+
+void Compiler::fuse_run()
+{
+    FunctionState& fs = *current;
+    Chunk& c = chunk();
+    std::size_t n = fs.run.size();
+
+    // fewest[i]: instructions needed for the first i of the run, last[i]:
+    // where the instruction ending at i starts
+    std::vector<std::size_t> fewest(n + 1, 0), last(n + 1, 0);
+    std::vector<uint8_t> parts;
+    for (std::size_t i = 1; i <= n; i++) {
+        fewest[i] = fewest[i - 1] + 1;
+        last[i] = i - 1;
+
+        std::size_t from = i > longest_superinstruction ? i - longest_superinstruction : 0;
+        for (std::size_t j = from; j + 1 < i; j++) {
+            parts.clear();
+            for (std::size_t k = j; k < i; k++) parts.push_back(fs.run[k].op);
+            if (fewest[j] + 1 < fewest[i] && superinstructions.count(parts)) {
+                fewest[i] = fewest[j] + 1;
+                last[i] = j;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::size_t, std::size_t>> segments;
+    for (std::size_t i = n; i > 0; i = last[i]) segments.emplace_back(last[i], i);
+    std::reverse(segments.begin(), segments.end());
+
+    // Rewrite the run, the last instruction's operands are still to come
+    c.code.resize(fs.run_start);
+    c.lines.resize(fs.run_start);
+    for (auto [begin, end] : segments) {
+        parts.clear();
+        for (std::size_t k = begin; k < end; k++) parts.push_back(fs.run[k].op);
+        emit(end - begin == 1 ? parts[0] : superinstructions.at(parts), fs.run_line);
+
+        for (std::size_t k = begin; k < end; k++) {
+            for (uint8_t byte : fs.run[k].operands) emit(byte, fs.run_line);
+        }
+    }
+    fs.run_end = c.code.size();
+
+    // Instructions too far back to join a later superinstruction are final
+    if (segments.size() > 1 && segments[0].second + longest_superinstruction < n) {
+        std::size_t drop = segments[0].second;
+        fs.run_start += 1;
+        for (std::size_t k = 0; k < drop; k++) fs.run_start += fs.run[k].operands.size();
+        fs.run.erase(fs.run.begin(), fs.run.begin() + drop);
+    }
+}
+
+std::size_t Compiler::label()
+{
+    current->run.clear();
+    return chunk().code.size();
+}
+
+void Compiler::emit_constant(Value value, std::size_t line)
+{
+    uint32_t idx = chunk().add_constant(std::move(value));
+    emit_op(OP_CONSTANT, line);
+    chunk().write_u32(idx, line);
+}
+
+void Compiler::emit_error(const std::string& msg, std::size_t line)
+{
+    uint32_t idx = chunk().add_constant(Value::String(msg));
+    emit_op(OP_ERROR, line);
+    chunk().write_u32(idx, line);
+}
+
+std::size_t Compiler::emit_jump(uint8_t op, std::size_t line)
+{
+    emit_op(op, line);
+    chunk().write_u32(0, line);
+    return chunk().code.size() - 4;
+}
+
+void Compiler::patch_jump(std::size_t operand)
+{
+    label();
+
+    // Offset is relative to the instruction following the operand
+    std::size_t jump = chunk().code.size() - (operand + 4);
+    chunk().patch_u32(operand, static_cast<uint32_t>(jump));
+}
+
+void Compiler::emit_loop(std::size_t start, std::size_t line)
+{
+    emit_op(OP_LOOP, line);
+    std::size_t offset = chunk().code.size() + 4 - start;
+    chunk().write_u32(static_cast<uint32_t>(offset), line);
+}
+
+/* ------------------------- Variables ------------------------- */
+
+void Compiler::begin_scope()
+{
+    current->scope_depth++;
+}
+
+void Compiler::end_scope()
+{
+    current->scope_depth--;
+    while (!current->locals.empty() && current->locals.back().depth > current->scope_depth) {
+        current->locals.pop_back();
+    }
+    while (!current->global_uses.empty() && current->global_uses.back().depth > current->scope_depth) {
+        current->global_uses.pop_back();
+    }
+}
+
+uint16_t Compiler::global_index(const std::string& name)
+{
+    auto it = global_ids.find(name);
+    if (it != global_ids.end()) return it->second;
+
+    if (globals.size() >= std::numeric_limits<uint16_t>::max())
+        compile_err("too many global variables", 0);
+
+    uint16_t idx = static_cast<uint16_t>(globals.size());
+    globals.push_back(name);
+    global_ids[name] = idx;
+    return idx;
+}
+
+const Compiler::Local* Compiler::find_local(const FunctionState* fs, const std::string& name) const
+{
+    for (auto it = fs->locals.rbegin(); it != fs->locals.rend(); ++it) {
+        if (it->name == name) return &*it;
+    }
+    return nullptr;
+}
+
+// Pops the value on top of the stack into a new variable in the current scope
+void Compiler::declare_variable(const std::string& name, uint8_t type, bool is_const, std::size_t line)
+{
+    if (current->is_script && current->scope_depth == 0) {
+        emit_op(OP_DEFINE_GLOBAL, line);
+        chunk().write_u16(global_index(name), line);
+        emit(type, line);
+        emit(is_const ? 1 : 0, line);
+        return;
+    }
+
+    for (auto it = current->locals.rbegin(); it != current->locals.rend() && it->depth == current->scope_depth; ++it) {
+        if (it->name == name) {
+            emit_error("ryc: cannot redeclare variable '" + name + "'", line);
+            return;
+        }
+    }
+
+    // The tree walker switches a function declared earlier in this scope
+    // over to the new variable once it is declared. A function's own name
+    // is declared right after its body, that is not a later shadow.
+    for (auto& use : current->global_uses) {
+        if (use.name == name && use.depth == current->scope_depth && use.function != name)
+            compile_err("function '" + use.function + "' captures local variable '" + name +
+                        "', closures are not supported by the vm engine", line);
+    }
+
+    if (current->locals.size() >= std::numeric_limits<uint16_t>::max())
+        compile_err("too many local variables in function '" + current->function->name + "'", line);
+
+    uint16_t slot = static_cast<uint16_t>(current->locals.size());
+    current->locals.push_back(Local{name, current->scope_depth, slot, is_const});
+    if (slot + 1 > current->function->num_slots) current->function->num_slots = slot + 1;
+
+    emit_op(OP_DEFINE_LOCAL, line);
+    chunk().write_u16(slot, line);
+    emit(type, line);
+}
+
+void Compiler::emit_get(const std::string& name, std::size_t line)
+{
+    if (auto local = find_local(current, name)) {
+        emit_op(OP_GET_LOCAL, line);
+        chunk().write_u16(local->slot, line);
+        return;
+    }
+
+    for (FunctionState* fs = current->enclosing; fs; fs = fs->enclosing) {
+        if (find_local(fs, name))
+            compile_err("function '" + current->function->name + "' captures local variable '" + name +
+                        "', closures are not supported by the vm engine", line);
+    }
+
+    note_global_use(name);
+    emit_op(OP_GET_GLOBAL, line);
+    chunk().write_u16(global_index(name), line);
+}
+
+// Assigns the value on top of the stack, leaving it in place
+void Compiler::emit_set(const std::string& name, std::size_t line, bool coerce)
+{
+    if (auto local = find_local(current, name)) {
+        if (local->is_const) {
+            emit_error("ryc: cannot assign to constant variable '" + name + "'", line);
+            return;
+        }
+        emit_op(coerce ? OP_SET_LOCAL : OP_STORE_LOCAL, line);
+        chunk().write_u16(local->slot, line);
+        return;
+    }
+
+    for (FunctionState* fs = current->enclosing; fs; fs = fs->enclosing) {
+        if (find_local(fs, name))
+            compile_err("function '" + current->function->name + "' captures local variable '" + name +
+                        "', closures are not supported by the vm engine", line);
+    }
+
+    note_global_use(name);
+    emit_op(coerce ? OP_SET_GLOBAL : OP_STORE_GLOBAL, line);
+    chunk().write_u16(global_index(name), line);
+}
+
+// Records 'name' against every function state 'current' is nested in
+void Compiler::note_global_use(const std::string& name)
+{
+    for (FunctionState* fs = current->enclosing; fs; fs = fs->enclosing) {
+        fs->global_uses.push_back(GlobalUse{name, fs->scope_depth, current->function->name});
+    }
+}
+
+// Type named by a declaration, the checker's result unless it left it open
+ValueType Compiler::declared_type(NameId type_name, uint8_t checked, std::size_t line) const
+{
+    if (checked != NO_TYPE) return static_cast<ValueType>(checked);
+    return stoval(ast->name(type_name), nullptr, line);
+}
+
+/* ------------------------- Statements ------------------------- */
+
+void Compiler::compile_stmt(NodeId id)
+{
+    const Node& node = (*ast)[id];
+
+    switch (node.kind) {
+        case NodeType::ExprStmt:
+            compile_discarded(node.a, node.line);
+            break;
+        case NodeType::VarDeclaration:
+            compile_var_declaration(node);
+            break;
+        case NodeType::IfStmt:
+            compile_if_stmt(node);
+            break;
+        case NodeType::WhileStmt:
+            compile_while_stmt(node);
+            break;
+        case NodeType::ForStmt:
+            compile_for_stmt(node);
+            break;
+        case NodeType::FunctionStmt:
+            compile_func_stmt(node);
+            break;
+        case NodeType::ReturnStmt:
+            compile_return_stmt(node);
+            break;
+        case NodeType::BlockStmt:
+            compile_block(node);
+            break;
+        case NodeType::BreakStmt:
+        case NodeType::ContinueStmt:
+        {
+            bool is_break = node.kind == NodeType::BreakStmt;
+            if (current->loops.empty()) {
+                emit_error(std::string("'") + (is_break ? "break" : "continue") + "' outside of a loop", node.line);
+                break;
+            }
+            std::size_t jump = emit_jump(OP_JUMP, node.line);
+            if (is_break) current->loops.back().break_jumps.push_back(jump);
+            else current->loops.back().continue_jumps.push_back(jump);
+            break;
+        }
+        default:
+        {
+            // Any expression used as a statement
+            compile_discarded(id, node.line);
+            break;
+        }
+    }
+}
+
+void Compiler::compile_block(const Node& node)
+{
+    begin_scope();
+    for (uint32_t i = 0; i < node.b; i++) {
+        compile_stmt(ast->lists[node.a + i]);
+    }
+    end_scope();
+}
+
+void Compiler::compile_var_declaration(const Node& node)
+{
+    const AstVarDecl& var = ast->vars[node.a];
+    const std::string& name = ast->name(var.name);
+    const std::string& type_name = ast->name(var.type);
+    bool infer_type = (type_name == "auto");
+    bool is_const = node.has(FLAG_CONST);
+    std::size_t line = node.line;
+
+    if (node.has(FLAG_ARRAY)) {
+        if (var.value == NO_NODE) {
+            emit_error("cannot declare array without initializer", line);
+            return;
+        }
+
+        compile_expr(var.value);
+        if (var.array_size != NO_NODE) {
+            compile_expr(var.array_size);
+        }
+
+        emit_op(OP_ARRAY_DECL, line);
+        emit(infer_type ? TYPE_INFER : static_cast<uint8_t>(declared_type(var.type, var.value_type, line)), line);
+        emit(var.array_size != NO_NODE ? 1 : 0, line);
+
+        declare_variable(name, VAL_ARRAY, is_const, line);
+        return;
+    }
+
+    if (var.value == NO_NODE) {
+        ValueType type = declared_type(var.type, var.value_type, line);
+        emit_op(OP_DEFAULT, line);
+        emit(type, line);
+        declare_variable(name, type, is_const, line);
+        return;
+    }
+
+    compile_expr(var.value);
+
+    if (infer_type) {
+        declare_variable(name, TYPE_INFER, is_const, line);
+        return;
+    }
+
+    ValueType type = declared_type(var.type, var.value_type, line);
+    if ((*ast)[var.value].kind != NodeType::CastExpr && !node.has(FLAG_NO_CAST)) {
+        emit_op(OP_COERCE, line);
+        emit(type, line);
+    }
+    declare_variable(name, type, is_const, line);
+}
+
+void Compiler::compile_if_stmt(const Node& node)
+{
+    compile_expr(node.a);
+    std::size_t else_jump = emit_jump(OP_JUMP_IF_FALSE, node.line);
+
+    compile_stmt(node.b);
+
+    if (node.c != NO_NODE) {
+        std::size_t end_jump = emit_jump(OP_JUMP, node.line);
+        patch_jump(else_jump);
+        compile_stmt(node.c);
+        patch_jump(end_jump);
+    } else {
+        patch_jump(else_jump);
+    }
+}
+
+void Compiler::compile_while_stmt(const Node& node)
+{
+    std::size_t start = label();
+
+    compile_expr(node.a);
+    std::size_t exit_jump = emit_jump(OP_JUMP_IF_FALSE, node.line);
+
+    current->loops.emplace_back();
+    compile_stmt(node.b);
+
+    LoopState loop = std::move(current->loops.back());
+    current->loops.pop_back();
+
+    for (auto j : loop.continue_jumps) patch_jump(j);
+    emit_loop(start, node.line);
+
+    patch_jump(exit_jump);
+    for (auto j : loop.break_jumps) patch_jump(j);
+}
+
+void Compiler::compile_for_stmt(const Node& node)
+{
+    NodeId update = ast->lists[node.c];
+    NodeId body = ast->lists[node.c + 1];
+
+    // The initializer lives in the enclosing scope, just like the tree walker
+    if (node.a != NO_NODE) {
+        compile_stmt(node.a);
+    }
+
+    std::size_t start = label();
+    std::size_t exit_jump = 0;
+    bool has_cond = node.b != NO_NODE;
+
+    if (has_cond) {
+        compile_expr(node.b);
+        exit_jump = emit_jump(OP_JUMP_IF_FALSE, node.line);
+    }
+
+    current->loops.emplace_back();
+    compile_stmt(body);
+
+    LoopState loop = std::move(current->loops.back());
+    current->loops.pop_back();
+
+    for (auto j : loop.continue_jumps) patch_jump(j);
+    if (update != NO_NODE) {
+        compile_discarded(update, node.line);
+    }
+    emit_loop(start, node.line);
+
+    if (has_cond) patch_jump(exit_jump);
+    for (auto j : loop.break_jumps) patch_jump(j);
+}
+
+void Compiler::compile_func_stmt(const Node& node)
+{
+    const AstFunction& decl = ast->functions[node.a];
+
+    FunctionState fs;
+    fs.enclosing = current;
+    fs.function = std::make_shared<CompiledFunction>();
+    fs.function->name = ast->name(decl.name);
+    fs.function->ret_type = ast->name(decl.ret_type);
+
+    current = &fs;
+
+    // Parameters get their own scope, the body block opens another one
+    begin_scope();
+    for (uint32_t i = 0; i < decl.params_count; i++) {
+        const AstParam& param = ast->params[decl.params_begin + i];
+        const std::string& param_type = ast->name(param.type);
+
+        ParamSpec spec;
+        spec.name = ast->name(param.name);
+        spec.is_auto = param_type == "auto";
+        spec.type = spec.is_auto ? VAL_NULL : declared_type(param.type, param.value_type, param.line);
+        spec.is_array = param.is_array;
+        fs.function->params.push_back(spec);
+
+        uint16_t slot = static_cast<uint16_t>(fs.locals.size());
+        fs.locals.push_back(Local{spec.name, fs.scope_depth, slot, true});
+    }
+    fs.function->num_slots = static_cast<uint16_t>(fs.locals.size());
+
+    compile_stmt(decl.body);
+    end_scope();
+
+    emit_op(OP_NULL, node.line);
+    emit_op(OP_RETURN, node.line);
+
+    current = fs.enclosing;
+
+    emit_constant(Value::Object(new CompiledFunctionValue(fs.function)), node.line);
+    declare_variable(ast->name(decl.name), VAL_FUNCTION, true, node.line);
+}
+
+void Compiler::compile_return_stmt(const Node& node)
+{
+    if (node.a != NO_NODE) {
+        compile_expr(node.a);
+        if (!current->is_script && current->function->ret_type == "void") {
+            emit_error("void functions cannot return a value", node.line);
+            return;
+        }
+    } else {
+        emit_op(OP_NULL, node.line);
+    }
+
+    emit_op(OP_RETURN, node.line);
+}
+
+/* ------------------------- Expressions ------------------------- */
+
+void Compiler::compile_expr(NodeId id)
+{
+    const Node& node = (*ast)[id];
+    std::size_t line = node.line;
+
+    switch (node.kind) {
+        case NodeType::NumericLiteral:
+            if (node.has(FLAG_INT))
+                emit_constant(Value::Int(Ast::int_value(node)), line);
+            else
+                emit_constant(Value::Float(Ast::float_value(node)), line);
+            break;
+        case NodeType::StringLiteral:
+            emit_constant(Value::String(ast->name(node.a)), line);
+            break;
+        case NodeType::CharLiteral:
+            emit_constant(Value::Char(static_cast<char>(node.a)), line);
+            break;
+        case NodeType::BoolLiteral:
+            emit_constant(Value::Bool(node.a != 0), line);
+            break;
+        case NodeType::NullLiteral:
+            emit_op(OP_NULL, line);
+            break;
+        case NodeType::IdentifierLiteral:
+            emit_get(ast->name(node.a), line);
+            break;
+        case NodeType::ArrayLiteral:
+        {
+            for (uint32_t i = 0; i < node.b; i++) compile_expr(ast->lists[node.a + i]);
+            emit_op(OP_ARRAY, line);
+            chunk().write_u32(node.b, line);
+            break;
+        }
+        case NodeType::BinaryExpr:
+        {
+            // && and || only evaluate the right operand when the left one
+            // does not already decide the result
+            if (node.op == OpKind::And || node.op == OpKind::Or) {
+                compile_expr(node.a);
+                std::size_t end_jump = emit_jump(node.op == OpKind::And ? OP_AND : OP_OR, line);
+                compile_expr(node.b);
+                emit_op(OP_TO_BOOL, line);
+                patch_jump(end_jump);
+                break;
+            }
+
+            compile_expr(node.a);
+            compile_expr(node.b);
+
+            // '/' and '%' keep their division by zero checks in value_binary()
+            if (node.has(FLAG_INT_OPERANDS) && node.op != OpKind::Div && node.op != OpKind::Mod) {
+                switch (node.op) {
+                    case OpKind::Add: emit_op(OP_ADD_INT, line); break;
+                    case OpKind::Sub: emit_op(OP_SUB_INT, line); break;
+                    case OpKind::Mul: emit_op(OP_MUL_INT, line); break;
+                    case OpKind::Eq:  emit_op(OP_EQ_INT, line); break;
+                    case OpKind::Neq: emit_op(OP_NEQ_INT, line); break;
+                    case OpKind::Gt:  emit_op(OP_GT_INT, line); break;
+                    case OpKind::Gte: emit_op(OP_GTE_INT, line); break;
+                    case OpKind::Lt:  emit_op(OP_LT_INT, line); break;
+                    default:          emit_op(OP_LTE_INT, line); break;
+                }
+                break;
+            }
+
+            switch (node.op) {
+                case OpKind::Add: emit_op(OP_ADD, line); break;
+                case OpKind::Sub: emit_op(OP_SUB, line); break;
+                case OpKind::Mul: emit_op(OP_MUL, line); break;
+                case OpKind::Div: emit_op(OP_DIV, line); break;
+                case OpKind::Mod: emit_op(OP_MOD, line); break;
+                case OpKind::Eq:  emit_op(OP_EQ, line); break;
+                case OpKind::Neq: emit_op(OP_NEQ, line); break;
+                case OpKind::Gt:  emit_op(OP_GT, line); break;
+                case OpKind::Gte: emit_op(OP_GTE, line); break;
+                case OpKind::Lt:  emit_op(OP_LT, line); break;
+                case OpKind::Lte: emit_op(OP_LTE, line); break;
+                default:
+                    emit_error("unknown binary operator '" + std::string(op_str(node.op)) + "'", line);
+            }
+            break;
+        }
+        case NodeType::UnaryExpr:
+            compile_unary_expr(node);
+            break;
+        case NodeType::AssignmentExpr:
+            compile_assign_expr(node);
+            break;
+        case NodeType::MemberExpr:
+            compile_expr(node.a);
+            compile_expr(node.b);
+            emit_op(OP_INDEX, line);
+            break;
+        case NodeType::CallExpr:
+        {
+            if (node.c > 255) compile_err("too many arguments in call", line);
+
+            compile_expr(node.a);
+            for (uint32_t i = 0; i < node.c; i++) compile_expr(ast->lists[node.b + i]);
+            emit_op(OP_CALL, line);
+            emit(static_cast<uint8_t>(node.c), line);
+            break;
+        }
+        case NodeType::CastExpr:
+            compile_expr(node.b);
+            emit_op(OP_CAST, line);
+            emit(node.c != NO_TYPE ? static_cast<ValueType>(node.c) : stoval(ast->name(node.a), nullptr, line), line);
+            break;
+        default:
+            compile_err("this AST node is not supported by the vm engine", line);
+    }
+}
+
+void Compiler::compile_discarded(NodeId id, std::size_t line)
+{
+    const Node& node = (*ast)[id];
+
+    // 'i++' and '++i' only differ in the value they leave, which is dropped
+    // here; the prefix form skips keeping a copy of the old one
+    if (node.kind == NodeType::UnaryExpr && (node.op == OpKind::Inc || node.op == OpKind::Dec)) {
+        compile_unary_expr(node, true);
+    } else {
+        compile_expr(id);
+    }
+
+    emit_op(OP_POP, line);
+}
+
+void Compiler::compile_unary_expr(const Node& node, bool discarded)
+{
+    std::size_t line = node.line;
+    const std::string op = op_str(node.op);
+    bool prefix = node.has(FLAG_PREFIX) || discarded;
+    const Node& operand = (*ast)[node.a];
+
+    if (node.op == OpKind::Inc || node.op == OpKind::Dec) {
+        uint8_t delta = node.op == OpKind::Inc ? 1 : 0;
+
+        if (operand.kind == NodeType::IdentifierLiteral) {
+            const std::string& name = ast->name(operand.a);
+
+            emit_get(name, line);
+            if (!prefix) emit_get(name, line);
+            emit_op(OP_INCDEC, line);
+            emit(delta, line);
+            emit_set(name, line, !node.has(FLAG_NO_CAST));
+            if (!prefix) emit_op(OP_POP, line);
+            return;
+        }
+
+        if (operand.kind == NodeType::MemberExpr) {
+            compile_expr(operand.a);
+            compile_expr(operand.b);
+            emit_op(OP_INCDEC_INDEX, line);
+            emit(delta, line);
+            emit(prefix ? 1 : 0, line);
+            return;
+        }
+
+        compile_expr(node.a);
+        emit_error("ryc: " + op + " can only be applied to assignable values.", line);
+        return;
+    }
+
+    compile_expr(node.a);
+
+    switch (node.op) {
+        case OpKind::Sub: emit_op(OP_NEG, line); break;
+        case OpKind::Add: emit_op(OP_POS, line); break;
+        case OpKind::Not: emit_op(OP_NOT, line); break;
+        default: emit_error("ryc: unknown unary operator '" + op + "'.", line);
+    }
+}
+
+void Compiler::compile_assign_expr(const Node& node)
+{
+    std::size_t line = node.line;
+    const Node& assignee = (*ast)[node.a];
+
+    if (assignee.kind == NodeType::MemberExpr) {
+        compile_expr(assignee.a);
+        compile_expr(assignee.b);
+        compile_expr(node.b);
+        emit_op(OP_SET_INDEX, line);
+        return;
+    }
+
+    if (assignee.kind == NodeType::IdentifierLiteral) {
+        compile_expr(node.b);
+        emit_set(ast->name(assignee.a), line, !node.has(FLAG_NO_CAST));
+        return;
+    }
+
+    emit_error("invalid assignee in assignment expression", line);
+}
@@ -0,0 +1,132 @@
+/*
+
+compiler.hh
+
+*/
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include "chunk.hh"
+#include "../../parser/flat_ast.hh"
+
+// Lowers a parsed program to bytecode for the VM. Locals are resolved to frame
+// slots at compile time, globals to indices into the VM's global table.
+class Compiler {
+public:
+    // 'predeclared' are globals that exist before the script runs (natives)
+    explicit Compiler(const std::vector<std::string>& predeclared);
+
+    std::shared_ptr<CompiledFunction> compile(const Ast& program);
+
+    const std::vector<std::string>& global_names() const { return globals; }
+
+    // Fuses runs of instructions into superinstructions (on by default).
+    // Profiling turns it off so the counts are in base opcodes.
+    void set_superinstructions(bool enabled) { fuse = enabled; }
+
+private:
+    struct Local {
+        std::string name;
+        int depth;
+        uint16_t slot;
+        bool is_const;
+    };
+
+    // A name a nested function reads or writes as a global. A local of the
+    // same name declared later in that scope would be a capture.
+    struct GlobalUse {
+        std::string name;
+        int depth;            // scope depth the function was declared at
+        std::string function;
+    };
+
+    struct LoopState {
+        std::vector<std::size_t> break_jumps;
+        std::vector<std::size_t> continue_jumps;
+    };
+
+    // A base instruction of the current run, see emit_op()
+    struct Pending {
+        uint8_t op;
+        std::vector<uint8_t> operands;
+    };
+
+    struct FunctionState {
+        FunctionState* enclosing = nullptr;
+        std::shared_ptr<CompiledFunction> function;
+        std::vector<Local> locals;
+        std::vector<LoopState> loops;
+        std::vector<GlobalUse> global_uses;
+        int scope_depth = 0;
+        bool is_script = false;
+
+        // Fusable instructions emitted since the last jump target, all on
+        // one line. Their code starts at run_start and may still be
+        // rewritten; run_end is where the last one's operands begin.
+        std::vector<Pending> run;
+        std::size_t run_start = 0;
+        std::size_t run_end = 0;
+        std::size_t run_line = 0;
+    };
+
+    void compile_stmt(NodeId id);
+    void compile_expr(NodeId id);
+
+    void compile_block(const Node& node);
+    void compile_var_declaration(const Node& node);
+    void compile_if_stmt(const Node& node);
+    void compile_while_stmt(const Node& node);
+    void compile_for_stmt(const Node& node);
+    void compile_func_stmt(const Node& node);
+    void compile_return_stmt(const Node& node);
+
+    // 'discarded' when the value is popped right away
+    void compile_unary_expr(const Node& node, bool discarded = false);
+    void compile_assign_expr(const Node& node);
+    // An expression statement, its value is popped
+    void compile_discarded(NodeId id, std::size_t line);
+
+    ValueType declared_type(NameId type_name, uint8_t checked, std::size_t line) const;
+
+    // Variables
+    void declare_variable(const std::string& name, uint8_t type, bool is_const, std::size_t line);
+    void emit_get(const std::string& name, std::size_t line);
+    // 'coerce' casts to the variable's type, off when the checker proved it
+    void emit_set(const std::string& name, std::size_t line, bool coerce = true);
+    void note_global_use(const std::string& name);
+    const Local* find_local(const FunctionState* fs, const std::string& name) const;
+    uint16_t global_index(const std::string& name);
+
+    void begin_scope();
+    void end_scope();
+
+    // Emission helpers
+    Chunk& chunk();
+    void emit(uint8_t byte, std::size_t line);
+    // Emits an opcode, its operands follow with emit() / write_*
+    void emit_op(uint8_t op, std::size_t line);
+    void fuse_run();
+    // Marks the current position as a jump target, no superinstruction
+    // spans it
+    std::size_t label();
+    void emit_constant(Value value, std::size_t line);
+    void emit_error(const std::string& msg, std::size_t line);
+    std::size_t emit_jump(uint8_t op, std::size_t line);
+    void patch_jump(std::size_t operand);
+    void emit_loop(std::size_t start, std::size_t line);
+
+    const Ast* ast = nullptr;
+    FunctionState* current = nullptr;
+    std::vector<std::string> globals;
+    std::unordered_map<std::string, uint16_t> global_ids;
+
+    bool fuse = true;
+    std::map<std::vector<uint8_t>, uint8_t> superinstructions; // by parts
+    std::size_t longest_superinstruction = 0;
+};
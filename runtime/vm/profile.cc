@@ -0,0 +1,92 @@
+#include "profile.hh"
+#include "chunk.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+OpProfile& OpProfile::instance()
+{
+    static OpProfile inst;
+    return inst;
+}
+
+OpProfile::OpProfile()
+{
+    for (std::size_t op = 0; op < 256; op++) operand_sizes[op] = operand_size(static_cast<uint8_t>(op));
+}
+
+std::vector<OpProfile::Entry> OpProfile::entries() const
+{
+    std::vector<Entry> out;
+    out.reserve(counts.size());
+
+    for (auto& [key, count] : counts) {
+        std::size_t n = key >> 56;
+        Entry e{count, {}};
+        for (std::size_t i = n; i-- > 0;) e.ops.push_back((key >> (8 * i)) & 0xFF);
+        out.push_back(std::move(e));
+    }
+
+    std::sort(out.begin(), out.end(), [](const Entry& a, const Entry& b) {
+        return a.count != b.count ? a.count > b.count : a.ops < b.ops;
+    });
+    return out;
+}
+
+// Line format: the count, then the opcode names of the n-gram
+bool OpProfile::load(const std::string& path, std::vector<Entry>& out)
+{
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::map<std::string, uint8_t> by_name;
+    for (std::size_t op = 0; op < OP__COUNT; op++) by_name[opcode_name(static_cast<uint8_t>(op))] = op;
+
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream fields(line);
+        Entry e{0, {}};
+        std::string name;
+        if (!(fields >> e.count)) continue;
+
+        bool known = true;
+        while (fields >> name) {
+            auto it = by_name.find(name);
+            if (it == by_name.end()) { known = false; break; }
+            e.ops.push_back(it->second);
+        }
+        if (known && !e.ops.empty()) out.push_back(std::move(e));
+    }
+    return true;
+}
+
+bool OpProfile::save(const std::string& path) const
+{
+    std::map<std::vector<uint8_t>, uint64_t> merged;
+
+    std::vector<Entry> previous;
+    load(path, previous);
+    for (auto& e : previous) merged[e.ops] += e.count;
+    for (auto& e : entries()) merged[e.ops] += e.count;
+
+    std::vector<Entry> sorted;
+    for (auto& [ops, count] : merged) sorted.push_back({count, ops});
+    std::sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+        return a.count != b.count ? a.count > b.count : a.ops < b.ops;
+    });
+
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) return false;
+
+    out << "# ryc opcode profile: count, then the opcodes of the n-gram" << std::endl;
+    for (auto& e : sorted) {
+        out << e.count;
+        for (uint8_t op : e.ops) out << ' ' << opcode_name(op);
+        out << '\n';
+    }
+    return static_cast<bool>(out);
+}
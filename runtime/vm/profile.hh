@@ -0,0 +1,69 @@
+/*
+
+profile.hh
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Opcode n-gram counts, recorded by VMs built with RYLANG_VM_PROFILE.
+// Only runs laid out back to back in the bytecode and compiled from one
+// source line are counted, the same runs the compiler can fuse. A taken
+// jump, a call, a return or a new line starts a new run.
+class OpProfile {
+public:
+    static constexpr std::size_t MAX_N = 6;
+
+    static OpProfile& instance();
+
+    // 'at' is the address of the opcode in its chunk
+    void record(const uint8_t* at, uint8_t op, uint32_t line)
+    {
+        if (at != next || line != last_line) length = 0;
+        next = at + 1 + operand_sizes[op];
+        last_line = line;
+
+        if (length == MAX_N) {
+            for (std::size_t i = 1; i < MAX_N; i++) window[i - 1] = window[i];
+            length--;
+        }
+        window[length++] = op;
+
+        // Every n-gram ending at this opcode
+        uint64_t key = 0;
+        for (std::size_t n = 1; n <= length; n++) {
+            key |= static_cast<uint64_t>(window[length - n]) << (8 * (n - 1));
+            counts[key | static_cast<uint64_t>(n) << 56]++;
+        }
+    }
+
+    struct Entry {
+        uint64_t count;
+        std::vector<uint8_t> ops;
+    };
+
+    // Most frequent first
+    std::vector<Entry> entries() const;
+
+    // Adds the counts to those already in 'path', so several runs accumulate
+    bool save(const std::string& path) const;
+    static bool load(const std::string& path, std::vector<Entry>& out);
+
+private:
+    OpProfile();
+
+    // Opcode bytes packed low byte first, n in the top byte
+    std::unordered_map<uint64_t, uint64_t> counts;
+    std::size_t operand_sizes[256];
+
+    uint8_t window[MAX_N];
+    std::size_t length = 0;
+    const uint8_t* next = nullptr;
+    uint32_t last_line = 0;
+};
@@ -0,0 +1,643 @@
+#include "vm.hh"
+
+#include "../eval/statements.hh"
+#include "../eval/expressions.hh"
+#include "../../utils/error.hh"
+#include "../../utils/int_ops.hh"
+
+#include <cassert>
+
+#ifdef RYLANG_VM_PROFILE
+#include "profile.hh"
+#endif
+
+// Computed goto relies on the GCC / Clang labels-as-values extension.
+// Configuring with -DRYLANG_COMPUTED_GOTO=OFF defines RYLANG_SWITCH_DISPATCH
+// and keeps the portable switch.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(RYLANG_SWITCH_DISPATCH)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+// Every base opcode, in OpCode order
+#define VM_OPCODES(X) \
+    X(OP_CONSTANT) X(OP_NULL) X(OP_DEFAULT) X(OP_POP) X(OP_GET_LOCAL) X(OP_SET_LOCAL) \
+    X(OP_DEFINE_LOCAL) X(OP_GET_GLOBAL) X(OP_SET_GLOBAL) X(OP_DEFINE_GLOBAL) X(OP_STORE_LOCAL) \
+    X(OP_STORE_GLOBAL) X(OP_ADD) X(OP_SUB) X(OP_MUL) X(OP_DIV) X(OP_MOD) X(OP_EQ) X(OP_NEQ) \
+    X(OP_GT) X(OP_GTE) X(OP_LT) X(OP_LTE) X(OP_AND) X(OP_OR) X(OP_TO_BOOL) X(OP_ADD_INT) \
+    X(OP_SUB_INT) X(OP_MUL_INT) X(OP_EQ_INT) X(OP_NEQ_INT) X(OP_GT_INT) X(OP_GTE_INT) \
+    X(OP_LT_INT) X(OP_LTE_INT) X(OP_NEG) X(OP_POS) X(OP_NOT) X(OP_INCDEC) X(OP_INCDEC_INDEX) \
+    X(OP_COERCE) X(OP_CAST) X(OP_ARRAY) X(OP_ARRAY_DECL) X(OP_INDEX) X(OP_SET_INDEX) X(OP_JUMP) \
+    X(OP_JUMP_IF_FALSE) X(OP_LOOP) X(OP_CALL) X(OP_RETURN) X(OP_ERROR)
+
+#define COUNT_OPCODE(name, ...) + 1
+static_assert(0 VM_OPCODES(COUNT_OPCODE) == OP__BASE_COUNT, "VM_OPCODES must list every base opcode");
+#undef COUNT_OPCODE
+
+// FOR_EACH(m, a, b, ...) expands to m(a) m(b) ..., for up to
+// OpProfile::MAX_N arguments (the longest superinstruction)
+#define FOR_EACH_1(m, x)      m(x)
+#define FOR_EACH_2(m, x, ...) m(x) FOR_EACH_1(m, __VA_ARGS__)
+#define FOR_EACH_3(m, x, ...) m(x) FOR_EACH_2(m, __VA_ARGS__)
+#define FOR_EACH_4(m, x, ...) m(x) FOR_EACH_3(m, __VA_ARGS__)
+#define FOR_EACH_5(m, x, ...) m(x) FOR_EACH_4(m, __VA_ARGS__)
+#define FOR_EACH_6(m, x, ...) m(x) FOR_EACH_5(m, __VA_ARGS__)
+#define FOR_EACH_PICK(_1, _2, _3, _4, _5, _6, name, ...) name
+#define FOR_EACH(m, ...) \
+    FOR_EACH_PICK(__VA_ARGS__, FOR_EACH_6, FOR_EACH_5, FOR_EACH_4, FOR_EACH_3, FOR_EACH_2, FOR_EACH_1)(m, __VA_ARGS__)
+
+VM::VM(const std::vector<std::string>& global_names)
+    : globals(global_names.size()), names(global_names)
+{
+    stack.reserve(256);
+    frames.reserve(64);
+}
+
+const char* VM::dispatch_mode()
+{
+    return VM_THREADED ? "computed goto" : "switch";
+}
+
+void VM::define_global(const std::string& name, Value value, ValueType type)
+{
+    for (std::size_t i = 0; i < names.size(); i++) {
+        if (names[i] == name) {
+            globals[i] = Global{std::move(value), type, true, true};
+            return;
+        }
+    }
+}
+
+// Binds the arguments on top of the stack to a new frame, following the same
+// parameter rules as the tree walker's eval_call_expr.
+void VM::call(const Value& callee, uint8_t argc, std::size_t line)
+{
+    if (callee.kind != VAL_FUNCTION) {
+        runtime_err("attempted to call a non-function value", line);
+    }
+
+    std::size_t args_base = stack.size() - argc;
+
+    if (auto native = dynamic_cast<NativeFunctionValue*>(callee.obj)) {
+        std::vector<Value> args(stack.begin() + args_base, stack.end());
+        stack.resize(args_base - 1);
+        push(native->func(args, nullptr, line));
+        return;
+    }
+
+    auto compiled = dynamic_cast<CompiledFunctionValue*>(callee.obj);
+    if (!compiled) runtime_err("unknown function type", line);
+
+    CompiledFunction* fn = compiled->function.get();
+    if (argc < fn->params.size()) {
+        runtime_err("function '" + fn->name + "' expects " + std::to_string(fn->params.size()) +
+                    " arguments but got " + std::to_string(argc), line);
+    }
+
+    std::size_t base = locals.size();
+    locals.resize(base + fn->num_slots);
+
+    for (std::size_t i = 0; i < fn->params.size(); i++) {
+        const ParamSpec& param = fn->params[i];
+        const Value& arg_val = stack[args_base + i];
+        Slot& slot = locals[base + i];
+
+        if (param.is_array) {
+            if (arg_val.kind != VAL_ARRAY) {
+                runtime_err("expected array argument for parameter '" + param.name + "'", line);
+            }
+            auto arr = arg_val.as<ArrayValue>();
+
+            ValueType elemType = param.type;
+            if (param.is_auto) {
+                elemType = arr->elem_type;
+                if (elemType == VAL_NULL && !arr->empty()) elemType = arr->get(0).kind;
+            }
+            cast_elements(arr, elemType, line);
+            slot.value = arg_val;
+            slot.type = VAL_ARRAY;
+        } else {
+            ValueType expected_type = param.is_auto ? arg_val.kind : param.type;
+            slot.value = cast(arg_val, expected_type, line);
+            slot.type = expected_type;
+        }
+    }
+
+    stack.resize(args_base - 1);
+    frames.push_back(Frame{fn, 0, base, stack.size()});
+}
+
+Value VM::run(std::shared_ptr<CompiledFunction> fn)
+{
+    script = std::move(fn);
+
+    locals.resize(script->num_slots);
+    frames.push_back(Frame{script.get(), 0, 0, 0});
+
+    Frame* frame = &frames.back();
+    const Chunk* chunk = &frame->function->chunk;
+    const uint8_t* code = chunk->code.data();
+    std::size_t ip = 0;
+
+#define READ_BYTE()  (code[ip++])
+#define READ_U16()   (ip += 2, static_cast<uint16_t>(code[ip - 2] | (code[ip - 1] << 8)))
+#define READ_U32()   (ip += 4, chunk->read_u32(ip - 4))
+#define LINE()       (chunk->lines[op_start])
+#define LOAD_FRAME() do { frame = &frames.back(); chunk = &frame->function->chunk; code = chunk->code.data(); ip = frame->ip; } while (0)
+
+#ifdef RYLANG_VM_PROFILE
+#define PROFILE()    OpProfile::instance().record(code + op_start, op, LINE())
+#else
+#define PROFILE()    ((void)0)
+#endif
+
+    /* Bodies of the opcodes superinstructions are built from (see
+       fusion_kind()). Each reads its own operands, so a superinstruction
+       runs its parts one after the other over the operands laid out back to
+       back. Errors report the line of the whole instruction. */
+
+#define DO_OP_CONSTANT()      { push(chunk->constants[READ_U32()]); }
+#define DO_OP_NULL()          { push(Value()); }
+#define DO_OP_POP()           { stack.pop_back(); }
+
+#define DO_OP_GET_LOCAL()     { push(locals[frame->slots + READ_U16()].value); }
+#define DO_OP_SET_LOCAL()                                       \
+    {                                                           \
+        Slot& slot = locals[frame->slots + READ_U16()];         \
+        stack.back() = cast(stack.back(), slot.type, LINE());   \
+        slot.value = stack.back();                              \
+    }
+#define DO_OP_DEFINE_LOCAL()                                    \
+    {                                                           \
+        Slot& slot = locals[frame->slots + READ_U16()];         \
+        uint8_t type = READ_BYTE();                             \
+        slot.value = pop();                                     \
+        slot.type = type == TYPE_INFER ? slot.value.kind : static_cast<ValueType>(type); \
+    }
+#define DO_OP_STORE_LOCAL()   { locals[frame->slots + READ_U16()].value = stack.back(); }
+
+#define DO_OP_GET_GLOBAL()                                      \
+    {                                                           \
+        uint16_t idx = READ_U16();                              \
+        if (!globals[idx].defined) {                            \
+            runtime_err("ryc: cannot resolve symbol '" + names[idx] + "', as it does not exist.", LINE()); \
+        }                                                       \
+        push(globals[idx].value);                               \
+    }
+// Shared by SET_GLOBAL and STORE_GLOBAL, 'coerce' casts to the global's type
+#define ASSIGN_GLOBAL(coerce)                                   \
+    {                                                           \
+        uint16_t idx = READ_U16();                              \
+        Global& g = globals[idx];                               \
+        if (!g.defined) {                                       \
+            runtime_err("ryc: cannot resolve symbol '" + names[idx] + "', as it does not exist.", LINE()); \
+        }                                                       \
+        if (g.is_const) {                                       \
+            runtime_err("ryc: cannot assign to constant variable '" + names[idx] + "'", LINE()); \
+        }                                                       \
+        if (coerce) stack.back() = cast(stack.back(), g.type, LINE()); \
+        g.value = stack.back();                                 \
+    }
+#define DO_OP_SET_GLOBAL()    ASSIGN_GLOBAL(true)
+#define DO_OP_STORE_GLOBAL()  ASSIGN_GLOBAL(false)
+
+    // The opcodes are laid out in OpKind order, see chunk.hh
+#define BINARY(opcode)                                          \
+    {                                                           \
+        Value right = pop();                                    \
+        Value& left = stack.back();                             \
+        left = value_binary(static_cast<OpKind>(static_cast<int>(OpKind::Add) + (opcode - OP_ADD)), left, right, LINE()); \
+    }
+#define DO_OP_ADD()           BINARY(OP_ADD)
+#define DO_OP_SUB()           BINARY(OP_SUB)
+#define DO_OP_MUL()           BINARY(OP_MUL)
+#define DO_OP_DIV()           BINARY(OP_DIV)
+#define DO_OP_MOD()           BINARY(OP_MOD)
+#define DO_OP_EQ()            BINARY(OP_EQ)
+#define DO_OP_NEQ()           BINARY(OP_NEQ)
+#define DO_OP_GT()            BINARY(OP_GT)
+#define DO_OP_GTE()           BINARY(OP_GTE)
+#define DO_OP_LT()            BINARY(OP_LT)
+#define DO_OP_LTE()           BINARY(OP_LTE)
+
+    // 'x' and 'y' are the operands, 'left' the result slot. The compiler
+    // only emits these when the checker proved both operands are ints.
+#define INT_BINARY(result)                                      \
+    {                                                           \
+        assert(stack.back().kind == VAL_INT);                   \
+        int y = stack.back().i;                                 \
+        stack.pop_back();                                       \
+        Value& left = stack.back();                             \
+        assert(left.kind == VAL_INT);                           \
+        int x = left.i;                                         \
+        result;                                                 \
+    }
+#define DO_OP_ADD_INT()       INT_BINARY(left.i = int_add(x, y))
+#define DO_OP_SUB_INT()       INT_BINARY(left.i = int_sub(x, y))
+#define DO_OP_MUL_INT()       INT_BINARY(left.i = int_mul(x, y))
+#define DO_OP_EQ_INT()        INT_BINARY(left = Value::Bool(x == y))
+#define DO_OP_NEQ_INT()       INT_BINARY(left = Value::Bool(x != y))
+#define DO_OP_GT_INT()        INT_BINARY(left = Value::Bool(x > y))
+#define DO_OP_GTE_INT()       INT_BINARY(left = Value::Bool(x >= y))
+#define DO_OP_LT_INT()        INT_BINARY(left = Value::Bool(x < y))
+#define DO_OP_LTE_INT()       INT_BINARY(left = Value::Bool(x <= y))
+
+#define DO_OP_NEG()                                             \
+    {                                                           \
+        Value& value = stack.back();                            \
+        if (value.kind == VAL_INT) value.i = int_neg(value.i);  \
+        else if (value.kind == VAL_FLOAT) value.f = -value.f;   \
+        else runtime_err("ryc: unary '-' can only be applied to numeric types.", LINE()); \
+    }
+#define DO_OP_NOT()                                             \
+    {                                                           \
+        Value& value = stack.back();                            \
+        switch (value.kind) {                                   \
+            case VAL_INT:   value = Value::Bool(value.i == 0); break; \
+            case VAL_FLOAT: value = Value::Bool(value.f == 0.0); break; \
+            case VAL_BOOL:  value.b = !value.b; break;          \
+            case VAL_NULL:  value = Value::Bool(true); break;   \
+            default:                                            \
+                runtime_err("ryc: unary '!' can only be applied to truthy values.", LINE()); \
+        }                                                       \
+    }
+#define DO_OP_INCDEC()                                          \
+    {                                                           \
+        bool inc = READ_BYTE() != 0;                            \
+        Value& value = stack.back();                            \
+        if (value.kind == VAL_INT) {                            \
+            value.i = int_add(value.i, inc ? 1 : -1);           \
+        } else if (value.kind == VAL_FLOAT) {                   \
+            value.f += inc ? 1.0 : -1.0;                        \
+        } else {                                                \
+            runtime_err(std::string("ryc: unary '") + (inc ? "++" : "--") + "' can only be applied to numeric values.", LINE()); \
+        }                                                       \
+    }
+#define DO_OP_COERCE()                                          \
+    {                                                           \
+        auto type = static_cast<ValueType>(READ_BYTE());        \
+        stack.back() = cast(stack.back(), type, LINE());        \
+    }
+
+#define DO_OP_INDEX()                                           \
+    {                                                           \
+        Value prop = pop();                                     \
+        Value obj = pop();                                      \
+        if (prop.kind != VAL_INT) runtime_err("array index must be an integer", LINE()); \
+        if (obj.kind != VAL_ARRAY) runtime_err("object is not an array", LINE()); \
+        auto arr = obj.as<ArrayValue>();                        \
+        int idx = prop.i;                                       \
+        if (idx < 0 || idx >= (int)arr->size())                 \
+            runtime_err("array index out of bounds", LINE());   \
+        push(arr->get(idx));                                    \
+    }
+#define DO_OP_SET_INDEX()                                       \
+    {                                                           \
+        Value value = pop();                                    \
+        Value indexVal = pop();                                 \
+        Value objVal = pop();                                   \
+        if (objVal.kind != VAL_ARRAY) runtime_err("attempting to index a non-array value", LINE()); \
+        if (indexVal.kind != VAL_INT) runtime_err("array index must be an integer", LINE()); \
+        auto arr = objVal.as<ArrayValue>();                     \
+        size_t idx = static_cast<size_t>(indexVal.i);           \
+        if (idx >= arr->size()) runtime_err("array index out of bounds", LINE()); \
+        value = cast_element(arr, value, LINE());               \
+        arr->set(idx, value);                                   \
+        push(std::move(value));                                 \
+    }
+
+    // Control transfers, only ever the last part of a superinstruction
+#define DO_OP_JUMP()          { uint32_t offset = READ_U32(); ip += offset; }
+#define DO_OP_JUMP_IF_FALSE() { uint32_t offset = READ_U32(); if (!is_truthy(pop())) ip += offset; }
+#define DO_OP_LOOP()          { uint32_t offset = READ_U32(); ip -= offset; }
+#define DO_OP_CALL()                                            \
+    {                                                           \
+        uint8_t argc = READ_BYTE();                             \
+        Value callee = stack[stack.size() - 1 - argc];          \
+        frame->ip = ip;                                         \
+        call(callee, argc, LINE());                             \
+        LOAD_FRAME();                                           \
+    }
+
+#define FUSED_PART(part) DO_##part()
+
+    std::size_t op_start = 0;
+    uint8_t op = 0;
+
+#if VM_THREADED
+    // Direct threading: every handler ends in its own indirect jump to the
+    // next handler, so each gets a branch history of its own instead of
+    // sharing the single jump of a switch
+    static void* dispatch_table[256];
+    if (!dispatch_table[0]) {
+        for (auto& target : dispatch_table) target = &&op_unknown;
+#define REGISTER(name, ...) dispatch_table[name] = &&op_##name;
+        VM_OPCODES(REGISTER)
+#define SUPERINSTRUCTION REGISTER
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION
+#undef REGISTER
+    }
+
+#define TARGET(name)   op_##name
+#define TARGET_DEFAULT op_unknown
+#define DISPATCH()     do { op_start = ip; op = READ_BYTE(); PROFILE(); goto *dispatch_table[op]; } while (0)
+
+    DISPATCH();
+#else
+#define TARGET(name)   case name
+#define TARGET_DEFAULT default
+#define DISPATCH()     continue
+
+    while (true)
+    {
+        op_start = ip;
+        op = READ_BYTE();
+        PROFILE();
+
+        switch (op) {
+#endif
+            TARGET(OP_CONSTANT):
+                DO_OP_CONSTANT();
+                DISPATCH();
+            TARGET(OP_NULL):
+                DO_OP_NULL();
+                DISPATCH();
+            TARGET(OP_DEFAULT):
+                push(default_val(static_cast<ValueType>(READ_BYTE()), LINE()));
+                DISPATCH();
+            TARGET(OP_POP):
+                DO_OP_POP();
+                DISPATCH();
+
+            /* Variables */
+            TARGET(OP_GET_LOCAL):
+                DO_OP_GET_LOCAL();
+                DISPATCH();
+            TARGET(OP_SET_LOCAL):
+                DO_OP_SET_LOCAL();
+                DISPATCH();
+            TARGET(OP_DEFINE_LOCAL):
+                DO_OP_DEFINE_LOCAL();
+                DISPATCH();
+            TARGET(OP_GET_GLOBAL):
+                DO_OP_GET_GLOBAL();
+                DISPATCH();
+            TARGET(OP_SET_GLOBAL):
+                DO_OP_SET_GLOBAL();
+                DISPATCH();
+            TARGET(OP_DEFINE_GLOBAL):
+            {
+                uint16_t idx = READ_U16();
+                uint8_t type = READ_BYTE();
+                bool is_const = READ_BYTE() != 0;
+                Global& g = globals[idx];
+                if (g.defined) {
+                    runtime_err("ryc: cannot redeclare variable '" + names[idx] + "'", LINE());
+                }
+                g.value = pop();
+                g.type = type == TYPE_INFER ? g.value.kind : static_cast<ValueType>(type);
+                g.defined = true;
+                g.is_const = is_const;
+                DISPATCH();
+            }
+
+            TARGET(OP_STORE_LOCAL):
+                DO_OP_STORE_LOCAL();
+                DISPATCH();
+            TARGET(OP_STORE_GLOBAL):
+                DO_OP_STORE_GLOBAL();
+                DISPATCH();
+
+            /* Binary operators */
+            TARGET(OP_ADD): DO_OP_ADD(); DISPATCH();
+            TARGET(OP_SUB): DO_OP_SUB(); DISPATCH();
+            TARGET(OP_MUL): DO_OP_MUL(); DISPATCH();
+            TARGET(OP_DIV): DO_OP_DIV(); DISPATCH();
+            TARGET(OP_MOD): DO_OP_MOD(); DISPATCH();
+            TARGET(OP_EQ):  DO_OP_EQ();  DISPATCH();
+            TARGET(OP_NEQ): DO_OP_NEQ(); DISPATCH();
+            TARGET(OP_GT):  DO_OP_GT();  DISPATCH();
+            TARGET(OP_GTE): DO_OP_GTE(); DISPATCH();
+            TARGET(OP_LT):  DO_OP_LT();  DISPATCH();
+            TARGET(OP_LTE): DO_OP_LTE(); DISPATCH();
+
+            TARGET(OP_ADD_INT): DO_OP_ADD_INT(); DISPATCH();
+            TARGET(OP_SUB_INT): DO_OP_SUB_INT(); DISPATCH();
+            TARGET(OP_MUL_INT): DO_OP_MUL_INT(); DISPATCH();
+            TARGET(OP_EQ_INT):  DO_OP_EQ_INT();  DISPATCH();
+            TARGET(OP_NEQ_INT): DO_OP_NEQ_INT(); DISPATCH();
+            TARGET(OP_GT_INT):  DO_OP_GT_INT();  DISPATCH();
+            TARGET(OP_GTE_INT): DO_OP_GTE_INT(); DISPATCH();
+            TARGET(OP_LT_INT):  DO_OP_LT_INT();  DISPATCH();
+            TARGET(OP_LTE_INT): DO_OP_LTE_INT(); DISPATCH();
+
+            TARGET(OP_AND):
+            TARGET(OP_OR):
+            {
+                uint32_t offset = READ_U32();
+                Value& left = stack.back();
+
+                // A null left operand makes the whole expression null
+                if (left.kind == VAL_NULL) { ip += offset; DISPATCH(); }
+
+                bool left_bool = cast(left, VAL_BOOL, LINE()).b;
+                if (left_bool == (op == OP_OR)) {
+                    left = Value::Bool(left_bool);
+                    ip += offset;
+                    DISPATCH();
+                }
+                pop();
+                DISPATCH();
+            }
+            TARGET(OP_TO_BOOL):
+            {
+                Value& value = stack.back();
+                if (value.kind != VAL_NULL) value = Value::Bool(cast(value, VAL_BOOL, LINE()).b);
+                DISPATCH();
+            }
+
+            /* Unary operators */
+            TARGET(OP_NEG):
+                DO_OP_NEG();
+                DISPATCH();
+            TARGET(OP_POS):
+            {
+                Value& value = stack.back();
+                if (value.kind != VAL_INT && value.kind != VAL_FLOAT) {
+                    runtime_err("ryc: unary '+' can only be applied to numeric types.", LINE());
+                }
+                DISPATCH();
+            }
+            TARGET(OP_NOT):
+                DO_OP_NOT();
+                DISPATCH();
+            TARGET(OP_INCDEC):
+                DO_OP_INCDEC();
+                DISPATCH();
+            TARGET(OP_INCDEC_INDEX):
+            {
+                bool inc = READ_BYTE() != 0;
+                bool prefix = READ_BYTE() != 0;
+                Value idxVal = pop();
+                Value objVal = pop();
+                std::string opname = inc ? "++" : "--";
+
+                if (objVal.kind != VAL_ARRAY) {
+                    runtime_err("ryc: unary '" + opname + "' can only be applied to numeric array elements", LINE());
+                }
+                if (idxVal.kind != VAL_INT) {
+                    runtime_err("ryc: array index must be an integer", LINE());
+                }
+
+                auto arr = objVal.as<ArrayValue>();
+                int idx = idxVal.i;
+                if (idx < 0 || idx >= static_cast<int>(arr->size())) {
+                    runtime_err("ryc: array index out of bounds", LINE());
+                }
+
+                Value oldVal = arr->get(idx);
+                Value newVal;
+                if (oldVal.kind == VAL_INT) {
+                    newVal = Value::Int(int_add(oldVal.i, inc ? 1 : -1));
+                } else if (oldVal.kind == VAL_FLOAT) {
+                    newVal = Value::Float(oldVal.f + (inc ? 1.0 : -1.0));
+                } else {
+                    runtime_err("ryc: unary '" + opname + "' can only be applied to numeric values.", LINE());
+                }
+
+                arr->set(idx, newVal);
+                push(prefix ? newVal : oldVal);
+                DISPATCH();
+            }
+
+            /* Conversions */
+            TARGET(OP_COERCE):
+                DO_OP_COERCE();
+                DISPATCH();
+            TARGET(OP_CAST):
+            {
+                auto type = static_cast<ValueType>(READ_BYTE());
+                stack.back() = static_cast_value(stack.back(), type);
+                DISPATCH();
+            }
+
+            /* Arrays */
+            TARGET(OP_ARRAY):
+            {
+                uint32_t count = READ_U32();
+                std::vector<Value> elems(std::make_move_iterator(stack.end() - count), std::make_move_iterator(stack.end()));
+                stack.resize(stack.size() - count);
+                push(Value::Object(new ArrayValue(std::move(elems))));
+                DISPATCH();
+            }
+            TARGET(OP_ARRAY_DECL):
+            {
+                uint8_t elem = READ_BYTE();
+                bool sized = READ_BYTE() != 0;
+                std::size_t line = LINE();
+
+                Value size = sized ? pop() : Value();
+                const Value& value = stack.back();
+                if (value.kind != VAL_ARRAY) {
+                    runtime_err("initializer is not an array", line);
+                }
+                auto arrVal = value.as<ArrayValue>();
+
+                ValueType elemType;
+                if (elem == TYPE_INFER) {
+                    if (arrVal->empty()) {
+                        runtime_err("cannot infer type of empty array", line);
+                    }
+                    elemType = arrVal->get(0).kind;
+                } else {
+                    elemType = static_cast<ValueType>(elem);
+                }
+
+                std::size_t declared_size = 0;
+                if (sized) {
+                    if (size.kind != VAL_INT) runtime_err("array size must be an integer", line);
+                    declared_size = size.i;
+
+                    if (arrVal->size() > declared_size) {
+                        runtime_err("array initializer has more elements than declared size", line);
+                    }
+                }
+
+                cast_elements(arrVal, elemType, line);
+
+                if (declared_size > 0) {
+                    Value fill = default_val(elemType, line);
+                    arrVal->reserve(declared_size);
+                    while (arrVal->size() < declared_size) {
+                        arrVal->push(fill);
+                    }
+                }
+                DISPATCH();
+            }
+            TARGET(OP_INDEX):
+                DO_OP_INDEX();
+                DISPATCH();
+            TARGET(OP_SET_INDEX):
+                DO_OP_SET_INDEX();
+                DISPATCH();
+
+            /* Control flow */
+            TARGET(OP_JUMP):
+                DO_OP_JUMP();
+                DISPATCH();
+            TARGET(OP_JUMP_IF_FALSE):
+                DO_OP_JUMP_IF_FALSE();
+                DISPATCH();
+            TARGET(OP_LOOP):
+                DO_OP_LOOP();
+                DISPATCH();
+            TARGET(OP_CALL):
+                DO_OP_CALL();
+                DISPATCH();
+            TARGET(OP_RETURN):
+            {
+                Value result = pop();
+                locals.resize(frame->slots);
+                stack.resize(frame->stack_base);
+                frames.pop_back();
+
+                if (frames.empty()) {
+                    return result;
+                }
+
+                push(std::move(result));
+                LOAD_FRAME();
+                DISPATCH();
+            }
+            TARGET(OP_ERROR):
+            {
+                runtime_err(chunk->constants[READ_U32()].as_string(), LINE());
+                DISPATCH();
+            }
+
+            /* Superinstructions, generated into superinstructions.def */
+#define SUPERINSTRUCTION(name, ...) \
+            TARGET(name): FOR_EACH(FUSED_PART, __VA_ARGS__) DISPATCH();
+#include "superinstructions.def"
+#undef SUPERINSTRUCTION
+
+            TARGET_DEFAULT:
+                runtime_err("vm: unknown opcode " + std::to_string(op), LINE());
+                DISPATCH();
+#if !VM_THREADED
+        }
+    }
+#endif
+
+#undef READ_BYTE
+#undef READ_U16
+#undef READ_U32
+#undef LINE
+#undef LOAD_FRAME
+#undef PROFILE
+#undef TARGET
+#undef TARGET_DEFAULT
+#undef DISPATCH
+}
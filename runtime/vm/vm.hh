@@ -0,0 +1,61 @@
+/*
+
+vm.hh
+
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chunk.hh"
+
+// Stack based virtual machine executing the bytecode produced by Compiler.
+class VM {
+public:
+    explicit VM(const std::vector<std::string>& global_names);
+
+    // Binds a global (used for the native functions)
+    void define_global(const std::string& name, Value value, ValueType type);
+
+    Value run(std::shared_ptr<CompiledFunction> script);
+
+    // "computed goto" or "switch", chosen at build time
+    static const char* dispatch_mode();
+
+private:
+    struct Slot {
+        Value value;
+        ValueType type = VAL_NULL;
+    };
+
+    struct Global {
+        Value value;
+        ValueType type = VAL_NULL;
+        bool defined = false;
+        bool is_const = false;
+    };
+
+    struct Frame {
+        CompiledFunction* function;
+        std::size_t ip;
+        std::size_t slots;      // base index into 'locals'
+        std::size_t stack_base; // operand stack height at entry
+    };
+
+    void call(const Value& callee, uint8_t argc, std::size_t line);
+
+    Value pop() { Value v = std::move(stack.back()); stack.pop_back(); return v; }
+    void push(Value v) { stack.push_back(std::move(v)); }
+
+    std::vector<Value> stack;
+    std::vector<Slot> locals;
+    std::vector<Frame> frames;
+    std::vector<Global> globals;
+    std::vector<std::string> names;
+
+    // Keeps the running script's functions alive
+    std::shared_ptr<CompiledFunction> script;
+};
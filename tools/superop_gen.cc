@@ -0,0 +1,164 @@
+/*
+
+superop_gen.cc
+
+Superinstruction generator. Reads opcode profiles written by an
+instrumented ryc (configured with -DRYLANG_VM_PROFILE=ON) and picks the
+opcode runs whose fusion saves the most dispatches, then prints them as
+runtime/vm/superinstructions.def. The compiler fuses those runs wherever
+it emits them and the VM builds their handlers from the parts. The
+shipped set comes from the workloads in bench/profile.
+
+    ryc --engine=vm --op-profile=ops.prof script.ry   (once per workload)
+    superop_gen [--max=N] [--min-share=PERCENT] ops.prof... > runtime/vm/superinstructions.def
+
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../runtime/vm/chunk.hh"
+#include "../runtime/vm/profile.hh"
+
+struct Candidate {
+    std::vector<uint8_t> ops;
+    uint64_t count;       // occurrences not yet covered by a chosen superinstruction
+    uint64_t covered = 0; // dispatches chosen superinstructions overlapping it already save
+
+    uint64_t saved() const
+    {
+        uint64_t all = count * (ops.size() - 1);
+        return all > covered ? all - covered : 0;
+    }
+};
+
+// Runs the VM can fuse: base opcodes only, a control transfer only last
+static bool fusable(const std::vector<uint8_t>& ops)
+{
+    if (ops.size() < 2) return false;
+
+    for (std::size_t i = 0; i < ops.size(); i++) {
+        if (ops[i] >= OP__BASE_COUNT) return false;
+
+        Fusion kind = fusion_kind(ops[i]);
+        if (kind == Fusion::None) return false;
+        if (kind == Fusion::Last && i + 1 != ops.size()) return false;
+    }
+    return true;
+}
+
+static bool contains(const std::vector<uint8_t>& outer, const std::vector<uint8_t>& inner)
+{
+    return std::search(outer.begin(), outer.end(), inner.begin(), inner.end()) != outer.end();
+}
+
+// Longest stretch 'a' shares with 'b': all of 'b' inside 'a', or an end of
+// one lined up with the start of the other
+static std::size_t overlap(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b)
+{
+    if (contains(a, b)) return b.size();
+
+    std::size_t best = 0;
+    for (std::size_t k = 1; k < std::min(a.size(), b.size()); k++) {
+        if (std::equal(a.end() - k, a.end(), b.begin()) || std::equal(b.end() - k, b.end(), a.begin())) best = k;
+    }
+    return best;
+}
+
+static std::string join(const std::vector<uint8_t>& ops, const char* sep)
+{
+    std::string out;
+    for (std::size_t i = 0; i < ops.size(); i++) {
+        if (i) out += sep;
+        out += opcode_name(ops[i]);
+    }
+    return out;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t max = 24;
+    double min_share = 0.5; // percent of all executed instructions
+
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--max=", 0) == 0) max = std::strtoul(arg.c_str() + 6, nullptr, 10);
+        else if (arg.rfind("--min-share=", 0) == 0) min_share = std::atof(arg.c_str() + 12);
+        else paths.push_back(arg);
+    }
+
+    if (paths.empty()) {
+        std::fprintf(stderr, "superop_gen: usage: superop_gen [--max=N] [--min-share=PERCENT] profile...\n");
+        return 1;
+    }
+
+    // OpCode is a byte and OP__COUNT has to fit in it
+    max = std::min<std::size_t>(max, 0xFF - OP__BASE_COUNT);
+
+    std::map<std::vector<uint8_t>, uint64_t> merged;
+    for (auto& path : paths) {
+        std::vector<OpProfile::Entry> entries;
+        if (!OpProfile::load(path, entries)) {
+            std::fprintf(stderr, "superop_gen: cannot read '%s'\n", path.c_str());
+            return 1;
+        }
+        for (auto& e : entries) merged[e.ops] += e.count;
+    }
+
+    uint64_t executed = 0;
+    std::vector<Candidate> candidates;
+    for (auto& [ops, count] : merged) {
+        if (ops.size() == 1) executed += count;
+        if (fusable(ops)) candidates.push_back({ops, count});
+    }
+
+    if (executed == 0) {
+        std::fprintf(stderr, "superop_gen: the profiles are empty\n");
+        return 1;
+    }
+
+    // Greedy by dispatches saved. Runs inside a chosen one lose the
+    // occurrences it already covers, runs overlapping it (shifted windows of
+    // the same code, or longer runs around it) only gain what it leaves.
+    std::vector<Candidate> chosen;
+    while (chosen.size() < max && !candidates.empty()) {
+        auto best = std::max_element(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.saved() != b.saved() ? a.saved() < b.saved() : a.ops.size() < b.ops.size();
+        });
+
+        if (best->saved() * 100.0 < min_share * executed) break;
+
+        Candidate pick = *best;
+        candidates.erase(best);
+        for (auto& c : candidates) {
+            uint64_t shared = std::min(c.count, pick.count);
+            if (contains(pick.ops, c.ops)) {
+                c.count -= shared;
+            } else if (std::size_t k = overlap(c.ops, pick.ops); k >= 2) {
+                c.covered += shared * (k - 1);
+            }
+        }
+        chosen.push_back(pick);
+    }
+
+    std::printf("// Generated by tools/superop_gen, do not edit by hand.\n");
+    std::printf("// %llu instructions profiled, %zu superinstructions.\n",
+                static_cast<unsigned long long>(executed), chosen.size());
+    std::printf("//\n");
+    std::printf("//   SUPERINSTRUCTION(opcode, parts...)\n");
+
+    for (auto& c : chosen) {
+        double share = 100.0 * c.saved() / executed;
+        std::printf("\n// %s: saves %.1f%% of dispatches\n", join(c.ops, " ").c_str(), share);
+        std::printf("SUPERINSTRUCTION(OP_%s", join(c.ops, "__").c_str());
+        for (uint8_t op : c.ops) std::printf(", OP_%s", opcode_name(op));
+        std::printf(")\n");
+    }
+
+    return 0;
+}
@@ -16,3 +16,15 @@ inline void runtime_err(const std::string& err, std::size_t l)
     std::cout << "ryc: Runtime Error: line " << l << ", " << err << std::endl;
     std::exit(1);
 }
+
+inline void type_err(const std::string& err, std::size_t l)
+{
+    std::cout << "ryc: Type Error: line " << l << ", " << err << std::endl;
+    std::exit(1);
+}
+
+inline void compile_err(const std::string& err, std::size_t l)
+{
+    std::cout << "ryc: Compile Error: line " << l << ", " << err << std::endl;
+    std::exit(1);
+}
@@ -0,0 +1,21 @@
+/*
+
+int_ops.hh
+
+*/
+
+#pragma once
+
+#include <cmath>
+
+// Int arithmetic. Rylang ints are 32-bit and wrap around on overflow; the
+// engines and the parser's constant folder all go through these, so a
+// folded expression has the value the same expression computes at runtime.
+
+inline int int_add(int x, int y) { return static_cast<int>(static_cast<unsigned>(x) + static_cast<unsigned>(y)); }
+inline int int_sub(int x, int y) { return static_cast<int>(static_cast<unsigned>(x) - static_cast<unsigned>(y)); }
+inline int int_mul(int x, int y) { return static_cast<int>(static_cast<unsigned>(x) * static_cast<unsigned>(y)); }
+inline int int_neg(int x) { return static_cast<int>(0u - static_cast<unsigned>(x)); }
+
+// Truncated remainder, through fmod so INT_MIN % -1 is 0; y != 0
+inline int int_mod(int x, int y) { return static_cast<int>(std::fmod(x, y)); }
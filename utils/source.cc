@@ -0,0 +1,64 @@
+#include "source.hh"
+
+#include <cstdint>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::~SourceFile()
+{
+    if (mapped) munmap(const_cast<char*>(data), size);
+}
+
+bool SourceFile::open(const std::string& path)
+{
+    int fd = path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool ok = fstat(fd, &st) == 0;
+
+    // Token offsets are 32 bits wide
+    if (ok && static_cast<uint64_t>(st.st_size) > UINT32_MAX) ok = false;
+
+    if (ok && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p, st.st_size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(p);
+            size = st.st_size;
+            mapped = true;
+        } else {
+            ok = read_all(fd, st.st_size);
+        }
+    } else if (ok) {
+        ok = read_all(fd, S_ISREG(st.st_mode) ? 0 : 64 * 1024);
+    }
+
+    if (fd != STDIN_FILENO) close(fd);
+    return ok;
+}
+
+bool SourceFile::read_all(int fd, std::size_t size_hint)
+{
+    buffer.resize(size_hint > 0 ? size_hint : 4096);
+    std::size_t used = 0;
+
+    while (true) {
+        if (used == buffer.size()) buffer.resize(buffer.size() * 2);
+
+        ssize_t n = read(fd, &buffer[used], buffer.size() - used);
+        if (n < 0) return false;
+        if (n == 0) break;
+        used += n;
+    }
+
+    if (used > UINT32_MAX) return false;
+
+    buffer.resize(used);
+    data = buffer.data();
+    size = used;
+    return true;
+}
@@ -0,0 +1,36 @@
+/*
+
+source.hh
+
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only view of a script's source. Regular files are mmap'ed, anything
+// that cannot be mapped (pipes, stdin as "-") is read into one buffer with
+// bulk reads. The tokens point into this buffer, so it has to outlive them.
+class SourceFile {
+public:
+    SourceFile() = default;
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    // Returns false if 'path' cannot be opened or read
+    bool open(const std::string& path);
+
+    std::string_view view() const { return std::string_view(data, size); }
+
+private:
+    bool read_all(int fd, std::size_t size_hint);
+
+    const char* data = nullptr;
+    std::size_t size = 0;
+    bool mapped = false;
+    std::string buffer;
+};
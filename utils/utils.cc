@@ -153,7 +153,7 @@ void print_ast(std::shared_ptr<Stmt> node, int indent = 0)
         {
             auto bin = std::static_pointer_cast<ASTBinaryExpr>(node);
 
-            std::cout << pad << "BinaryExpr(" << bin->op << "):" << std::endl;
+            std::cout << pad << "BinaryExpr(" << op_str(bin->op) << "):" << std::endl;
             std::cout << pad << "  Left:" << std::endl;
             print_ast(bin->left, indent + 4);
             std::cout << pad << "  Right:" << std::endl;
@@ -162,7 +162,7 @@ void print_ast(std::shared_ptr<Stmt> node, int indent = 0)
         }
         case UnaryExpr: {
             auto unary = std::static_pointer_cast<ASTUnaryExpr>(node);
-            std::cout << pad << "UnaryExpr(" << unary->op << "):" << std::endl;
+            std::cout << pad << "UnaryExpr(" << op_str(unary->op) << "):" << std::endl;
             std::cout << pad << "  Value:" << std::endl;
             print_ast(unary->operand, indent + 4);
             std::cout << pad << "  isPrefix: " << (unary->prefix ? "true" : "false") << std::endl;
@@ -212,7 +212,10 @@ void print_ast(std::shared_ptr<Stmt> node, int indent = 0)
         {
             auto num = std::static_pointer_cast<ASTNumericLiteral>(node);
 
-            std::cout << pad << "NumericLiteral(" << num->value << ")" << std::endl;
+            std::cout << pad << "NumericLiteral(";
+            if (num->is_int) std::cout << num->int_value;
+            else std::cout << num->float_value;
+            std::cout << ")" << std::endl;
             break;
         }
         case BoolLiteral: {
@@ -263,60 +266,49 @@ void print_ast(std::shared_ptr<Stmt> node, int indent = 0)
     }
 }
 
-void print_value(std::shared_ptr<RuntimeValue> node, Environment* env, std::size_t line)
+void print_value(const Value& node, Environment* env, std::size_t line)
 {
-    switch (node->kind) {
+    switch (node.kind) {
         case VAL_INT:
         {
-            auto num = std::static_pointer_cast<IntValue>(node);
-            std::cout << num->value << std::endl;
+            std::cout << node.i << std::endl;
             break;
         }
         case VAL_FLOAT:
         {
-            auto num = std::static_pointer_cast<FloatValue>(node);
-
-            if (std::floor(num->value) == num->value) {
-                std::cout << static_cast<int>(num->value) << std::endl;
+            if (std::floor(node.f) == node.f) {
+                std::cout << static_cast<int>(node.f) << std::endl;
             } else {
-                std::cout << num->value << std::endl;
+                std::cout << node.f << std::endl;
             }
 
             break;
         }
         case VAL_BOOL: {
-            auto bool_lit = std::static_pointer_cast<BoolValue>(node);
-            std::cout << (bool_lit->value ? "true" : "false") << std::endl;
+            std::cout << (node.b ? "true" : "false") << std::endl;
             break;
         }
         case VAL_STRING: {
-            auto str_lit = std::static_pointer_cast<StringValue>(node);
-            std::cout << str_lit->value << std::endl;
+            std::cout << node.as_string() << std::endl;
             break;
         }
         case VAL_ARRAY: {
-            auto arr = std::static_pointer_cast<ArrayValue>(node);
+            auto arr = node.as<ArrayValue>();
             std::cout << std::endl;
-            for (auto& e : arr->elements) { print_value(e, env, line); }
+            for (std::size_t i = 0; i < arr->size(); i++) { print_value(arr->get(i), env, line); }
             break;
         }
         case VAL_FUNCTION: {
-            auto func = std::static_pointer_cast<FunctionValue>(node);
+            auto func = node.as<FunctionValue>();
             std::cout << "<function " 
-                    << func->declaration->name << "(";
+                    << func->ast->name(func->declaration->name) << "(";
 
-            for (size_t i = 0; i < func->declaration->params.size(); i++) {
-                std::cout << func->declaration->params[i];
-                if (i + 1 < func->declaration->params.size()) std::cout << ", ";
+            for (uint32_t i = 0; i < func->declaration->params_count; i++) {
+                std::cout << func->ast->name(func->ast->params[func->declaration->params_begin + i].name);
+                if (i + 1 < func->declaration->params_count) std::cout << ", ";
             }
 
-            std::cout << ") at " << func.get() << ">";
-            break;
-        }
-        case VAL_RETURN:
-        {
-            auto ret = std::static_pointer_cast<ReturnValue>(node);
-            print_value(ret->value, env, line);
+            std::cout << ") at " << func << ">";
             break;
         }
         case VAL_NULL:
@@ -324,10 +316,12 @@ void print_value(std::shared_ptr<RuntimeValue> node, Environment* env, std::size
             std::cout << "null" << std::endl;
             break;
         }
+        default:
+            break;
     }
 }
 
-ValueType stoval(const std::string& type_str, std::shared_ptr<Stmt> node, Environment* env, std::size_t line) {
+ValueType stoval(const std::string& type_str, Environment* env, std::size_t line) {
     if (type_str == "int") return VAL_INT;
     if (type_str == "float") return VAL_FLOAT;
     if (type_str == "bool") return VAL_BOOL;
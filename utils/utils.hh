@@ -14,6 +14,6 @@ utils.hh
 #include "../runtime/environment/environment.hh"
 
 void print_ast(std::shared_ptr<Stmt> node, int indent);
-void print_value(std::shared_ptr<RuntimeValue> node, Environment* env, std::size_t line);
+void print_value(const Value& node, Environment* env, std::size_t line);
 
-ValueType stoval(const std::string& type_str, std::shared_ptr<Stmt> node, Environment* env, std::size_t line);
+ValueType stoval(const std::string& type_str, Environment* env, std::size_t line);